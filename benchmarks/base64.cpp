@@ -0,0 +1,121 @@
+// Compares the scalar and SIMD implementations of `show::base64_encode()` and
+// `show::base64_decode()` for a Basic authentication credential and a larger
+// payload
+
+
+#include <show/base64.hpp>
+
+#include <chrono>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    using simd_type = show::_base64_simd_function;
+    
+    // Each returns the output size so the work isn't optimized out
+    std::size_t encode( simd_type simd, const std::string& input )
+    {
+        return show::_base64_encode(
+            input,
+            show::base64_chars_standard,
+            simd
+        ).size();
+    }
+    
+    std::size_t decode( simd_type simd, const std::string& input )
+    {
+        return show::_base64_decode(
+            input,
+            show::base64_chars_standard,
+            0x00,
+            simd
+        ).size();
+    }
+    
+    void run(
+        const std::string& name,
+        std::size_t ( *codec )( simd_type, const std::string& ),
+        simd_type          simd,
+        const std::string& input,
+        std::size_t        iterations
+    )
+    {
+        std::size_t output_size{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t i = 0; i < iterations; ++i )
+            output_size += codec( simd, input );
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        std::cout
+            << "    "
+            << std::setw( 8 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( input.size() * iterations / elapsed / 1048576.0 )
+            << " MiB/s  ("
+            << output_size / iterations
+            << " bytes out)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    // Scaled down for larger inputs so each takes about as long
+    std::size_t iterations{ 1000000 };
+    if( argc > 1 )
+        iterations = std::stoul( argv[ 1 ] );
+    
+    std::string payload;
+    for( std::size_t i = 0; i < 65536; ++i )
+        payload += static_cast< char >( i * 2654435761u >> 24 );
+    
+    std::vector< std::pair< std::string, std::string > > inputs{
+        { "Basic credential", "Aladdin:open sesame, or some longer password" },
+        { "64 KiB payload"  , payload                                        }
+    };
+    
+    std::vector< std::pair< std::string, std::pair< simd_type, simd_type > > >
+        implementations{ { "scalar", { nullptr, nullptr } } };
+#if defined( SHOW_X86_SIMD )
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "ssse3" ) )
+        implementations.push_back( { "ssse3", {
+            &show::_base64_encode_ssse3,
+            &show::_base64_decode_ssse3
+        } } );
+    if( __builtin_cpu_supports( "avx2" ) )
+        implementations.push_back( { "avx2", {
+            &show::_base64_encode_avx2,
+            &show::_base64_decode_avx2
+        } } );
+#endif
+    
+    for( const auto& input : inputs )
+    {
+        auto encoded = show::base64_encode( input.second );
+        auto scaled  = iterations * 64 / ( input.second.size() + 64 ) + 1;
+        
+        std::cout
+            << input.first
+            << " ("
+            << input.second.size()
+            << " bytes):\n  encode:\n"
+        ;
+        for( const auto& i : implementations )
+            run( i.first, &encode, i.second.first, input.second, scaled );
+        
+        std::cout << "  decode:\n";
+        for( const auto& i : implementations )
+            run( i.first, &decode, i.second.second, encoded, scaled );
+    }
+    
+    return 0;
+}
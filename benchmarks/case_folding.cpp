@@ -0,0 +1,158 @@
+// Compares the word-at-a-time case folding & comparison used for header names
+// and protocol strings against the character-at-a-time versions they
+// replaced
+
+
+#include <show.hpp>
+
+#include <chrono>
+#include <functional>   // std::function<>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    const std::vector< std::string > names{
+        "Host",
+        "Accept-Encoding",
+        "content-length",
+        "Content-Type",
+        "X-Forwarded-For",
+        "Sec-WebSocket-Extensions",
+        "Access-Control-Request-Headers"
+    };
+    
+    std::string bytewise_upper( std::string s )
+    {
+        std::string out;
+        for( std::string::size_type i{ 0 }; i < s.size(); ++i )
+            out += show::_ASCII_upper( s[ i ] );
+        return out;
+    }
+    
+    bool bytewise_less( const std::string& lhs, const std::string& rhs )
+    {
+        std::string::size_type min_len{
+            lhs.size() < rhs.size() ? lhs.size() : rhs.size()
+        };
+        for( std::string::size_type i = 0; i < min_len; ++i )
+        {
+            auto lhc = show::_ASCII_upper( lhs[ i ] );
+            auto rhc = show::_ASCII_upper( rhs[ i ] );
+            if( lhc < rhc )
+                return true;
+            else if( lhc > rhc )
+                return false;
+        }
+        return lhs.size() < rhs.size();
+    }
+    
+    bool bytewise_equal( show::string_view lhs, show::string_view rhs )
+    {
+        if( lhs.size() != rhs.size() )
+            return false;
+        for( std::size_t i = 0; i < lhs.size(); ++i )
+        {
+            auto lhc = show::_ASCII_upper( lhs[ i ] );
+            auto rhc = show::_ASCII_upper( rhs[ i ] );
+            if( lhc != rhc )
+                return false;
+        }
+        return true;
+    }
+    
+    // Each returns a count so the work isn't optimized out
+    using function_type = std::function< std::size_t() >;
+    
+    void run(
+        const std::string&   name,
+        const function_type& function,
+        std::size_t          iterations
+    )
+    {
+        std::size_t result{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t i = 0; i < iterations; ++i )
+            result += function();
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        std::cout
+            << "    "
+            << std::setw( 10 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( elapsed / iterations * 1000000000.0 )
+            << " ns  ("
+            << result / iterations
+            << ")\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t iterations{ 1000000 };
+    if( argc > 1 )
+        iterations = std::stoul( argv[ 1 ] );
+    
+    // Same names in a different case, as a client might send them
+    std::vector< std::string > other_case;
+    for( const auto& name : names )
+        other_case.push_back( show::_ASCII_upper( name ) );
+    
+    std::cout << "uppercase " << names.size() << " names:\n";
+    run( "bytewise", [](){
+        std::size_t size{ 0 };
+        for( const auto& name : names )
+            size += bytewise_upper( name ).size();
+        return size;
+    }, iterations );
+    run( "SWAR", [](){
+        std::size_t size{ 0 };
+        for( const auto& name : names )
+            size += show::_ASCII_upper( name ).size();
+        return size;
+    }, iterations );
+    
+    std::cout << "compare every pair (" << names.size() << "^2):\n";
+    run( "bytewise", [ &other_case ](){
+        std::size_t less{ 0 };
+        for( const auto& lhs : names )
+            for( const auto& rhs : other_case )
+                less += bytewise_less( lhs, rhs );
+        return less;
+    }, iterations );
+    run( "SWAR", [ &other_case ](){
+        show::_less_ignore_case_ASCII compare;
+        std::size_t less{ 0 };
+        for( const auto& lhs : names )
+            for( const auto& rhs : other_case )
+                less += compare( lhs, rhs );
+        return less;
+    }, iterations );
+    
+    std::cout << "match each name against its other case:\n";
+    run( "bytewise", [ &other_case ](){
+        std::size_t equal{ 0 };
+        for( std::size_t i = 0; i < names.size(); ++i )
+            equal += bytewise_equal( names[ i ], other_case[ i ] );
+        return equal;
+    }, iterations );
+    run( "SWAR", [ &other_case ](){
+        std::size_t equal{ 0 };
+        for( std::size_t i = 0; i < names.size(); ++i )
+            equal += show::_equal_ignore_case_ASCII(
+                names[ i ],
+                other_case[ i ]
+            );
+        return equal;
+    }, iterations );
+    
+    return 0;
+}
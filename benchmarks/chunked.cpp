@@ -0,0 +1,151 @@
+// Compares the throughput of reading a large request body sent with
+// "Content-Length" against the same body sent with "Transfer-Encoding:
+// chunked" in chunks of a few different sizes
+
+
+#include <show.hpp>
+
+#include <chrono>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <sstream>      // std::ostringstream
+#include <string>
+#include <thread>
+
+#include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // socket(), connect()
+#include <unistd.h>     // close(), write()
+
+
+namespace
+{
+    std::size_t body_size{ 64 * 1024 * 1024 };
+    
+    void write_all( int s, const std::string& data )
+    {
+        std::size_t written{ 0 };
+        while( written < data.size() )
+        {
+            auto result = write(
+                s,
+                data.data() + written,
+                data.size() - written
+            );
+            if( result < 1 )
+                return;
+            written += static_cast< std::size_t >( result );
+        }
+    }
+    
+    // Sends one request, chunked if `chunk_size` isn't 0
+    void client( int port, std::size_t chunk_size )
+    {
+        auto s = socket( AF_INET, SOCK_STREAM, 0 );
+        sockaddr_in address{};
+        address.sin_family      = AF_INET;
+        address.sin_port        = htons( static_cast< uint16_t >( port ) );
+        address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        if( connect(
+            s,
+            reinterpret_cast< sockaddr* >( &address ),
+            sizeof( address )
+        ) == -1 )
+        {
+            std::cerr << "could not connect to test server\n";
+            return;
+        }
+        
+        std::string piece( chunk_size ? chunk_size : 1024 * 1024, 'x' );
+        if( chunk_size )
+        {
+            write_all(
+                s,
+                "PUT / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+            );
+            
+            // Batch up the chunks so the client's writes aren't what's timed
+            std::ostringstream chunk;
+            chunk << std::hex << chunk_size << "\r\n" << piece << "\r\n";
+            std::string batch;
+            while( batch.size() < 1024 * 1024 )
+                batch += chunk.str();
+            auto chunks_per_batch = batch.size() / chunk.str().size();
+            
+            for(
+                std::size_t sent = 0;
+                sent < body_size;
+                sent += chunks_per_batch * chunk_size
+            )
+                write_all( s, batch );
+            write_all( s, "0\r\n\r\n" );
+        }
+        else
+        {
+            write_all(
+                s,
+                "PUT / HTTP/1.1\r\nContent-Length: "
+                + std::to_string( body_size )
+                + "\r\n\r\n"
+            );
+            for( std::size_t sent = 0; sent < body_size; sent += piece.size() )
+                write_all( s, piece );
+        }
+        
+        close( s );
+    }
+    
+    void run(
+        const std::string& name,
+        show::server&      test_server,
+        std::size_t        chunk_size
+    )
+    {
+        std::thread client_thread{ client, test_server.port(), chunk_size };
+        auto connection = test_server.serve();
+        connection.buffer_size( 64 * 1024 );
+        
+        auto start = std::chrono::steady_clock::now();
+        show::request request{ connection };
+        static char buffer[ 256 * 1024 ];
+        std::size_t received{ 0 };
+        while( !request.eof() )
+        {
+            auto got = request.sgetn( buffer, sizeof( buffer ) );
+            if( got < 1 )
+                break;
+            received += static_cast< std::size_t >( got );
+        }
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        client_thread.join();
+        
+        std::cout
+            << "    "
+            << std::setw( 16 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( received / elapsed / ( 1024 * 1024 ) )
+            << " MiB/s  ("
+            << received
+            << " bytes)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    if( argc > 1 )
+        body_size = std::stoul( argv[ 1 ] ) * 1024 * 1024;
+    
+    show::server test_server{ "0.0.0.0", 9090, 5 };
+    
+    run( "Content-Length", test_server, 0          );
+    run( "256 KiB chunks", test_server, 256 * 1024 );
+    run( "16 KiB chunks" , test_server,  16 * 1024 );
+    run( "1 KiB chunks"  , test_server,       1024 );
+    run( "64 byte chunks", test_server,         64 );
+    
+    return 0;
+}
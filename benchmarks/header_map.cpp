@@ -0,0 +1,124 @@
+// Compares `show::header_map` against `show::headers_type` for building a
+// typical request's headers and looking up the ones a server usually checks,
+// both well-known names and custom ones
+
+
+#include <show.hpp>
+
+#include <chrono>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <string>
+#include <utility>      // std::pair<>
+#include <vector>
+
+
+namespace
+{
+    // Roughly what a browser sends, plus a couple of application headers
+    const std::vector< std::pair< std::string, std::string > > fields{
+        { "Host"              , "www.example.com"                          },
+        { "User-Agent"        , "Mozilla/5.0 (X11; Linux x86_64; rv:68.0)" },
+        { "Accept"            , "text/html,application/xhtml+xml"          },
+        { "Accept-Language"   , "en-US,en;q=0.5"                           },
+        { "Accept-Encoding"   , "gzip, deflate, br"                        },
+        { "Connection"        , "keep-alive"                               },
+        { "Cookie"            , "session=0123456789abcdef"                 },
+        { "Cache-Control"     , "max-age=0"                                },
+        { "X-Requested-With"  , "XMLHttpRequest"                           },
+        { "X-Forwarded-For"   , "203.0.113.7"                              },
+        { "Content-Type"      , "application/json"                         },
+        { "Content-Length"    , "1024"                                     }
+    };
+    
+    const std::vector< std::string > lookups{
+        "content-length",
+        "transfer-encoding",
+        "connection",
+        "host",
+        "x-forwarded-for"
+    };
+    
+    template< typename Function > void run(
+        const std::string& name,
+        Function           function,
+        std::size_t        iterations
+    )
+    {
+        std::size_t found{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t i = 0; i < iterations; ++i )
+            found += function();
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        std::cout
+            << "    "
+            << std::setw( 14 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( elapsed / iterations * 1000000000.0 )
+            << " ns  ("
+            << found / iterations
+            << " found)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t iterations{ 1000000 };
+    if( argc > 1 )
+        iterations = std::stoul( argv[ 1 ] );
+    
+    show::headers_type headers;
+    show::header_map   map;
+    for( const auto& field : fields )
+    {
+        headers[ field.first ].push_back( field.second );
+        map.add( field.first, field.second );
+    }
+    
+    // Each returns a count so the work isn't optimized out
+    std::cout << "build (" << fields.size() << " fields):\n";
+    run( "headers_type", [](){
+        show::headers_type h;
+        for( const auto& field : fields )
+            h[ field.first ].push_back( field.second );
+        return h.size();
+    }, iterations );
+    run( "header_map", [](){
+        show::header_map h;
+        h.reserve( fields.size() );
+        for( const auto& field : fields )
+            h.add( field.first, field.second );
+        return h.size();
+    }, iterations );
+    
+    std::cout << "lookup (" << lookups.size() << " names):\n";
+    run( "headers_type", [ &headers ](){
+        std::size_t found{ 0 };
+        for( const auto& name : lookups )
+            found += headers.count( name );
+        return found;
+    }, iterations );
+    run( "header_map", [ &map ](){
+        std::size_t found{ 0 };
+        for( const auto& name : lookups )
+            found += map.count( name );
+        return found;
+    }, iterations );
+    run( "header_map ID", [ &map ](){
+        return (
+              map.count( show::header_id::CONTENT_LENGTH    )
+            + map.count( show::header_id::TRANSFER_ENCODING )
+            + map.count( show::header_id::CONNECTION        )
+            + map.count( show::header_id::HOST              )
+            + map.count( "x-forwarded-for"                  )
+        );
+    }, iterations );
+    
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Measures how fast `show::multipart` splits a file upload into segments, both
+// when the whole body is available at once and when the source only hands out
+// a connection buffer's worth at a time, and how fast it gets through a form
+// with many small fields, where the per-segment overhead dominates
+
+
+#include <show/multipart.hpp>
+
+#include <chrono>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <sstream>      // std::stringbuf
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    const std::string boundary{ "----WebKitFormBoundary7MA4YWxkTrZu0gW" };
+    
+    // Like a `show::request`, only has as much available as a typical read
+    // from a socket
+    class chunked_buffer : public std::streambuf
+    {
+    public:
+        chunked_buffer( const std::string& content, std::size_t chunk_size ) :
+            _content   { content    },
+            _chunk_size{ chunk_size },
+            _position  { 0          }
+        {}
+    
+    protected:
+        const std::string& _content;
+        std::size_t        _chunk_size;
+        std::size_t        _position;
+        
+        virtual int_type underflow()
+        {
+            _position += static_cast< std::size_t >( egptr() - eback() );
+            if( _position >= _content.size() )
+                return traits_type::eof();
+            
+            auto end = _position + _chunk_size;
+            if( end > _content.size() )
+                end = _content.size();
+            
+            // Non-cost std::string::data() only available in C++17
+            auto data = const_cast< char* >( _content.data() );
+            setg( data + _position, data + _position, data + end );
+            return traits_type::to_int_type( *gptr() );
+        }
+    };
+    
+    // Returns the total segment content size so the work isn't optimized out
+    std::size_t parse( std::streambuf& body, std::size_t& segment_count )
+    {
+        std::size_t content_size{ 0 };
+        std::vector< char > read_buffer( 64 * 1024 );
+        
+        show::multipart parser{ body, boundary };
+        for( auto& segment : parser )
+        {
+            ++segment_count;
+            std::streamsize read;
+            do
+            {
+                read = segment.sgetn(
+                    read_buffer.data(),
+                    static_cast< std::streamsize >( read_buffer.size() )
+                );
+                content_size += static_cast< std::size_t >( read );
+            } while( read > 0 );
+        }
+        
+        return content_size;
+    }
+    
+    void run(
+        const std::string& name,
+        const std::string& body,
+        std::size_t        chunk_size,
+        std::size_t        iterations
+    )
+    {
+        std::size_t content_size { 0 };
+        std::size_t segment_count{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t i = 0; i < iterations; ++i )
+            if( chunk_size )
+            {
+                chunked_buffer source{ body, chunk_size };
+                content_size += parse( source, segment_count );
+            }
+            else
+            {
+                std::stringbuf source{ body, std::ios::in };
+                content_size += parse( source, segment_count );
+            }
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        std::cout
+            << "    "
+            << std::setw( 14 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( body.size() * iterations / elapsed / 1048576.0 )
+            << " MiB/s"
+            << std::setw( 12 )
+            << ( segment_count / elapsed )
+            << " segments/s  ("
+            << content_size / iterations
+            << " bytes of content)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t iterations{ 20 };
+    if( argc > 1 )
+        iterations = std::stoul( argv[ 1 ] );
+    
+    // Pseudo-random binary "file" with the occasional line break and dash so
+    // partial delimiter matches happen now and then
+    std::string file;
+    for( std::size_t i = 0; i < 16 * 1024 * 1024; ++i )
+    {
+        auto c = static_cast< char >( i * 2654435761u >> 24 );
+        file += i % 997 == 0 ? '\n' : i % 997 == 1 ? '-' : c;
+    }
+    
+    std::string upload{
+        "--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"description\"\r\n"
+        "\r\n"
+        "A large binary file\r\n"
+        "--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "\r\n"
+        + file + "\r\n"
+        "--" + boundary + "--\r\n"
+    };
+    
+    std::string form;
+    for( std::size_t i = 0; i < 50000; ++i )
+        form += (
+            "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"field-"
+            + std::to_string( i ) + "\"\r\n"
+            "\r\n"
+            "value " + std::to_string( i ) + "\r\n"
+        );
+    form += "--" + boundary + "--\r\n";
+    
+    std::cout << "16 MiB file upload:\n";
+    run( "whole body"  , upload, 0    , iterations );
+    run( "4 KiB reads" , upload, 4096 , iterations );
+    run( "64 KiB reads", upload, 65536, iterations );
+    
+    std::cout << "50000-field form:\n";
+    run( "whole body"  , form  , 0    , iterations );
+    run( "4 KiB reads" , form  , 4096 , iterations );
+    
+    return 0;
+}
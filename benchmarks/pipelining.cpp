@@ -0,0 +1,177 @@
+// Compares serving pipelined requests one at a time, where each response is
+// sent as soon as it's destroyed, against `connection::handle_pipelined()`
+// sending the responses to everything already received together
+
+
+#include <show.hpp>
+
+#include <chrono>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // socket(), connect()
+#include <unistd.h>     // close(), read(), write()
+
+
+namespace
+{
+    const std::string request_text{
+        "GET /hello HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "\r\n"
+    };
+    const std::string message{ "hello" };
+    
+    bool respond( show::connection& c )
+    {
+        show::request r{ c };
+        show::response{
+            c,
+            show::HTTP_1_1,
+            { 200, "OK" },
+            { { "Content-Length", { std::to_string( message.size() ) } } }
+        }.sputn(
+            message.data(),
+            static_cast< std::streamsize >( message.size() )
+        );
+        return true;
+    }
+    
+    // Sends `depth` requests at a time, waiting for all their responses
+    // before sending the next batch
+    void client(
+        int         port,
+        std::size_t depth,
+        std::size_t rounds,
+        std::size_t response_size
+    )
+    {
+        auto s = socket( AF_INET, SOCK_STREAM, 0 );
+        sockaddr_in address{};
+        address.sin_family      = AF_INET;
+        address.sin_port        = htons( static_cast< uint16_t >( port ) );
+        address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        if( connect(
+            s,
+            reinterpret_cast< sockaddr* >( &address ),
+            sizeof( address )
+        ) == -1 )
+        {
+            std::cerr << "could not connect to test server\n";
+            return;
+        }
+        
+        std::string batch;
+        for( std::size_t i = 0; i < depth; ++i )
+            batch += request_text;
+        
+        char buffer[ 64 * 1024 ];
+        for( std::size_t round = 0; round < rounds; ++round )
+        {
+            if( write( s, batch.data(), batch.size() ) == -1 )
+                break;
+            std::size_t received{ 0 };
+            while( received < depth * response_size )
+            {
+                auto got = read( s, buffer, sizeof( buffer ) );
+                if( got < 1 )
+                    break;
+                received += static_cast< std::size_t >( got );
+            }
+        }
+        
+        close( s );
+    }
+    
+    template< typename Serve > void run(
+        const std::string& name,
+        show::server&      test_server,
+        std::size_t        depth,
+        std::size_t        rounds,
+        std::size_t        response_size,
+        Serve              serve
+    )
+    {
+        std::thread client_thread{
+            client,
+            test_server.port(),
+            depth,
+            rounds,
+            response_size
+        };
+        // Big enough for a whole batch of requests or responses
+        auto connection = test_server.serve();
+        connection.buffer_size( 64 * 1024 );
+        
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t round = 0; round < rounds; ++round )
+            serve( connection );
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        client_thread.join();
+        
+        std::cout
+            << "    "
+            << std::setw( 16 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( elapsed / ( depth * rounds ) * 1000000000.0 )
+            << " ns/request\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t requests{ 1000 };
+    if( argc > 1 )
+        requests = std::stoul( argv[ 1 ] );
+    
+    show::server test_server{ "0.0.0.0", 9090, 5 };
+    
+    std::string response_text{
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: " + std::to_string( message.size() ) + "\r\n"
+        "\r\n"
+        + message
+    };
+    
+    for( std::size_t depth : { 1, 4, 16, 64 } )
+    {
+        std::cout << depth << " requests per batch:\n";
+        run(
+            "one at a time",
+            test_server,
+            depth,
+            requests / depth,
+            response_text.size(),
+            [ depth ]( show::connection& c ){
+                for( std::size_t i = 0; i < depth; ++i )
+                    respond( c );
+            }
+        );
+        run(
+            "handle_pipelined",
+            test_server,
+            depth,
+            requests / depth,
+            response_text.size(),
+            [ depth ]( show::connection& c ){
+                // The client may not have sent the whole batch yet
+                std::size_t handled{ 0 };
+                while( handled < depth )
+                    c.handle_pipelined( [ & ]( show::connection& c ){
+                        ++handled;
+                        return respond( c );
+                    } );
+            }
+        );
+    }
+    
+    return 0;
+}
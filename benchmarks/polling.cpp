@@ -0,0 +1,122 @@
+// Compares polling for connections & request data with the throwing API,
+// where every empty poll unwinds a `show::connection_timeout`, against the
+// `try_` versions that return a `show::io_status` instead
+
+
+#include <show.hpp>
+
+#include <chrono>
+#include <functional>   // std::function<>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // socket(), connect()
+#include <unistd.h>     // close()
+
+
+namespace
+{
+    // Returns how many polls found something so the work isn't optimized
+    // out; with nothing to find, that's always 0
+    using poll_type = std::function< std::size_t() >;
+    
+    void run(
+        const std::string& name,
+        const poll_type&   poll,
+        std::size_t        iterations
+    )
+    {
+        std::size_t found{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t i = 0; i < iterations; ++i )
+            found += poll();
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        std::cout
+            << "    "
+            << std::setw( 12 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( elapsed / iterations * 1000000000.0 )
+            << " ns/poll  ("
+            << found
+            << " found)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t iterations{ 200000 };
+    if( argc > 1 )
+        iterations = std::stoul( argv[ 1 ] );
+    
+    // Never waits, so every poll with nothing waiting times out
+    show::server test_server{ "0.0.0.0", 9090, 0 };
+    
+    std::vector< show::connection > accepted;
+    std::cout << "accept with no clients waiting:\n";
+    run( "throwing", [ & ]() -> std::size_t {
+        try
+        {
+            test_server.serve();
+            return 1;
+        }
+        catch( const show::connection_timeout& )
+        {
+            return 0;
+        }
+    }, iterations );
+    run( "try_", [ & ]() -> std::size_t {
+        return test_server.try_serve( accepted ) == show::io_status::SUCCESS;
+    }, iterations );
+    
+    // An idle client connection
+    auto client = socket( AF_INET, SOCK_STREAM, 0 );
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons( 9090 );
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    if( connect(
+        client,
+        reinterpret_cast< sockaddr* >( &address ),
+        sizeof( address )
+    ) == -1 )
+    {
+        std::cerr << "could not connect to test server\n";
+        return 1;
+    }
+    
+    auto connection = test_server.serve();
+    connection.timeout( 0 );
+    char buffer[ 1024 ];
+    
+    std::cout << "read with no data waiting:\n";
+    run( "throwing", [ & ]() -> std::size_t {
+        try
+        {
+            return connection.sgetn( buffer, sizeof( buffer ) ) > 0;
+        }
+        catch( const show::connection_timeout& )
+        {
+            return 0;
+        }
+    }, iterations );
+    run( "try_", [ & ]() -> std::size_t {
+        std::streamsize bytes_read;
+        return connection.try_read(
+            buffer,
+            sizeof( buffer ),
+            bytes_read
+        ) == show::io_status::SUCCESS;
+    }, iterations );
+    
+    close( client );
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Compares `show::timer_wheel` against an ordered set of deadlines (which is
+// what a min-heap with cancellation amounts to) for an event loop's pattern of
+// use: most connections push their deadline back on every event, and every
+// so often a large batch of them expires in the same tick
+
+
+#include <show/timer_wheel.hpp>
+
+#include <chrono>
+#include <cstdint>      // std::uint64_t
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>      // std::pair
+#include <vector>
+
+
+namespace
+{
+    class set_timers
+    {
+    public:
+        void schedule( std::size_t key, std::uint64_t deadline )
+        {
+            if( key >= _deadlines.size() )
+                _deadlines.resize( key + 1, 0 );
+            if( _deadlines[ key ] )
+                _timers.erase( { _deadlines[ key ], key } );
+            _deadlines[ key ] = deadline;
+            _timers.insert( { deadline, key } );
+        }
+        
+        template< typename Function > std::size_t advance(
+            std::uint64_t now,
+            Function      expire
+        )
+        {
+            std::size_t expired{ 0 };
+            while( !_timers.empty() && _timers.begin() -> first <= now )
+            {
+                auto key = _timers.begin() -> second;
+                _timers.erase( _timers.begin() );
+                _deadlines[ key ] = 0;
+                ++expired;
+                expire( key );
+            }
+            return expired;
+        }
+    
+    protected:
+        std::set< std::pair< std::uint64_t, std::size_t > > _timers;
+        std::vector< std::uint64_t > _deadlines;
+    };
+    
+    // Each millisecond, `active` connections get an event and push their
+    // deadline back; the rest all connect in the same tick, go idle, & expire
+    // together, then connect again.  Returns the number of timers scheduled
+    // and expired so the work isn't optimized out.
+    template< typename Timers > std::size_t simulate(
+        std::size_t  connections,
+        std::size_t  active,
+        std::size_t  milliseconds,
+        std::size_t& expired
+    )
+    {
+        const std::uint64_t timeout{ 250 };
+        Timers      timers;
+        std::size_t scheduled{ 0 };
+        
+        for( std::uint64_t now = 1; now <= milliseconds; ++now )
+        {
+            if( now % ( timeout * 2 ) == 1 )
+                for( std::size_t key = active; key < connections; ++key )
+                {
+                    timers.schedule( key, now + timeout );
+                    ++scheduled;
+                }
+            for( std::size_t key = 0; key < active; ++key )
+            {
+                timers.schedule( key, now + timeout );
+                ++scheduled;
+            }
+            expired += timers.advance( now, []( std::size_t ){} );
+        }
+        
+        return scheduled;
+    }
+    
+    template< typename Timers > void run(
+        const std::string& name,
+        std::size_t        connections,
+        std::size_t        active,
+        std::size_t        milliseconds
+    )
+    {
+        std::size_t expired{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        auto scheduled = simulate< Timers >(
+            connections,
+            active,
+            milliseconds,
+            expired
+        );
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        auto operations = scheduled + expired;
+        std::cout
+            << "    "
+            << std::setw( 12 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( elapsed / operations * 1000000000.0 )
+            << " ns/operation  ("
+            << expired
+            << " expired)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t milliseconds{ 10000 };
+    if( argc > 1 )
+        milliseconds = std::stoul( argv[ 1 ] );
+    
+    for( std::size_t connections : { 1000, 10000, 100000 } )
+    {
+        auto active = connections / 100;
+        std::cout
+            << connections
+            << " connections, "
+            << active
+            << " active:\n"
+        ;
+        run< show::timer_wheel >(
+            "timer wheel",
+            connections,
+            active,
+            milliseconds
+        );
+        run< set_timers >( "std::set", connections, active, milliseconds );
+    }
+    
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Compares the table-driven URL codecs against the stream- and `std::stoi()`-
+// based implementations they replaced, using inputs typical of request paths
+// and query arguments
+
+
+#include <show.hpp>
+
+#include <chrono>
+#include <functional>   // std::function<>
+#include <iomanip>      // std::setw()
+#include <iostream>
+#include <sstream>      // std::stringstream
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    const std::vector< std::pair< std::string, std::string > > inputs{
+        { "path segment", "simple-header-only-webserver"                    },
+        { "query value" , "how do I serve files? (with \"sendfile\") & more" },
+        { "UTF-8 text"  , "こんにちは皆様、丹羽さんの庭には二羽鶏がいる"   }
+    };
+    
+    std::string stream_url_encode( const std::string& o )
+    {
+        std::stringstream encoded;
+        encoded << std::hex;
+        for( auto c : o )
+        {
+            if( c == ' ' )
+                encoded << '+';
+            else if (
+                   ( c >= 'A' && c <= 'Z' )
+                || ( c >= 'a' && c <= 'z' )
+                || ( c >= '0' && c <= '9' )
+                || c == '-'
+                || c == '_'
+                || c == '.'
+                || c == '~'
+            )
+                encoded << c;
+            else
+                encoded
+                    << '%'
+                    << std::uppercase
+                    << std::setfill( '0' )
+                    << std::setw( 2 )
+                    << static_cast< unsigned int >(
+                        static_cast< unsigned char >( c )
+                    )
+                    << std::nouppercase
+                ;
+        }
+        return encoded.str();
+    }
+    
+    std::string stoi_url_decode( const std::string& o )
+    {
+        std::string decoded;
+        std::string hex_convert_space{ "00" };
+        for( std::string::size_type i = 0; i < o.size(); ++i )
+        {
+            if( o[ i ] == '%' )
+            {
+                hex_convert_space[ 0 ] = o[ i + 1 ];
+                hex_convert_space[ 1 ] = o[ i + 2 ];
+                std::size_t convert_stopped;
+                decoded += static_cast< char >( std::stoi(
+                    hex_convert_space,
+                    &convert_stopped,
+                    16
+                ) );
+                i += 2;
+            }
+            else if( o[ i ] == '+' )
+                decoded += ' ';
+            else
+                decoded += o[ i ];
+        }
+        return decoded;
+    }
+    
+    // Each returns the output size so the work isn't optimized out
+    using codec_type = std::function< std::size_t( const std::string& ) >;
+    
+    void run(
+        const std::string& name,
+        const codec_type&  codec,
+        const std::string& input,
+        std::size_t        iterations
+    )
+    {
+        std::size_t output_size{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for( std::size_t i = 0; i < iterations; ++i )
+            output_size += codec( input );
+        auto elapsed = std::chrono::duration_cast<
+            std::chrono::duration< double >
+        >( std::chrono::steady_clock::now() - start ).count();
+        
+        std::cout
+            << "    "
+            << std::setw( 16 ) << std::left << name
+            << std::setw( 10 ) << std::right << std::fixed
+            << std::setprecision( 1 )
+            << ( elapsed / iterations * 1000000000.0 )
+            << " ns  ("
+            << output_size / iterations
+            << " bytes out)\n"
+        ;
+    }
+}
+
+
+int main( int argc, char* argv[] )
+{
+    std::size_t iterations{ 1000000 };
+    if( argc > 1 )
+        iterations = std::stoul( argv[ 1 ] );
+    
+    std::vector< char > buffer;
+    
+    std::vector< std::pair< std::string, codec_type > > encoders{
+        { "stream", []( const std::string& s ){
+            return stream_url_encode( s ).size();
+        } },
+        { "table", []( const std::string& s ){
+            return show::url_encode( s ).size();
+        } },
+        { "table (buffer)", [ &buffer ]( const std::string& s ){
+            return show::url_encode( s.data(), s.size(), buffer.data() );
+        } }
+    };
+    std::vector< std::pair< std::string, codec_type > > decoders{
+        { "stoi", []( const std::string& s ){
+            return stoi_url_decode( s ).size();
+        } },
+        { "table", []( const std::string& s ){
+            return show::url_decode( s ).size();
+        } },
+        { "table (buffer)", [ &buffer ]( const std::string& s ){
+            std::size_t size;
+            show::url_decode( s.data(), s.size(), buffer.data(), size );
+            return size;
+        } }
+    };
+    
+    for( const auto& input : inputs )
+    {
+        auto encoded = show::url_encode( input.second );
+        buffer.resize( input.second.size() * 3 );
+        
+        std::cout
+            << input.first
+            << " ("
+            << input.second.size()
+            << " bytes, "
+            << encoded.size()
+            << " encoded):\n  encode:\n"
+        ;
+        for( const auto& encoder : encoders )
+            run( encoder.first, encoder.second, input.second, iterations );
+        
+        std::cout << "  decode:\n";
+        for( const auto& decoder : decoders )
+            run( decoder.first, decoder.second, encoded, iterations );
+    }
+    
+    return 0;
+}
@@ -1,12 +1,15 @@
 #include <show.hpp>
 
 #include <exception>    // std::runtime_error
-#include <fstream>      // std::ifstream
 #include <iostream>     // std::cout, std::cerr
 #include <map>          // std::map
 #include <sstream>      // std::stringstream
 #include <string>       // std::string, std::to_string()
 
+#include <fcntl.h>      // open()
+#include <sys/stat.h>   // stat, fstat()
+#include <unistd.h>     // close()
+
 
 // Set a Server header to display the SHOW version
 const show::headers_type::value_type server_header{
@@ -277,22 +280,22 @@ void handle_GET_request(
             else
                 download = false;
             
-            // Open the file in binary input mode, with the cursor starting at
-            // the end so we can get the file size
-            std::ifstream file{
-                full_path_string,
-                std::ios::binary | std::ios::in | std::ios::ate
-            };
-            
-            if( !file.is_open() )
+            // Open the file as a plain descriptor so its contents can be
+            // handed straight to the socket
+            int file{ open( full_path_string.c_str(), O_RDONLY | O_CLOEXEC ) };
+            if( file == -1 )
                 throw no_such_path{};
-            else
+            
+            struct stat stat_info;
+            if( fstat( file, &stat_info ) )
             {
-                // Get the position of the cursor, which will be the file size
-                std::streamsize remaining{ file.tellg() };
-                // Return the cursor to the beginning of the file for reading
-                file.seekg( 0, std::ios::beg );
+                close( file );
+                throw no_such_path{};
+            }
+            auto remaining = static_cast< std::size_t >( stat_info.st_size );
             
+            try
+            {
                 show::response response{
                     request.connection(),
                     show::http_protocol::HTTP_1_0,
@@ -311,14 +314,17 @@ void handle_GET_request(
                     }
                 };
                 
-                // Read & return the file in kilobyte-sized chunks until less
-                // than a kilobyte is left (reading another kilobyte will fail),
-                // then read & return what's left in the file
-                char buffer[ 1024 ];
-                while( file.read( buffer, sizeof( buffer ) ) )
-                    response.sputn( buffer, sizeof( buffer ) );
-                response.sputn( buffer, file.gcount() );
+                // Send the whole file after the headers; on Linux the data
+                // is moved from the file to the socket without ever being
+                // copied into the program
+                response.send_file( file, 0, remaining );
+            }
+            catch( ... )
+            {
+                close( file );
+                throw;
             }
+            close( file );
         }
     }
     catch( const no_such_path& e )
@@ -2,108 +2,116 @@
 
 #include <iostream> // std::cout
 #include <string>   // std::string, std::to_string()
+#include <utility>  // std::move()
+#include <vector>   // std::vector
+
+
+// Responds to one request, returning whether to keep the connection open
+bool handle_request( show::connection& connection )
+{
+    show::request request{ connection };
+    
+    std::cout
+        << "serving a "
+        << request.method()
+        << " request for client "
+        << request.client_address()
+        << std::endl
+    ;
+    
+    // Flush out the request contents, as otherwise they'll still be sitting in
+    // the connection when we look for another request.  If content was sent
+    // but there was no Content-Length header set (and it wasn't chunked), the
+    // request object constructor will choke & throw an exception (which in a
+    // real server you'd want to catch & return as a 400).
+    if( !request.unknown_content_length() || request.chunked() )
+        request.flush();
+    
+    auto is_1p1 = request.protocol() == show::HTTP_1_1;
+    
+    std::string message{
+        "HTTP/"
+        + std::string{ is_1p1 ? "1.1" : "1.0" }
+        + " "
+        + request.method()
+        + " request from "
+        + request.client_address()
+        + " on path /"
+    };
+    for( auto& segment : request.path() )
+    {
+        message += segment;
+        message += "/";
+    }
+    
+    show::headers_type headers{
+        // Set the Server header to display the SHOW version
+        { "Server", {
+            show::version::name
+            + " v"
+            + show::version::string
+        } },
+        // The message is simple plain text
+        { "Content-Type", { "text/plain" } },
+        { "Content-Length", {
+            // Header values must be strings
+            std::to_string( message.size() )
+        } }
+    };
+    
+    show::response response{
+        request.connection(),
+        is_1p1 ? show::HTTP_1_1 : show::HTTP_1_0,
+        { 200, "OK" },
+        headers
+    };
+    
+    response.sputn( message.c_str(), message.size() );
+    
+    // HTTP/1.0 "supports" persistent connections with the "Connection" header;
+    // this example defers to this header's value (if it exists) before
+    // checking the protocol version.
+    auto connection_header = request.headers().find( "Connection" );
+    if(
+        connection_header != request.headers().end()
+        && connection_header -> second.size() == 1
+    )
+    {
+        auto& header_val = connection_header -> second[ 0 ];
+        if( header_val == "keep-alive" )
+            // Keep connection open, go on to next request
+            return true;
+        else if( header_val == "close" )
+            // Close connection
+            return false;
+        // else fall back to this protocol's default connection behavior:
+        //   <  HTTP/1.0 : close connection
+        //   >= HTTP/1.1 : keep connection open
+    }
+    
+    // HTTP/1.1+ defaults to keep-alive
+    return request.protocol() > show::HTTP_1_0;
+}
 
 
 void handle_connection( show::connection& connection )
 {
-    while( true )   // Loop over requests on this connection
-        try
-        {
-            show::request request{ connection };
-            
-            std::cout
-                << "serving a "
-                << request.method()
-                << " request for client "
-                << request.client_address()
-                << std::endl
-            ;
-            
-            // Flush out the request contents, as otherwise they'll still be
-            // sitting in the connection when we look for another request.  If
-            // content was sent but there was no Content-Length header set, the
-            // request object constructor will choke & throw an exception (which
-            // in a real server you'd want to catch & return as a 400).
-            if( !request.unknown_content_length() )
-                request.flush();
-            
-            auto is_1p1 = request.protocol() == show::HTTP_1_1;
-            
-            std::string message{
-                "HTTP/"
-                + std::string{ is_1p1 ? "1.1" : "1.0" }
-                + " "
-                + request.method()
-                + " request from "
-                + request.client_address()
-                + " on path /"
-            };
-            for( auto& segment : request.path() )
-            {
-                message += segment;
-                message += "/";
-            }
-            
-            show::headers_type headers{
-                // Set the Server header to display the SHOW version
-                { "Server", {
-                    show::version::name
-                    + " v"
-                    + show::version::string
-                } },
-                // The message is simple plain text
-                { "Content-Type", { "text/plain" } },
-                { "Content-Length", {
-                    // Header values must be strings
-                    std::to_string( message.size() )
-                } }
-            };
-            
-            show::response response{
-                request.connection(),
-                is_1p1 ? show::HTTP_1_1 : show::HTTP_1_0,
-                { 200, "OK" },
-                headers
-            };
-            
-            response.sputn( message.c_str(), message.size() );
-            
-            // HTTP/1.0 "supports" persistent connections with the "Connection"
-            // header; this example defers to this header's value (if it exists)
-            // before checking the protocol version.
-            auto connection_header = request.headers().find( "Connection" );
-            if(
-                connection_header != request.headers().end()
-                && connection_header -> second.size() == 1
-            )
-            {
-                auto& header_val = connection_header -> second[ 0 ];
-                if( header_val == "keep-alive" )
-                    // Keep connection open, loop to next request
-                    continue;
-                else if( header_val == "close" )
-                    // Close connection
-                    break;
-                // else fall back to this protocol's default
-                // connection behavior:
-                //   <  HTTP/1.0 : close connection
-                //   >= HTTP/1.1 : keep connection open
-            }
-            
-            if( request.protocol() <= show::HTTP_1_0 )
-                break;
-            // else continue (HTTP/1.1+ defaults to keep-alive)
-        }
-        catch( const show::connection_interrupted& ct )
-        {
-            std::cout
-                << "client "
-                << connection.client_address()
-                << " disconnected or timed out, closing connection"
-                << std::endl
-            ;
-            break;
-        }
+    // Clients may send several requests without waiting for the responses
+    // ("pipelining"); this handles all of them that have already arrived
+    // before sending their responses back together
+    try
+    {
+        while( connection.handle_pipelined( handle_request ) );
+    }
+    catch( const show::connection_interrupted& ct )
+    {
+        std::cout
+            << "client "
+            << connection.client_address()
+            << " disconnected or timed out, closing connection"
+            << std::endl
+        ;
+    }
 }
 
 
@@ -119,27 +127,33 @@ int main( int argc, char* argv[] )
         timeout
     };
     
+    // Waiting for a connection times out routinely, so this uses the version
+    // of `serve()` that reports that by returning a status rather than by
+    // throwing an exception
+    std::vector< show::connection > accepted;
     while( true )   // Loop over connections
-        try
-        {
-            show::connection connection{ test_server.serve() };
-            
-            std::cout
-                << "client "
-                << connection.client_address()
-                << " connected"
-                << std::endl
-            ;
-            
-            handle_connection( connection );
-        }
-        catch( const show::connection_timeout& ct )
+    {
+        if( test_server.try_serve( accepted ) != show::io_status::SUCCESS )
         {
             std::cout
                 << "timed out waiting for connection, looping..."
                 << std::endl
             ;
+            continue;
         }
+        
+        show::connection connection{ std::move( accepted.back() ) };
+        accepted.clear();
+        
+        std::cout
+            << "client "
+            << connection.client_address()
+            << " connected"
+            << std::endl
+        ;
+        
+        handle_connection( connection );
+    }
     
     return 0;
 }
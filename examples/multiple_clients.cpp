@@ -3,6 +3,8 @@
 #include <iostream> // std::cout, std::cerr
 #include <list>     // std::list
 #include <thread>   // std::thread
+#include <utility>  // std::move()
+#include <vector>   // std::vector
 
 
 // Set a Server header to display the SHOW version
@@ -85,22 +87,26 @@ int main( int argc, char* argv[] )
         timeout
     };
     
+    // See the HTTP/1.1 example for why this uses `try_serve()`
+    std::vector< show::connection > accepted;
     while( true )
-        try
-        {
-            std::thread worker{
-                handle_connection,
-                test_server.serve()
-            };
-            worker.detach();
-        }
-        catch( const show::connection_timeout& ct )
+    {
+        if( test_server.try_serve( accepted ) != show::io_status::SUCCESS )
         {
             std::cout
                 << "timed out waiting for connection, looping..."
                 << std::endl
             ;
+            continue;
         }
+        
+        std::thread worker{
+            handle_connection,
+            std::move( accepted.back() )
+        };
+        accepted.clear();
+        worker.detach();
+    }
     
     return 0;
 }
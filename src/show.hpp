@@ -5,26 +5,46 @@
 
 #include <algorithm>  // std::copy
 #include <array>
+#include <atomic>
+#include <cstdint>    // std::uint64_t
 #include <cstring>
+#include <deque>
 #include <exception>
 #include <iomanip>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stack>
+#include <stdexcept>
 #include <streambuf>
+#include <type_traits>  // std::enable_if<>, std::is_same<>
+#include <unordered_map>
 #include <vector>
 #include <utility>  // std::swap
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <limits.h>   // INT_MAX, IOV_MAX
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <stdio.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#if defined( __linux__ )
+#include <sys/sendfile.h>
+#endif
+
+// The header tokenizer can use SSE4.2 or AVX2, selected at runtime, so these
+// are compiled with per-function target attributes rather than global flags
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define SHOW_X86_SIMD
+#include <immintrin.h>
+#endif
+
 
 namespace show // Constants ////////////////////////////////////////////////////
 {
@@ -72,46 +92,117 @@ namespace show // Basic types //////////////////////////////////////////////////
             c &= ~0x20;
         return c;
     }
+    
+    // Case folding & comparison work on eight characters at a time packed
+    // into an integer ("SWAR"), as header names are usually too short for
+    // vector instructions to pay off
+    using _ASCII_word = std::uint64_t;
+    
+    inline _ASCII_word _load_ASCII_word( const char* s )
+    {
+        _ASCII_word word;
+        std::memcpy( &word, s, sizeof( word ) );
+        return word;
+    }
+    
+    inline _ASCII_word _ASCII_upper( _ASCII_word word )
+    {
+        const _ASCII_word ones     { 0x0101010101010101ull };
+        const _ASCII_word high_bits{ 0x8080808080808080ull };
+        
+        // With each byte's high bit cleared these additions can't carry into
+        // the next byte, and each sets the high bit of the bytes that are
+        // >= 'a' or > 'z' respectively
+        auto low_bits        = word & ~high_bits;
+        auto from_a          = low_bits + ( 0x80 - 'a' ) * ones;
+        auto past_z          = low_bits + ( 0x7F - 'z' ) * ones;
+        auto lowercase_ASCII = ( from_a ^ past_z ) & ~word & high_bits;
+        
+        // Moves each lowercase letter's high bit to 0x20, the case bit
+        return word ^ ( lowercase_ASCII >> 2 );
+    }
+    
+    inline void _ASCII_upper_in_place( char* s, std::size_t size )
+    {
+        std::size_t i{ 0 };
+        for( ; i + sizeof( _ASCII_word ) <= size; i += sizeof( _ASCII_word ) )
+        {
+            auto word = _ASCII_upper( _load_ASCII_word( s + i ) );
+            std::memcpy( s + i, &word, sizeof( word ) );
+        }
+        for( ; i < size; ++i )
+            s[ i ] = _ASCII_upper( s[ i ] );
+    }
+    
     inline std::string _ASCII_upper( std::string s )
     {
-        std::string out;
+        _ASCII_upper_in_place( &s[ 0 ], s.size() );
+        return s;
+    }
+    
+    // Three-way comparison ignoring ASCII case; characters are ordered as
+    // (uppercased) `char`s, so `headers_type`'s ordering is unchanged
+    inline int _compare_ignore_case_ASCII(
+        const char* lhs,
+        std::size_t lhs_size,
+        const char* rhs,
+        std::size_t rhs_size
+    )
+    {
+        auto min_size = lhs_size < rhs_size ? lhs_size : rhs_size;
+        
+        std::size_t i{ 0 };
         for(
-            std::string::size_type i{ 0 };
-            i < s.size();
-            ++i
+            ;
+            i + sizeof( _ASCII_word ) <= min_size;
+            i += sizeof( _ASCII_word )
         )
-            out += _ASCII_upper( s[ i ] );
-        return out;
+        {
+            auto lhw = _load_ASCII_word( lhs + i );
+            auto rhw = _load_ASCII_word( rhs + i );
+            if( lhw == rhw )
+                continue;
+            lhw = _ASCII_upper( lhw );
+            rhw = _ASCII_upper( rhw );
+            if( lhw == rhw )
+                continue;
+#if defined( __GNUC__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            // The lowest set bit of the difference is in the first character
+            // that differs
+            auto shift = __builtin_ctzll( lhw ^ rhw ) & ~7;
+            auto lhc   = static_cast< char >( lhw >> shift );
+            auto rhc   = static_cast< char >( rhw >> shift );
+            return lhc < rhc ? -1 : 1;
+#else
+            break;
+#endif
+        }
+        
+        // Either the remaining characters are less than a word, or this finds
+        // which character in the mismatched word differs
+        for( ; i < min_size; ++i )
+        {
+            auto lhc = _ASCII_upper( lhs[ i ] );
+            auto rhc = _ASCII_upper( rhs[ i ] );
+            if( lhc != rhc )
+                return lhc < rhc ? -1 : 1;
+        }
+        
+        if( lhs_size == rhs_size )
+            return 0;
+        return lhs_size < rhs_size ? -1 : 1;
     }
     
     struct _less_ignore_case_ASCII
     {
         bool operator()( const std::string& lhs, const std::string& rhs ) const
         {
-            // This is probably faster than using a pair of
-            // `std::string::iterator`s
-            
-            std::string::size_type min_len{
-                lhs.size() < rhs.size() ? lhs.size() : rhs.size()
-            };
-            
-            for(
-                std::string::size_type i = 0;
-                i < min_len;
-                ++i
-            )
-            {
-                auto lhc = _ASCII_upper( lhs[ i ] );
-                auto rhc = _ASCII_upper( rhs[ i ] );
-                
-                if( lhc < rhc )
-                    return true;
-                else if( lhc > rhc )
-                    return false;
-                // else continue
-            }
-            
-            return lhs.size() < rhs.size();
+            return _compare_ignore_case_ASCII(
+                lhs.data(),
+                lhs.size(),
+                rhs.data(),
+                rhs.size()
+            ) < 0;
         }
     };
     
@@ -120,22 +211,362 @@ namespace show // Basic types //////////////////////////////////////////////////
         std::vector< std::string >,
         _less_ignore_case_ASCII
     >;
+    
+    // Minimal non-owning string reference, as `std::string_view` is only
+    // available in C++17
+    class string_view
+    {
+    public:
+        using size_type      = std::size_t;
+        using const_iterator = const char*;
+        
+        static const size_type npos = static_cast< size_type >( -1 );
+        
+        string_view() : _data{ nullptr }, _size{ 0 } {}
+        string_view( const char* data, size_type size ) :
+            _data{ data },
+            _size{ size }
+        {}
+        string_view( const char* s ) :
+            _data{ s               },
+            _size{ std::strlen( s ) }
+        {}
+        string_view( const std::string& s ) :
+            _data{ s.data() },
+            _size{ s.size() }
+        {}
+        
+        const char*    data () const { return _data        ; }
+        size_type      size () const { return _size        ; }
+        bool           empty() const { return _size == 0   ; }
+        const_iterator begin() const { return _data        ; }
+        const_iterator end  () const { return _data + _size; }
+        
+        char operator []( size_type i ) const { return _data[ i ]; }
+        
+        std::string to_string() const { return std::string( _data, _size ); }
+        explicit operator std::string() const { return to_string(); }
+        
+        string_view substr( size_type pos, size_type count = npos ) const
+        {
+            if( pos > _size )
+                throw std::out_of_range{ "show::string_view::substr()" };
+            if( count > _size - pos )
+                count = _size - pos;
+            return { _data + pos, count };
+        }
+        
+        size_type find( char c, size_type pos = 0 ) const
+        {
+            if( pos >= _size )
+                return npos;
+            auto found = static_cast< const char* >(
+                std::memchr( _data + pos, c, _size - pos )
+            );
+            return found ? static_cast< size_type >( found - _data ) : npos;
+        }
+    
+    protected:
+        const char* _data;
+        size_type   _size;
+    };
+    
+    inline bool operator ==( string_view lhs, string_view rhs )
+    {
+        return (
+            lhs.size() == rhs.size()
+            && (
+                lhs.size() == 0
+                || std::memcmp( lhs.data(), rhs.data(), lhs.size() ) == 0
+            )
+        );
+    }
+    inline bool operator !=( string_view lhs, string_view rhs )
+    {
+        return !( lhs == rhs );
+    }
+    inline std::ostream& operator <<( std::ostream& out, string_view v )
+    {
+        return out.write( v.data(), v.size() );
+    }
+    
+    inline bool _equal_ignore_case_ASCII( string_view lhs, string_view rhs )
+    {
+        if( lhs.size() != rhs.size() )
+            return false;
+        std::size_t i{ 0 };
+        for(
+            ;
+            i + sizeof( _ASCII_word ) <= lhs.size();
+            i += sizeof( _ASCII_word )
+        )
+        {
+            auto lhw = _load_ASCII_word( lhs.data() + i );
+            auto rhw = _load_ASCII_word( rhs.data() + i );
+            if( lhw != rhw && _ASCII_upper( lhw ) != _ASCII_upper( rhw ) )
+                return false;
+        }
+        for( ; i < lhs.size(); ++i )
+            if( _ASCII_upper( lhs[ i ] ) != _ASCII_upper( rhs[ i ] ) )
+                return false;
+        return true;
+    }
+}
+
+
+namespace show // `show::header_map` class /////////////////////////////////////
+{
+    // Header names common enough to be recognized on sight; `header_map`
+    // indexes these by ID, so looking one up is an integer compare rather
+    // than a case-insensitive string compare
+    enum class header_id : std::uint8_t
+    {
+        UNKNOWN,
+        ACCEPT,
+        ACCEPT_ENCODING,
+        ACCEPT_LANGUAGE,
+        AUTHORIZATION,
+        CACHE_CONTROL,
+        CONNECTION,
+        CONTENT_DISPOSITION,
+        CONTENT_ENCODING,
+        CONTENT_LENGTH,
+        CONTENT_TYPE,
+        COOKIE,
+        DATE,
+        EXPECT,
+        HOST,
+        IF_MODIFIED_SINCE,
+        IF_NONE_MATCH,
+        KEEP_ALIVE,
+        LAST_MODIFIED,
+        LOCATION,
+        ORIGIN,
+        RANGE,
+        REFERER,
+        SERVER,
+        SET_COOKIE,
+        TRANSFER_ENCODING,
+        UPGRADE,
+        USER_AGENT      // Must stay last
+    };
+    
+    static const std::size_t _header_id_count{
+        static_cast< std::size_t >( header_id::USER_AGENT ) + 1
+    };
+    
+    // Canonical spelling of a known header name (empty for `UNKNOWN`), and
+    // the ID of a name if it's one of the known ones
+    string_view header_name   ( header_id   );
+    header_id   header_name_id( string_view );
+    
+    // A flat alternative to `headers_type`: values are kept in one vector in
+    // the order they were added, with known names indexed by ID and any
+    // others in an open-addressed table keyed on a precomputed
+    // case-insensitive hash.  Each value is a separate field, so a name that
+    // appears more than once is iterated over once per value.
+    class header_map
+    {
+    public:
+        struct field
+        {
+            std::string name;
+            std::string value;
+            header_id   id;
+        };
+    
+    protected:
+        struct _entry : field
+        {
+            std::uint32_t hash;
+            // Index of the next value with the same name
+            std::uint32_t next;
+        };
+    
+    public:
+        using const_iterator = std::vector< _entry >::const_iterator;
+        
+        header_map();
+        header_map( const headers_type& );
+        
+        // Adds a value for `name` after any it already has
+        void add( string_view name, string_view value );
+        void add( header_id   id  , string_view value );
+        // Replaces any values for `name` with `value`
+        void set( string_view name, string_view value );
+        void set( header_id   id  , string_view value );
+        // Returns the number of values removed
+        std::size_t erase( string_view name );
+        std::size_t erase( header_id   id   );
+        
+        std::size_t count( string_view name ) const;
+        std::size_t count( header_id   id   ) const;
+        // The first value for `name`, or an empty view if there are none
+        string_view get( string_view name ) const;
+        string_view get( header_id   id   ) const;
+        std::vector< string_view > get_all( string_view name ) const;
+        std::vector< string_view > get_all( header_id   id   ) const;
+        
+        // Total number of values, not of distinct names
+        std::size_t size () const { return _entries.size (); }
+        bool        empty() const { return _entries.empty(); }
+        void        clear();
+        void        reserve( std::size_t );
+        
+        const_iterator begin() const { return _entries.begin(); }
+        const_iterator end  () const { return _entries.end  (); }
+        
+        headers_type to_headers_type() const;
+    
+    protected:
+        enum : std::uint32_t { NO_ENTRY = 0xFFFFFFFF };
+        
+        std::vector< _entry >        _entries;
+        // First entry for each known name, indexed by ID
+        std::array<
+            std::uint32_t,
+            _header_id_count
+        >                            _known;
+        // First entry for each other name; the size is always a power of two
+        // and kept at least twice the number of names
+        std::vector< std::uint32_t > _unknown;
+        std::size_t                  _unknown_names;
+        
+        std::uint32_t _first    ( string_view name ) const;
+        std::uint32_t _first    ( header_id   id   ) const;
+        std::size_t   _find_slot( string_view name, std::uint32_t hash ) const;
+        void          _add      (
+            string_view   name,
+            std::uint32_t hash,
+            header_id     id,
+            string_view   value
+        );
+        void          _link     ( std::uint32_t entry );
+        std::size_t   _count    ( std::uint32_t first ) const;
+        std::size_t   _erase    ( std::uint32_t first );
+        std::vector< string_view > _values( std::uint32_t first ) const;
+    };
 }
 
 
 namespace show // Main classes /////////////////////////////////////////////////
 {
+    class buffer_pool;
     class _socket;
+    class header_parser;
     class connection;
     class server;
+    class _request_content;
     class request;
+    class request_view;
     class response;
     
+    // Recycles connection buffers, both to avoid allocator churn when serving
+    // many short-lived connections and to keep threads from contending on the
+    // global heap; each thread keeps its own free lists, falling back to a
+    // shared one
+    class buffer_pool
+    {
+    public:
+        struct stats_type
+        {
+            std::size_t hits;           // Acquired from a free list
+            std::size_t misses;         // Had to be newly allocated
+            std::size_t in_use;         // Acquired but not yet released
+            std::size_t peak_in_use;    // Highest `in_use` has been
+        };
+        
+        // Returns a buffer to the pool it came from, or frees it if it didn't
+        // come from a pool
+        class deleter
+        {
+        public:
+            deleter();
+            deleter( buffer_pool*, buffer_size_type );
+            
+            void operator ()( char* ) const;
+            
+            buffer_size_type size() const { return _size; }
+        
+        protected:
+            buffer_pool*     _pool;
+            buffer_size_type _size;
+        };
+        
+        using buffer = std::unique_ptr< char[], deleter >;
+        
+        buffer_pool(
+            std::size_t thread_cache_size = 64,
+            std::size_t global_cache_size = 1024
+        );
+        ~buffer_pool();
+        
+        buffer_pool( const buffer_pool& ) = delete;
+        buffer_pool& operator =( const buffer_pool& ) = delete;
+        
+        // Buffers must not outlive the pool they were acquired from
+        buffer     acquire( buffer_size_type size );
+        stats_type stats  () const;
+        
+        // For allocating a buffer that isn't pooled but can be held in the
+        // same type as one that is
+        static buffer unpooled( buffer_size_type size );
+    
+    protected:
+        using _free_lists_type = std::map<
+            buffer_size_type,
+            std::vector< char* >
+        >;
+        
+        // Shared with each thread's cache so they know whether the pool still
+        // exists when the thread exits
+        struct _shared_state
+        {
+            std::uint64_t              id;
+            std::size_t                thread_cache_size;
+            std::size_t                global_cache_size;
+            std::mutex                 mutex;
+            _free_lists_type           free;
+            std::size_t                free_count;
+            std::atomic< std::size_t > hits;
+            std::atomic< std::size_t > misses;
+            std::atomic< std::size_t > in_use;
+            std::atomic< std::size_t > peak_in_use;
+            
+            ~_shared_state();
+            
+            void put( char*, buffer_size_type );
+        };
+        
+        struct _thread_cache
+        {
+            std::weak_ptr< _shared_state > state;
+            _free_lists_type               free;
+            std::size_t                    free_count{ 0 };
+            
+            ~_thread_cache();
+        };
+        
+        // Keyed by ID rather than address, as a new pool could be created at
+        // the address of an old one
+        using _thread_caches_type = std::unordered_map<
+            std::uint64_t,
+            _thread_cache
+        >;
+        
+        std::shared_ptr< _shared_state > _state;
+        
+        static _thread_caches_type& _local_caches();
+        _thread_cache&              _local_cache ();
+        void           _release( char*, buffer_size_type );
+    };
+    
     class _socket
     {
         friend class server;
         friend class connection;
-        
+        friend class event_loop;
+    
     protected:
         _socket(
             socket_fd          fd,
@@ -157,6 +588,7 @@ namespace show // Main classes /////////////////////////////////////////////////
         
         enum wait_for_type
         {
+            NONE       = 0,     // Timed out
             READ       = 1,
             WRITE      = 2,
             READ_WRITE = 3
@@ -172,24 +604,244 @@ namespace show // Main classes /////////////////////////////////////////////////
             int                timeout,
             const std::string& purpose
         );
+        // Returns `NONE` rather than throwing `connection_timeout`
+        wait_for_type try_wait_for(
+            wait_for_type      wf,
+            int                timeout,
+            const std::string& purpose
+        );
+    };
+    
+    // Outcome of the non-throwing `try_` I/O functions; timeouts and clients
+    // going away are routine, so polling loops can handle them without the
+    // cost of throwing `connection_timeout` or `client_disconnected`
+    enum class io_status
+    {
+        SUCCESS,
+        TIMEOUT,
+        DISCONNECTED
+    };
+    
+    enum class header_parse_status
+    {
+        SUCCESS,
+        INCOMPLETE,
+        MALFORMED_LINE_ENDING,
+        MALFORMED_HEADER,
+        MISSING_HEADER_VALUE,
+        TOO_MANY_HEADERS,
+        HEADERS_TOO_LARGE
+    };
+    
+    // Collects a block of header lines, up to and including the blank line
+    // that ends it, into one contiguous buffer and splits it into fields in
+    // place.  Requests and multipart segments both parse their headers with
+    // this, so they follow exactly the same rules.
+    class header_parser
+    {
+    public:
+        // Offset & size of a piece of the block
+        struct span
+        {
+            std::size_t offset;
+            std::size_t size;
+        };
+        
+        static const std::size_t DEFAULT_MAX_FIELDS    {       100 };
+        static const std::size_t DEFAULT_MAX_BLOCK_SIZE{ 64 * 1024 };
+        
+        header_parser(
+            std::size_t max_fields     = DEFAULT_MAX_FIELDS,
+            std::size_t max_block_size = DEFAULT_MAX_BLOCK_SIZE
+        );
+        
+        // Discards the current block and fields but keeps their storage
+        void reset();
+        
+        // Adds characters from [`begin`, `end`) to the block, stopping just
+        // after the blank line that ends it; `used` is set to how many were
+        // taken.  Returns `INCOMPLETE` until the end of the block is found.
+        // Line endings are checked here so a bad one is caught without
+        // waiting for the rest of the block.
+        header_parse_status append(
+            const char*  begin,
+            const char*  end,
+            std::size_t& used
+        );
+        
+        // Splits a complete block into fields, starting at `offset` (e.g.
+        // after a request line), folding multi-line values onto one line
+        header_parse_status parse_fields( std::size_t offset = 0 );
+        
+        char*       data       ()       { return _block.data(); }
+        const char* data       () const { return _block.data(); }
+        std::size_t size       () const { return _block.size(); }
+        std::size_t field_count() const { return _fields.size(); }
+        
+        string_view view ( const span& ) const;
+        string_view name ( std::size_t ) const;
+        string_view value( std::size_t ) const;
+        
+        // Adds every field to `headers`
+        void copy_to( headers_type& headers ) const;
+        void copy_to( header_map  & headers ) const;
+        
+        std::size_t max_fields    () const;
+        std::size_t max_fields    ( std::size_t );
+        std::size_t max_block_size() const;
+        std::size_t max_block_size( std::size_t );
+    
+    protected:
+        std::size_t                            _max_fields;
+        std::size_t                            _max_block_size;
+        std::vector< char >                    _block;
+        std::vector< std::pair< span, span > > _fields;
+        // State of the line `append()` stopped in the middle of
+        bool                                   _line_empty;
+        bool                                   _after_cr;
+        
+        header_parse_status _push_field( const span& key, const span& value );
+    };
+    
+    // Human-readable description of a failed `header_parse_status`, used as
+    // the message of the exception thrown for it
+    const char* _header_parse_error_message( header_parse_status );
+    
+    enum class request_parse_status
+    {
+        INCOMPLETE,     // Needs more input
+        COMPLETE,
+        FAILED
+    };
+    
+    // Parses a request line & header block from whatever input is available,
+    // keeping its place between calls, so one thread can parse requests from
+    // many connections at once without waiting on any of them
+    class request_parser
+    {
+    public:
+        using span = header_parser::span;
+        
+        request_parser(
+            std::size_t max_fields     = header_parser::DEFAULT_MAX_FIELDS,
+            std::size_t max_block_size = header_parser::DEFAULT_MAX_BLOCK_SIZE
+        );
+        
+        // Starts over for the next request but keeps the storage
+        void reset();
+        
+        // Parses as much of [`data`, `data + size`) as belongs to this
+        // request; `used` is set to how many characters were taken, so
+        // anything after the header block (content or a pipelined request)
+        // is left to the caller.  Once `COMPLETE` or `FAILED`, this takes
+        // nothing and returns the same status until `reset()`.
+        request_parse_status feed(
+            const char*  data,
+            std::size_t  size,
+            std::size_t& used
+        );
+        
+        request_parse_status status() const { return _status; }
+        // Why parsing failed, if it did
+        const char*          error () const;
+        
+        // Only meaningful once parsing is complete; these refer into the
+        // parser's buffer, so they're valid until the next `reset()`
+        http_protocol protocol       () const { return _protocol                       ; }
+        string_view   protocol_string() const { return _fields.view( _protocol_string ); }
+        string_view   method         () const { return _fields.view( _method          ); }
+        string_view   raw_path       () const { return _fields.view( _path            ); }
+        string_view   raw_query      () const { return _fields.view( _query           ); }
+        
+        const header_parser& fields() const { return _fields; }
+    
+    protected:
+        header_parser        _fields;
+        request_parse_status _status;
+        header_parse_status  _error;
+        http_protocol        _protocol;
+        span                 _method;
+        span                 _path;
+        span                 _query;
+        span                 _protocol_string;
+        
+        request_parse_status _fail( header_parse_status );
     };
     
     class connection : public std::streambuf
     {
         friend class server;
+        friend class _request_content;
         friend class request;
+        friend class request_view;
         friend class response;
-        
+        friend class event_loop;
+    
     protected:
-        static const buffer_size_type BUFFER_SIZE{   1024 };
-        static const char             ASCII_ACK  { '\x06' };
+        static const buffer_size_type DEFAULT_BUFFER_SIZE{   1024 };
+        static const char             ASCII_ACK          { '\x06' };
+#if defined( IOV_MAX )
+        static const std::size_t      MAX_SEND_VECTORS   { IOV_MAX };
+#else
+        // POSIX's minimum for `IOV_MAX`
+        static const std::size_t      MAX_SEND_VECTORS   {     16 };
+#endif
+
+        _socket          _serve_socket;
+        int              _timeout;
+        std::string      _server_address;
+        unsigned int     _server_port;
+        // `_buffer_size` is the requested size; the buffers are only resized
+        // to match once they're empty, so the get buffer's actual size is
+        // tracked separately (the put buffer's is `epptr() - pbase()`)
+        buffer_size_type _buffer_size;
+        buffer_size_type _get_buffer_size;
+        // Declared before the buffers so it outlives them
+        std::shared_ptr< buffer_pool > _buffer_pool;
+        buffer_pool::buffer            get_buffer;
+        buffer_pool::buffer            put_buffer;
+        
+        // Parses the most recent request's header block, kept here so its
+        // storage can be reused across requests on the same connection
+        // without reallocating, and so a read interrupted by a timeout can
+        // resume; a `request_view` refers directly into it
+        request_parser _request_parser;
+        // A header block has been parsed (or failed to parse) but no request
+        // has taken it yet
+        bool           _request_pending;
+        // How many header blocks have been read successfully, so an event
+        // loop can tell when a request has arrived
+        std::size_t    _requests_read;
         
-        _socket      _serve_socket;
-        int          _timeout;
-        std::string  _server_address;
-        unsigned int _server_port;
-        std::unique_ptr< std::array< char, BUFFER_SIZE > > get_buffer;
-        std::unique_ptr< std::array< char, BUFFER_SIZE > > put_buffer;
+        // Output waiting to be sent, in order; entries can point into the put
+        // buffer, into `_owned_chunks`, or at data owned by the caller of
+        // `response::queue()`.  A `std::deque<>` never moves its elements, so
+        // the pointers into `_owned_chunks` stay valid as it grows.
+        std::vector< iovec >      _send_queue;
+        std::size_t               _send_queue_front;
+        std::deque< std::string > _owned_chunks;
+        // How much of the put buffer has already been added to `_send_queue`
+        std::size_t               _put_queued;
+        // Set by `handle_pipelined()`; flushing a `response` only queues it,
+        // so the responses to several requests are sent together
+        bool                      _batching;
+        
+        // The pipe `splice()` moves file data through on its way to the
+        // socket, kept open across calls to `send_file()`; if a send is
+        // interrupted, what's left in it goes out first on the next flush
+        struct _splice_pipe_type
+        {
+            int         read_end { -1 };
+            int         write_end{ -1 };
+            std::size_t pending  {  0 };
+            
+            _splice_pipe_type() = default;
+            _splice_pipe_type( _splice_pipe_type&& );
+            ~_splice_pipe_type();
+            
+            _splice_pipe_type& operator =( _splice_pipe_type&& );
+        };
+        _splice_pipe_type         _splice_pipe;
         
         connection(
             socket_fd          fd,
@@ -197,11 +849,80 @@ namespace show // Main classes /////////////////////////////////////////////////
             unsigned int       client_port,
             const std::string& server_address,
             unsigned int       server_port,
-            int                timeout
+            int                timeout,
+            buffer_size_type   buffer_size,
+            std::shared_ptr< buffer_pool > pool
         );
         
         void flush();
         
+        // From `_buffer_pool` if there is one
+        buffer_pool::buffer _allocate_buffer( buffer_size_type );
+        
+        // The put buffer isn't allocated until something is written
+        void _reserve_put_buffer();
+        
+        // Reads at least one byte (waiting if necessary) directly into `s`
+        std::streamsize _read( char* s, std::streamsize count );
+        io_status _try_read(
+            char*            s,
+            std::streamsize  count,
+            std::streamsize& bytes_read
+        );
+        // Reads into the get buffer if it's empty
+        io_status _try_fill();
+        
+        // Add data to be sent after anything already written or queued; the
+        // first version doesn't copy, so `data` must stay valid until flushed
+        void _queue( const char* data, std::size_t size );
+        void _queue( std::string&& data );
+        void _queue_put_buffer();
+        // Copies any unsent part of `data` in the queue so the caller's
+        // memory is no longer referenced
+        void _own_queued( const char* data, std::size_t size );
+        // Sends `_send_queue` in as few syscalls as possible; if interrupted
+        // by a timeout or disconnect, picks up where it left off next time
+        void      _send_queued();
+        io_status _try_send_queued();
+        // Whether anything written, queued, or taken from a file is still
+        // waiting to be sent
+        bool      _output_pending() const;
+        
+        // Waits until the socket is writable, if there's a timeout to wait on
+        void _wait_to_send();
+        bool _try_wait_to_send();
+        // Throws the appropriate exception for a failed send, unless it was
+        // only interrupted and should be retried
+        void      _send_error ( int errno_copy );
+        // Same, but returns timeouts & disconnects, and `io_status::SUCCESS`
+        // if the send should be retried
+        io_status _send_status( int errno_copy );
+        
+        // Sends part of a file after everything written so far, advancing
+        // `offset` & reducing `remaining` by however much is taken from the
+        // file; anything taken but not yet sent when interrupted goes out
+        // first on the next flush.  `position` is `nullptr` for pipes & other
+        // descriptors that can only be read sequentially.  The first two only
+        // work for some kinds of descriptors and return `false` if they can't
+        // be used, in which case the next one down should be tried.
+        io_status _try_send_file( int, off_t& offset, std::size_t& remaining );
+#if defined( __linux__ )
+        bool _send_file_sendfile( int, off_t*, std::size_t&, io_status& );
+        bool _send_file_splice  ( int, off_t*, std::size_t&, io_status& );
+        io_status _try_send_spliced();
+#endif
+        io_status _send_file_copy( int, off_t*, std::size_t& );
+        
+        // Reads a request's header block into `_request_parser`, leaving
+        // anything after it in the get buffer, for the next request object
+        // to take; throws `request_parse_error` if it's malformed
+        void      _read_header_block();
+        io_status _try_read_header_block();
+        // Continues parsing a header block from the get buffer without
+        // reading from the socket; returns `true` once the block is complete
+        // or has failed to parse
+        bool      _parse_buffered_header_block();
+        
         // std::streambuf get functions
         virtual std::streamsize showmanyc();
         virtual int_type        underflow();
@@ -221,7 +942,7 @@ namespace show // Main classes /////////////////////////////////////////////////
         virtual int_type overflow(
             int_type ch = std::char_traits< char >::eof()
         );
-        
+    
     public:
         const std::string& client_address() const { return _serve_socket.address; };
         const unsigned int client_port   () const { return _serve_socket.port   ; };
@@ -232,15 +953,55 @@ namespace show // Main classes /////////////////////////////////////////////////
         
         connection& operator =( connection&& );
         
+        // Non-throwing I/O for polling loops, returning `io_status::TIMEOUT`
+        // or `io_status::DISCONNECTED` where the stream functions would throw
+        // `connection_timeout` or `client_disconnected`.  `try_read()` only
+        // waits if nothing is buffered, and may read fewer than `count`
+        // bytes.  `try_write()` only sends once the put buffer is full, so
+        // finish with `try_flush()`.  After a timeout, calling these again
+        // picks up where they left off.
+        io_status try_read(
+            char*            s,
+            std::streamsize  count,
+            std::streamsize& bytes_read
+        );
+        io_status try_write(
+            const char*      s,
+            std::streamsize  count,
+            std::streamsize& bytes_written
+        );
+        io_status try_flush();
+        // Reads the next request's header block without waiting past the
+        // timeout, resuming if a previous call was interrupted; once this
+        // returns `io_status::SUCCESS`, constructing a `request` or
+        // `request_view` won't need to read anything more
+        io_status try_read_request();
+        
+        // Serves HTTP/1.1 pipelined requests: calls `handler( *this )` for
+        // the next request, then again for each further request the client
+        // has already sent, without waiting for more.  `handler` should
+        // construct a `request` or `request_view`, read all its content, and
+        // respond, returning `false` if the connection should be closed; if it
+        // returns without constructing one, no more requests are handled.
+        // Responses are held until the last request is handled and then sent
+        // together, so anything given to `response::queue()` without copying
+        // must stay valid until this returns.  Returns whatever the last call
+        // to `handler` did.
+        template< typename Handler > bool handle_pipelined( Handler handler );
+        
         int timeout() const;
         int timeout( int );
+        
+        buffer_size_type buffer_size() const;
+        buffer_size_type buffer_size( buffer_size_type );
     };
     
-    class request : public std::streambuf
+    // Common content-reading functionality for `request` and `request_view`
+    class _request_content : public std::streambuf
     {
         friend class response;
         friend class connection;
-        
+    
     public:
         enum content_length_flag
         {
@@ -249,40 +1010,76 @@ namespace show // Main classes /////////////////////////////////////////////////
             MAYBE
         };
         
-        request( class connection& );
-        request( request&& );
-        
-        request& operator =( request&& );
-        
-        show::connection                & connection            () const { return *_connection                   ; }
-        const std::string               & client_address        () const { return _connection -> client_address(); }
-        const unsigned int                client_port           () const { return _connection -> client_port   (); }
-        http_protocol                     protocol              () const { return _protocol                      ; }
-        const std::string               & protocol_string       () const { return _protocol_string               ; }
-        const std::string               & method                () const { return _method                        ; }
-        const std::vector< std::string >& path                  () const { return _path                          ; }
-        const query_args_type           & query_args            () const { return _query_args                    ; }
-        const headers_type              & headers               () const { return _headers                       ; }
-        content_length_flag               unknown_content_length() const { return _unknown_content_length        ; }
-        unsigned long long                content_length        () const { return _content_length                ; }
+        show::connection  & connection            () const { return *_connection                   ; }
+        const std::string & client_address        () const { return _connection -> client_address(); }
+        const unsigned int  client_port           () const { return _connection -> client_port   (); }
+        content_length_flag unknown_content_length() const { return _unknown_content_length        ; }
+        unsigned long long  content_length        () const { return _content_length                ; }
+        // The content is sent with "Transfer-Encoding: chunked", which is
+        // decoded as it's read; the length isn't known until the last chunk
+        bool                chunked               () const { return _chunk_state != NOT_CHUNKED    ; }
         
         bool eof() const;
         void flush();
-        
+    
     protected:
+        // Where the chunked-encoding decoder is in the framing around the
+        // content; kept between reads so a timeout can interrupt it anywhere
+        enum _chunk_state_type
+        {
+            NOT_CHUNKED,
+            CHUNK_SIZE_START,
+            CHUNK_SIZE,
+            CHUNK_EXTENSION,    // Ignored
+            CHUNK_SIZE_LF,
+            CHUNK_DATA,
+            CHUNK_DATA_END,
+            CHUNK_DATA_LF,
+            TRAILER_START,
+            TRAILER,            // Trailer fields are discarded
+            TRAILER_LF,
+            TRAILER_END_LF,
+            CHUNKS_DONE
+        };
+        
         class connection* _connection;
         
-        http_protocol              _protocol;
-        std::string                _protocol_string;
-        std::string                _method;
-        std::vector< std::string > _path;
-        query_args_type            _query_args;
-        headers_type               _headers;
-        content_length_flag        _unknown_content_length;
-        unsigned long long         _content_length;
+        content_length_flag _unknown_content_length;
+        unsigned long long  _content_length;
         
         unsigned long long read_content;
         
+        _chunk_state_type  _chunk_state;
+        unsigned long long _chunk_size;
+        unsigned long long _chunk_remaining;
+        
+        _request_content( class connection& );
+        _request_content( _request_content&& );
+        
+        void _swap_content( _request_content& );
+        
+        // Sets the content length information given the number of
+        // "Content-Length" headers and the value of the first one
+        void _parse_content_length(
+            std::size_t        header_count,
+            const std::string& first_value
+        );
+        // The last transfer coding listed in one "Transfer-Encoding" value,
+        // or an empty view if it lists none
+        static string_view _last_transfer_coding( string_view value );
+        // Switches to decoding chunked content given the final coding across
+        // every "Transfer-Encoding" header, taking precedence over any
+        // "Content-Length"; throws `request_parse_error` if that coding isn't
+        // "chunked", as the end of the content can't be found reliably (see
+        // https://tools.ietf.org/html/rfc7230#section-3.3.3)
+        void _parse_transfer_encoding( string_view final_coding );
+        
+        // Reads past chunk framing until there is chunk data to read or the
+        // content has ended, returning `true`; if `wait` is `false`, stops &
+        // returns `false` rather than wait for more from the connection
+        bool _next_chunk_data( bool wait );
+        void _decode_chunk_framing( char );
+        
         virtual std::streamsize showmanyc();
         virtual int_type        underflow();
         virtual int_type        uflow();
@@ -295,15 +1092,95 @@ namespace show // Main classes /////////////////////////////////////////////////
         );
     };
     
-    class response : public std::streambuf
+    class request : public _request_content
     {
+        friend class response;
+        friend class connection;
+    
     public:
-        response(
-            connection         &,
+        request( class connection& );
+        request( request&& );
+        
+        request& operator =( request&& );
+        
+        http_protocol                     protocol              () const { return _protocol                      ; }
+        const std::string               & protocol_string       () const { return _protocol_string               ; }
+        const std::string               & method                () const { return _method                        ; }
+        const std::vector< std::string >& path                  () const { return _path                          ; }
+        const query_args_type           & query_args            () const { return _query_args                    ; }
+        const headers_type              & headers               () const { return _headers                       ; }
+    
+    protected:
+        http_protocol              _protocol;
+        std::string                _protocol_string;
+        std::string                _method;
+        std::vector< std::string > _path;
+        query_args_type            _query_args;
+        headers_type               _headers;
+    };
+    
+    // A request whose method, path, query string, and headers refer directly
+    // into a buffer owned by the connection rather than being copied out; only
+    // one view per connection is valid at a time
+    class request_view : public _request_content
+    {
+    public:
+        struct header_field
+        {
+            string_view name;
+            string_view value;
+        };
+        
+        request_view( class connection& );
+        request_view( request_view&& );
+        
+        request_view& operator =( request_view&& );
+        
+        http_protocol protocol       () const { return _parser().protocol       (); }
+        string_view   protocol_string() const { return _parser().protocol_string(); }
+        string_view   method         () const { return _parser().method         (); }
+        string_view   raw_path       () const { return _parser().raw_path       (); }
+        string_view   raw_query      () const { return _parser().raw_query      (); }
+        std::size_t   field_count    () const { return _parser().fields().field_count(); }
+        
+        // These decode their values each time they're called
+        std::vector< std::string > path      () const;
+        query_args_type            query_args() const;
+        headers_type               headers   () const;
+        
+        header_field field ( std::size_t ) const;
+        string_view  header( string_view name ) const;
+    
+    protected:
+        const request_parser& _parser() const
+        {
+            return _connection -> _request_parser;
+        }
+    };
+    
+    class response : public std::streambuf
+    {
+    public:
+        response(
+            connection         &,
             http_protocol       ,
             const response_code&,
             const headers_type &
         );
+        // Only takes a `header_map`; it's a template so that braced lists
+        // still unambiguously initialize a `headers_type` for the above
+        template<
+            typename Headers,
+            typename = typename std::enable_if<
+                std::is_same< Headers, header_map >::value
+            >::type
+        >
+        response(
+            connection         &,
+            http_protocol       ,
+            const response_code&,
+            const Headers      &
+        );
         response( response&& );
         ~response();
         
@@ -311,9 +1188,47 @@ namespace show // Main classes /////////////////////////////////////////////////
         
         virtual void flush();
         
+        // Add a chunk of content to be sent after everything written so far
+        // without copying it into the connection's buffer; everything queued
+        // is sent together with as few system calls as possible on the next
+        // flush.  The first version does not take ownership, so `data` must
+        // remain valid until then.
+        void queue( const char* data, std::size_t size );
+        void queue( std::string data );
+        
+        // Send `length` bytes of an open file starting at `offset` after
+        // everything written so far, moving the data directly from the file
+        // to the socket where the OS supports it.  Returns the number of bytes
+        // sent, which is less than `length` only if the file ends first.
+        // Pipes are read from their current position and `offset` is ignored.
+        std::size_t send_file(
+            int         file_descriptor,
+            off_t       offset,
+            std::size_t length
+        );
+        // Non-throwing, resumable version of the above: advances `offset` and
+        // reduces `remaining` by however much of the file has been sent, so
+        // after `io_status::TIMEOUT` calling this again with the same
+        // variables continues where it left off.  Returns
+        // `io_status::SUCCESS` once done, with `remaining` left above 0 only
+        // if the file ended first.
+        io_status try_send_file(
+            int          file_descriptor,
+            off_t&       offset,
+            std::size_t& remaining
+        );
+    
     protected:
         connection* _connection;
         
+        // Writes the status line & headers straight into the connection's
+        // put buffer, or queues them in one piece if they don't fit
+        template< typename Headers > void _write_header_block(
+            http_protocol,
+            const response_code&,
+            const Headers&
+        );
+        
         virtual std::streamsize xsputn(
             const char_type*,
             std::streamsize
@@ -325,29 +1240,69 @@ namespace show // Main classes /////////////////////////////////////////////////
     
     class server
     {
+        friend class event_loop;
+        friend class thread_pool_server;
+    
     protected:
-        int _timeout;
+        int              _timeout;
+        int              _backlog;
+        buffer_size_type _buffer_size;
+        std::shared_ptr< show::buffer_pool > _buffer_pool;
+        // A failure to accept after other connections had already been
+        // accepted by the same call, held to be thrown by the next call
+        std::exception_ptr                   _accept_error;
         
         _socket* listen_socket;
         
+        socket_fd _accept(
+            std::string & client_address,
+            unsigned int& client_port,
+            unsigned int& server_port
+        );
+        // Waits for a connection if there's a timeout to wait on; returns
+        // `false` if it timed out
+        bool _wait_to_accept();
+        // Adds the next waiting connection, if any, to `connections`
+        bool _accept_into( std::vector< connection >& connections );
+        void _rethrow_accept_error();
+    
     public:
         server(
             const std::string& address,
             unsigned int       port,
-            int                timeout = -1
+            int                timeout = -1,
+            int                backlog = SOMAXCONN
         );
         server( server&& );
         ~server();
         
         server& operator =( server&& );
         
-        connection serve();
+        connection                serve     ();
+        std::vector< connection > serve_many();
+        
+        // Non-throwing versions of the above for polling loops; accepted
+        // connections are added to the end of `connections`, and
+        // `io_status::TIMEOUT` is returned rather than throwing
+        // `connection_timeout` if there are none
+        io_status try_serve     ( std::vector< connection >& connections );
+        io_status try_serve_many( std::vector< connection >& connections );
         
         const std::string& address() const;
         unsigned int       port()    const;
+        int                backlog() const;
         
         int timeout() const;
         int timeout( int );
+        
+        buffer_size_type buffer_size() const;
+        buffer_size_type buffer_size( buffer_size_type );
+        
+        // May be null, in which case connections allocate their own buffers
+        std::shared_ptr< show::buffer_pool > buffer_pool() const;
+        std::shared_ptr< show::buffer_pool > buffer_pool(
+            std::shared_ptr< show::buffer_pool >
+        );
     };
 }
 
@@ -373,722 +1328,2501 @@ namespace show // Throwables ///////////////////////////////////////////////////
 
 namespace show // URL-encoding /////////////////////////////////////////////////
 {
+    enum class url_decode_status
+    {
+        SUCCESS,
+        INCOMPLETE_SEQUENCE,
+        INVALID_SEQUENCE
+    };
+    
     std::string url_encode(
         const std::string& o,
         bool use_plus_space = true
     );
     std::string url_decode( const std::string& );
+    
+    // Lower-level versions that work on caller-supplied memory and never throw
+    // or allocate.  `url_encode()` needs room for up to three times `size`
+    // bytes in `out` and returns the encoded size.  `url_decode()` needs room
+    // for `size` bytes and can decode in place, i.e. `out` may be `in`;
+    // `decoded_size` is set even on failure, to how much was decoded before
+    // the invalid sequence.
+    std::size_t url_encode(
+        const char* in,
+        std::size_t size,
+        char*       out,
+        bool        use_plus_space = true
+    );
+    url_decode_status url_decode(
+        const char*  in,
+        std::size_t  size,
+        char*        out,
+        std::size_t& decoded_size
+    );
+    
+    // Value of each hex digit, or -1 for any other character; also used for
+    // chunk sizes
+    const signed char* _url_hex_values();
 }
 
 
-namespace show // `show::_socket` implementation ///////////////////////////////
+namespace show // `show::header_map` implementation ////////////////////////////
 {
-    inline _socket::_socket(
-        socket_fd          fd,
-        const std::string& address,
-        unsigned int       port
-    ) :
-        descriptor{ fd      },
-        address   { address },
-        port      { port    }
+    // FNV-1a over the characters with bit 5 set, which folds ASCII letters'
+    // cases together; anything else it conflates is told apart by the full
+    // comparison that follows a hash match
+    inline std::uint32_t _hash_ignore_case_ASCII( string_view s )
     {
-        // Because we want non-blocking behavior on 0-second timeouts, all
-        // sockets are set to `O_NONBLOCK` even though `pselect()` is used.
-        fcntl(
-            descriptor,
-            F_SETFL,
-            fcntl( descriptor, F_GETFL, 0 ) | O_NONBLOCK
-        );
+        std::uint32_t hash{ 2166136261u };
+        for( auto c : s )
+        {
+            hash ^= static_cast< unsigned char >( c ) | 0x20;
+            hash *= 16777619u;
+        }
+        return hash;
     }
     
-    inline void _socket::setsockopt(
-        int         optname,
-        void*       value,
-        int         value_size,
-        std::string description
-    )
+    inline header_id _header_name_id( string_view name, std::uint32_t hash )
     {
-        if( ::setsockopt(
-            descriptor,
-            SOL_SOCKET,
-            optname,
-            value,
-            value_size
-        ) == -1 )
-            throw socket_error{
-                "failed to set listen socket "
-                + description
-                + ": "
-                + std::string{ std::strerror( errno ) }
-            };
+        static const std::size_t TABLE_SIZE{ 64 };
+        
+        // Open-addressed table of the known names, built on first use
+        static const std::array< header_id, TABLE_SIZE > table = [](){
+            std::array< header_id, TABLE_SIZE > t;
+            t.fill( header_id::UNKNOWN );
+            for( std::size_t i = 1; i < _header_id_count; ++i )
+            {
+                auto id   = static_cast< header_id >( i );
+                auto slot = _hash_ignore_case_ASCII( header_name( id ) );
+                while( t[ slot % TABLE_SIZE ] != header_id::UNKNOWN )
+                    ++slot;
+                t[ slot % TABLE_SIZE ] = id;
+            }
+            return t;
+        }();
+        
+        for( auto slot = hash; ; ++slot )
+        {
+            auto id = table[ slot % TABLE_SIZE ];
+            if(
+                id == header_id::UNKNOWN
+                || _equal_ignore_case_ASCII( header_name( id ), name )
+            )
+                return id;
+        }
     }
     
-    inline _socket::~_socket()
+    inline string_view header_name( header_id id )
     {
-        if( descriptor )
-            close( descriptor );
+        // Spelled the way `show::response` capitalizes them
+        static const char* const names[ _header_id_count ]{
+            "",
+            "Accept",
+            "Accept-Encoding",
+            "Accept-Language",
+            "Authorization",
+            "Cache-Control",
+            "Connection",
+            "Content-Disposition",
+            "Content-Encoding",
+            "Content-Length",
+            "Content-Type",
+            "Cookie",
+            "Date",
+            "Expect",
+            "Host",
+            "If-Modified-Since",
+            "If-None-Match",
+            "Keep-Alive",
+            "Last-Modified",
+            "Location",
+            "Origin",
+            "Range",
+            "Referer",
+            "Server",
+            "Set-Cookie",
+            "Transfer-Encoding",
+            "Upgrade",
+            "User-Agent"
+        };
+        return names[ static_cast< std::size_t >( id ) ];
     }
     
-    inline _socket::_socket( _socket&& o ) :
-        address   { o.address    },
-        port      { o.port       },
-        descriptor{ o.descriptor }
+    inline header_id header_name_id( string_view name )
     {
-        // TODO: Redesign `_socket` class so `const_cast<>()`s aren't required
-        const_cast< socket_fd& >( o.descriptor ) = 0;
+        return _header_name_id( name, _hash_ignore_case_ASCII( name ) );
     }
     
-    inline _socket& _socket::operator =( _socket&& o )
+    inline header_map::header_map() : _unknown_names{ 0 }
     {
-        // TODO: Redesign `_socket` class so `const_cast<>()`s aren't required
-        std::swap( const_cast< std::string & >( address    ), const_cast< std::string & >( o.address    ) );
-        std::swap( const_cast< unsigned int& >( port       ), const_cast< unsigned int& >( o.port       ) );
-        std::swap( const_cast< socket_fd   & >( descriptor ), const_cast< socket_fd   & >( o.descriptor ) );
-        
-        return *this;
+        _known.fill( NO_ENTRY );
     }
     
-    inline _socket::wait_for_type _socket::wait_for(
-        wait_for_type      wf,
-        int                timeout,
-        const std::string& purpose
-    )
+    inline header_map::header_map( const headers_type& headers ) :
+        header_map{}
     {
-        if( timeout == 0 )
-            // 0-second timeouts must be handled in the code that called
-            // `wait_for()`, as 0s will cause `pselect()` to error
-            throw socket_error{
-                "0-second timeouts can't be handled by wait_for()"
-            };
-        
-        fd_set read_descriptors, write_descriptors;
-        timespec timeout_spec{ timeout, 0 };
-        
-        bool r{ static_cast< bool >(
-              static_cast< unsigned >( wf                   )
-            & static_cast< unsigned >( wait_for_type::READ  )
-        ) };
-        bool w{ static_cast< bool >(
-              static_cast< unsigned >( wf                   )
-            & static_cast< unsigned >( wait_for_type::WRITE )
-        ) };
-        
-        if( r )
-        {
-            FD_ZERO( &read_descriptors );
-            FD_SET( descriptor, &read_descriptors );
-        }
-        if( w )
-        {
-            FD_ZERO( &write_descriptors );
-            FD_SET( descriptor, &write_descriptors );
-        }
-        
-        auto select_result = pselect(
-            descriptor + 1,
-            r ? &read_descriptors  : NULL,
-            w ? &write_descriptors : NULL,
-            NULL,
-            timeout > 0 ? &timeout_spec : NULL,
-            NULL
-        );
-        
-        if( select_result == -1 )
-            throw socket_error{
-                "failure to select on "
-                + purpose
-                + ": "
-                + std::string{ std::strerror( errno ) }
+        for( const auto& name_values_pair : headers )
+            for( const auto& value : name_values_pair.second )
+                add( name_values_pair.first, value );
+    }
+    
+    inline void header_map::add( string_view name, string_view value )
+    {
+        auto hash = _hash_ignore_case_ASCII( name );
+        _add( name, hash, _header_name_id( name, hash ), value );
+    }
+    
+    inline void header_map::add( header_id id, string_view value )
+    {
+        if( id == header_id::UNKNOWN )
+            throw std::invalid_argument{
+                "show::header_map: header_id::UNKNOWN has no name"
             };
-        else if( select_result == 0 )
-            throw connection_timeout{};
-        
-        if( r )
-            r = FD_ISSET( descriptor, &read_descriptors );
-        if( w )
-            w = FD_ISSET( descriptor, &write_descriptors );
-        
-        // At least one of these must be true
-        if( w && r )
-            return READ_WRITE;
-        else if( r )
-            return READ;
-        else
-            return WRITE;
+        // The hash is only used to index unknown names
+        _add( header_name( id ), 0, id, value );
     }
-}
-
-
-namespace show // `show::connection` implementation ////////////////////////////
-{
-    inline connection::connection(
-        socket_fd          fd,
-        const std::string& client_address,
-        unsigned int       client_port,
-        const std::string& server_address,
-        unsigned int       server_port,
-        int                timeout
-    ) :
-        _serve_socket  { fd, client_address, client_port       },
-        _server_address{ server_address                        },
-        _server_port   { server_port                           },
-        // `std::make_unique<>()` available in C++14
-        get_buffer     { new std::array< char, BUFFER_SIZE >{} },
-        put_buffer     { new std::array< char, BUFFER_SIZE >{} }
+    
+    inline void header_map::set( string_view name, string_view value )
     {
-        this -> timeout( timeout );
-        setg(
-            reinterpret_cast< char* >( get_buffer.get() ),
-            reinterpret_cast< char* >( get_buffer.get() ),
-            reinterpret_cast< char* >( get_buffer.get() )
-        );
-        setp(
-            reinterpret_cast< char* >( put_buffer.get() ),
-            reinterpret_cast< char* >( put_buffer.get() ) + BUFFER_SIZE
-        );
+        erase( name );
+        add( name, value );
     }
     
-    inline void connection::flush()
+    inline void header_map::set( header_id id, string_view value )
     {
-        buffer_size_type send_offset{ 0 };
-        
-        while( pptr() - ( pbase() + send_offset ) > 0 )
-        {
-            if( _timeout != 0 )
-                _serve_socket.wait_for(
-                    _socket::WRITE,
-                    _timeout,
-                    "response send"
-                );
-            
-            auto bytes_sent = static_cast< buffer_size_type >( send(
-                _serve_socket.descriptor,
-                pbase() + send_offset,
-                pptr() - ( pbase() + send_offset ),
-                0
-            ) );
-            
-            if( bytes_sent == -1 )
-            {
-                auto errno_copy = errno;
-                
-                if( errno_copy == EAGAIN || errno_copy == EWOULDBLOCK )
-                    throw connection_timeout{};
-                else if( errno_copy == ECONNRESET )
-                    throw client_disconnected{};
-                else if( errno_copy != EINTR )
-                    // EINTR means the send() was interrupted and we just need
-                    // to try again
-                    throw socket_error{
-                        "failure to send response: "
-                        + std::string{ std::strerror( errno_copy ) }
-                    };
-            }
-            else
-                send_offset += bytes_sent;
-        }
-        
-        setp(
-            pbase(),
-            epptr()
-        );
+        erase( id );
+        add( id, value );
     }
     
-    inline std::streamsize connection::showmanyc()
+    inline std::size_t header_map::erase( string_view name )
     {
-        return egptr() - gptr();
+        return _erase( _first( name ) );
     }
     
-    inline connection::int_type connection::underflow()
+    inline std::size_t header_map::erase( header_id id )
     {
-        if( showmanyc() <= 0 )
-        {
-            buffer_size_type bytes_read{ 0 };
-            
-            while( bytes_read < 1 )
-            {
-                if( _timeout != 0 )
-                    _serve_socket.wait_for(
-                        _socket::READ,
-                        _timeout,
-                        "request read"
-                    );
-                
-                bytes_read = read(
-                    _serve_socket.descriptor,
-                    eback(),
-                    BUFFER_SIZE
-                );
-                
-                if( bytes_read == -1 )  // Error
-                {
-                    auto errno_copy = errno;
-                    
-                    if( errno_copy == EAGAIN || errno_copy == EWOULDBLOCK )
-                        throw connection_timeout{};
-                    else if( errno_copy == ECONNRESET )
-                        throw client_disconnected{};
-                    else if( errno_copy != EINTR )
-                        // EINTR means the read() was interrupted and we just
-                        // need to try again
-                        throw socket_error{
-                            "failure to read request: "
-                            + std::string{ std::strerror( errno_copy ) }
-                        };
-                }
-                else if( bytes_read == 0 )  // EOF
-                    throw client_disconnected{};
-            }
-            
-            setg(
-                eback(),
-                eback(),
-                eback() + bytes_read
-            );
-        }
-        
-        return traits_type::to_int_type( *gptr() );
+        return _erase( _first( id ) );
     }
     
-    inline std::streamsize connection::xsgetn(
-        char_type* s,
-        std::streamsize count
-    )
+    inline std::size_t header_map::count( string_view name ) const
     {
-        if( count == 0 )
-            return 0;
-
-        auto available = showmanyc();
-
-        if( available < 1 )
-        {
-            auto c = underflow();
-            if( c == traits_type::not_eof( c ) )
-                // Try again
-                return xsgetn( s, count );
-            else
-                return 0;
+        return _count( _first( name ) );
+    }
+    
+    inline std::size_t header_map::count( header_id id ) const
+    {
+        return _count( _first( id ) );
+    }
+    
+    inline string_view header_map::get( string_view name ) const
+    {
+        auto first = _first( name );
+        if( first == NO_ENTRY )
+            return {};
+        return _entries[ first ].value;
+    }
+    
+    inline string_view header_map::get( header_id id ) const
+    {
+        auto first = _first( id );
+        if( first == NO_ENTRY )
+            return {};
+        return _entries[ first ].value;
+    }
+    
+    inline std::vector< string_view > header_map::get_all(
+        string_view name
+    ) const
+    {
+        return _values( _first( name ) );
+    }
+    
+    inline std::vector< string_view > header_map::get_all( header_id id ) const
+    {
+        return _values( _first( id ) );
+    }
+    
+    inline void header_map::clear()
+    {
+        _entries.clear();
+        _known.fill( NO_ENTRY );
+        _unknown.clear();
+        _unknown_names = 0;
+    }
+    
+    inline void header_map::reserve( std::size_t count )
+    {
+        _entries.reserve( count );
+    }
+    
+    inline headers_type header_map::to_headers_type() const
+    {
+        headers_type headers;
+        for( const auto& entry : _entries )
+            headers[ entry.name ].push_back( entry.value );
+        return headers;
+    }
+    
+    inline std::uint32_t header_map::_first( string_view name ) const
+    {
+        auto hash = _hash_ignore_case_ASCII( name );
+        auto id   = _header_name_id( name, hash );
+        if( id != header_id::UNKNOWN )
+            return _known[ static_cast< std::size_t >( id ) ];
+        if( _unknown.empty() )
+            return NO_ENTRY;
+        return _unknown[ _find_slot( name, hash ) ];
+    }
+    
+    inline std::uint32_t header_map::_first( header_id id ) const
+    {
+        if( id == header_id::UNKNOWN )
+            return NO_ENTRY;
+        return _known[ static_cast< std::size_t >( id ) ];
+    }
+    
+    // Returns the slot holding `name`, or the empty one where it would go
+    inline std::size_t header_map::_find_slot(
+        string_view   name,
+        std::uint32_t hash
+    ) const
+    {
+        auto mask = _unknown.size() - 1;
+        for( std::size_t slot = hash & mask; ; slot = ( slot + 1 ) & mask )
+        {
+            auto entry = _unknown[ slot ];
+            if(
+                entry == NO_ENTRY
+                || (
+                    _entries[ entry ].hash == hash
+                    && _equal_ignore_case_ASCII( _entries[ entry ].name, name )
+                )
+            )
+                return slot;
+        }
+    }
+    
+    inline void header_map::_add(
+        string_view   name,
+        std::uint32_t hash,
+        header_id     id,
+        string_view   value
+    )
+    {
+        _entry entry;
+        entry.name  = name.to_string();
+        entry.value = value.to_string();
+        entry.id    = id;
+        entry.hash  = hash;
+        _entries.emplace_back( std::move( entry ) );
+        _link( static_cast< std::uint32_t >( _entries.size() - 1 ) );
+    }
+    
+    // Appends an entry to the list of values for its name
+    inline void header_map::_link( std::uint32_t index )
+    {
+        auto& entry = _entries[ index ];
+        entry.next = NO_ENTRY;
+        
+        std::uint32_t* first;
+        if( entry.id != header_id::UNKNOWN )
+            first = &_known[ static_cast< std::size_t >( entry.id ) ];
+        else
+        {
+            if( ( _unknown_names + 1 ) * 2 > _unknown.size() )
+            {
+                // Rehash the names already indexed into a table twice as big
+                std::vector< std::uint32_t > old{ std::move( _unknown ) };
+                _unknown.assign(
+                    old.empty() ? 16 : old.size() * 2,
+                    NO_ENTRY
+                );
+                for( auto e : old )
+                    if( e != NO_ENTRY )
+                        _unknown[ _find_slot(
+                            _entries[ e ].name,
+                            _entries[ e ].hash
+                        ) ] = e;
+            }
+            
+            first = &_unknown[ _find_slot( entry.name, entry.hash ) ];
+            if( *first == NO_ENTRY )
+                ++_unknown_names;
+        }
+        
+        if( *first == NO_ENTRY )
+            *first = index;
+        else
+        {
+            auto last = *first;
+            while( _entries[ last ].next != NO_ENTRY )
+                last = _entries[ last ].next;
+            _entries[ last ].next = index;
+        }
+    }
+    
+    inline std::size_t header_map::_count( std::uint32_t first ) const
+    {
+        std::size_t count{ 0 };
+        for( auto e = first; e != NO_ENTRY; e = _entries[ e ].next )
+            ++count;
+        return count;
+    }
+    
+    inline std::size_t header_map::_erase( std::uint32_t first )
+    {
+        if( first == NO_ENTRY )
+            return 0;
+        
+        std::vector< bool > erased( _entries.size(), false );
+        std::size_t count{ 0 };
+        for( auto e = first; e != NO_ENTRY; e = _entries[ e ].next )
+        {
+            erased[ e ] = true;
+            ++count;
+        }
+        
+        // Erasing is rare enough that rebuilding the index from scratch is
+        // simpler than patching it
+        std::vector< _entry > entries{ std::move( _entries ) };
+        clear();
+        for( std::size_t i = 0; i < entries.size(); ++i )
+            if( !erased[ i ] )
+            {
+                _entries.emplace_back( std::move( entries[ i ] ) );
+                _link( static_cast< std::uint32_t >( _entries.size() - 1 ) );
+            }
+        
+        return count;
+    }
+    
+    inline std::vector< string_view > header_map::_values(
+        std::uint32_t first
+    ) const
+    {
+        std::vector< string_view > values;
+        for( auto e = first; e != NO_ENTRY; e = _entries[ e ].next )
+            values.emplace_back( _entries[ e ].value );
+        return values;
+    }
+}
+
+
+namespace show // `show::buffer_pool` implementation ///////////////////////////
+{
+    inline buffer_pool::deleter::deleter() :
+        _pool{ nullptr },
+        _size{ 0       }
+    {}
+    
+    inline buffer_pool::deleter::deleter(
+        buffer_pool*     pool,
+        buffer_size_type size
+    ) :
+        _pool{ pool },
+        _size{ size }
+    {}
+    
+    inline void buffer_pool::deleter::operator ()( char* b ) const
+    {
+        if( _pool )
+            _pool -> _release( b, _size );
+        else
+            delete[] b;
+    }
+    
+    inline buffer_pool::_shared_state::~_shared_state()
+    {
+        for( auto& size_list : free )
+            for( auto b : size_list.second )
+                delete[] b;
+    }
+    
+    inline void buffer_pool::_shared_state::put(
+        char*            b,
+        buffer_size_type size
+    )
+    {
+        {
+            std::lock_guard< std::mutex > lock{ mutex };
+            if( free_count < global_cache_size )
+            {
+                free[ size ].push_back( b );
+                ++free_count;
+                return;
+            }
+        }
+        delete[] b;
+    }
+    
+    inline buffer_pool::_thread_cache::~_thread_cache()
+    {
+        // Runs when the thread exits, or when the pool is destroyed for the
+        // thread destroying it
+        auto shared = state.lock();
+        for( auto& size_list : free )
+            for( auto b : size_list.second )
+                if( shared )
+                    shared -> put( b, size_list.first );
+                else
+                    delete[] b;
+    }
+    
+    inline buffer_pool::buffer_pool(
+        std::size_t thread_cache_size,
+        std::size_t global_cache_size
+    ) :
+        _state{ std::make_shared< _shared_state >() }
+    {
+        static std::atomic< std::uint64_t > next_id{ 0 };
+        
+        _state -> id                = next_id++;
+        _state -> thread_cache_size = thread_cache_size;
+        _state -> global_cache_size = global_cache_size;
+        _state -> free_count        = 0;
+        _state -> hits              = 0;
+        _state -> misses            = 0;
+        _state -> in_use            = 0;
+        _state -> peak_in_use       = 0;
+    }
+    
+    inline buffer_pool::~buffer_pool()
+    {
+        // This thread's cache can be cleaned up now; other threads' caches
+        // are freed as those threads exit or start using another pool
+        _local_caches().erase( _state -> id );
+    }
+    
+    inline buffer_pool::_thread_caches_type& buffer_pool::_local_caches()
+    {
+        static thread_local _thread_caches_type caches;
+        return caches;
+    }
+    
+    inline buffer_pool::_thread_cache& buffer_pool::_local_cache()
+    {
+        auto& caches = _local_caches();
+        auto  found  = caches.find( _state -> id );
+        if( found != caches.end() )
+            return found -> second;
+        
+        // This is the first time this thread has used this pool, which is
+        // rare enough to be a good time to free any caches left behind by
+        // pools destroyed on other threads; otherwise a long-lived thread
+        // would hold onto them until it exits
+        for( auto cache = caches.begin(); cache != caches.end(); )
+            if( cache -> second.state.expired() )
+                cache = caches.erase( cache );
+            else
+                ++cache;
+        
+        auto& cache = caches[ _state -> id ];
+        cache.state = _state;
+        return cache;
+    }
+    
+    inline buffer_pool::buffer buffer_pool::acquire( buffer_size_type size )
+    {
+        char* b{ nullptr };
+        
+        auto& cache = _local_cache();
+        auto  found = cache.free.find( size );
+        if( found != cache.free.end() && !found -> second.empty() )
+        {
+            b = found -> second.back();
+            found -> second.pop_back();
+            --cache.free_count;
+        }
+        else
+        {
+            std::lock_guard< std::mutex > lock{ _state -> mutex };
+            auto found = _state -> free.find( size );
+            if( found != _state -> free.end() && !found -> second.empty() )
+            {
+                b = found -> second.back();
+                found -> second.pop_back();
+                --_state -> free_count;
+            }
+        }
+        
+        if( b )
+            _state -> hits.fetch_add( 1, std::memory_order_relaxed );
+        else
+        {
+            _state -> misses.fetch_add( 1, std::memory_order_relaxed );
+            b = new char[ size ];
+        }
+        
+        auto in_use = _state -> in_use.fetch_add(
+            1,
+            std::memory_order_relaxed
+        ) + 1;
+        auto peak = _state -> peak_in_use.load( std::memory_order_relaxed );
+        while(
+            in_use > peak
+            && !_state -> peak_in_use.compare_exchange_weak(
+                peak,
+                in_use,
+                std::memory_order_relaxed
+            )
+        );
+        
+        return buffer{ b, deleter{ this, size } };
+    }
+    
+    inline void buffer_pool::_release( char* b, buffer_size_type size )
+    {
+        _state -> in_use.fetch_sub( 1, std::memory_order_relaxed );
+        
+        auto& cache = _local_cache();
+        if( cache.free_count < _state -> thread_cache_size )
+        {
+            cache.free[ size ].push_back( b );
+            ++cache.free_count;
+        }
+        else
+            _state -> put( b, size );
+    }
+    
+    inline buffer_pool::stats_type buffer_pool::stats() const
+    {
+        return {
+            _state -> hits       .load( std::memory_order_relaxed ),
+            _state -> misses     .load( std::memory_order_relaxed ),
+            _state -> in_use     .load( std::memory_order_relaxed ),
+            _state -> peak_in_use.load( std::memory_order_relaxed )
+        };
+    }
+    
+    inline buffer_pool::buffer buffer_pool::unpooled( buffer_size_type size )
+    {
+        return buffer{ new char[ size ], deleter{ nullptr, size } };
+    }
+}
+
+
+namespace show // `show::_socket` implementation ///////////////////////////////
+{
+    inline _socket::_socket(
+        socket_fd          fd,
+        const std::string& address,
+        unsigned int       port
+    ) :
+        descriptor{ fd      },
+        address   { address },
+        port      { port    }
+    {
+        // Because we want non-blocking behavior on 0-second timeouts, all
+        // sockets are set to `O_NONBLOCK` even though `poll()` is used.  Where
+        // available, this (and `FD_CLOEXEC`) is done when the socket is
+        // created/accepted instead, saving a pair of `fcntl()` calls.
+#if !defined( SOCK_NONBLOCK )
+        fcntl(
+            descriptor,
+            F_SETFL,
+            fcntl( descriptor, F_GETFL, 0 ) | O_NONBLOCK
+        );
+        fcntl(
+            descriptor,
+            F_SETFD,
+            fcntl( descriptor, F_GETFD, 0 ) | FD_CLOEXEC
+        );
+#endif
+    }
+    
+    inline void _socket::setsockopt(
+        int         optname,
+        void*       value,
+        int         value_size,
+        std::string description
+    )
+    {
+        if( ::setsockopt(
+            descriptor,
+            SOL_SOCKET,
+            optname,
+            value,
+            value_size
+        ) == -1 )
+            throw socket_error{
+                "failed to set listen socket "
+                + description
+                + ": "
+                + std::string{ std::strerror( errno ) }
+            };
+    }
+    
+    inline _socket::~_socket()
+    {
+        if( descriptor )
+            close( descriptor );
+    }
+    
+    inline _socket::_socket( _socket&& o ) :
+        address   { o.address    },
+        port      { o.port       },
+        descriptor{ o.descriptor }
+    {
+        // TODO: Redesign `_socket` class so `const_cast<>()`s aren't required
+        const_cast< socket_fd& >( o.descriptor ) = 0;
+    }
+    
+    inline _socket& _socket::operator =( _socket&& o )
+    {
+        // TODO: Redesign `_socket` class so `const_cast<>()`s aren't required
+        std::swap( const_cast< std::string & >( address    ), const_cast< std::string & >( o.address    ) );
+        std::swap( const_cast< unsigned int& >( port       ), const_cast< unsigned int& >( o.port       ) );
+        std::swap( const_cast< socket_fd   & >( descriptor ), const_cast< socket_fd   & >( o.descriptor ) );
+        
+        return *this;
+    }
+    
+    inline _socket::wait_for_type _socket::wait_for(
+        wait_for_type      wf,
+        int                timeout,
+        const std::string& purpose
+    )
+    {
+        auto ready = try_wait_for( wf, timeout, purpose );
+        if( ready == NONE )
+            throw connection_timeout{};
+        return ready;
+    }
+    
+    inline _socket::wait_for_type _socket::try_wait_for(
+        wait_for_type      wf,
+        int                timeout,
+        const std::string& purpose
+    )
+    {
+        if( timeout == 0 )
+            // 0-second timeouts must be handled in the code that called
+            // `wait_for()`, as 0s will cause `poll()` to return immediately
+            throw socket_error{
+                "0-second timeouts can't be handled by wait_for()"
+            };
+        
+        // `poll()` is used rather than `pselect()` as it isn't limited to
+        // descriptors less than `FD_SETSIZE`
+        pollfd poll_descriptor{ descriptor, 0, 0 };
+        
+        bool r{ static_cast< bool >(
+              static_cast< unsigned >( wf                   )
+            & static_cast< unsigned >( wait_for_type::READ  )
+        ) };
+        bool w{ static_cast< bool >(
+              static_cast< unsigned >( wf                   )
+            & static_cast< unsigned >( wait_for_type::WRITE )
+        ) };
+        
+        if( r )
+            poll_descriptor.events |= POLLIN;
+        if( w )
+            poll_descriptor.events |= POLLOUT;
+        
+        // Timeouts are in seconds but `poll()` takes milliseconds, which can
+        // overflow an `int`; `poll()` can't wait any longer than `INT_MAX`
+        int poll_timeout{ -1 };
+        if( timeout > 0 )
+            poll_timeout = static_cast< int >( std::min< std::int64_t >(
+                static_cast< std::int64_t >( timeout ) * 1000,
+                INT_MAX
+            ) );
+        
+        int poll_result;
+        do
+        {
+            poll_result = poll(
+                &poll_descriptor,
+                1,
+                poll_timeout
+            );
+        } while( poll_result == -1 && errno == EINTR );
+        
+        if( poll_result == -1 )
+            throw socket_error{
+                "failure to select on "
+                + purpose
+                + ": "
+                + std::string{ std::strerror( errno ) }
+            };
+        else if( poll_result == 0 )
+            return NONE;
+        
+        // Errors & hangups are reported as readiness so the following
+        // `read()`/`send()`/`accept()` can report them properly
+        auto error_events = poll_descriptor.revents & (
+            POLLERR | POLLHUP | POLLNVAL
+        );
+        if( r )
+            r = ( poll_descriptor.revents & POLLIN  ) || error_events;
+        if( w )
+            w = ( poll_descriptor.revents & POLLOUT ) || error_events;
+        
+        // At least one of these must be true
+        if( w && r )
+            return READ_WRITE;
+        else if( r )
+            return READ;
+        else
+            return WRITE;
+    }
+}
+
+
+namespace show // `show::connection` implementation ////////////////////////////
+{
+    // For the throwing versions of the `try_` I/O functions
+    inline void _throw_if_interrupted( io_status status )
+    {
+        if( status == io_status::TIMEOUT )
+            throw connection_timeout{};
+        else if( status == io_status::DISCONNECTED )
+            throw client_disconnected{};
+    }
+    
+    inline connection::connection(
+        socket_fd          fd,
+        const std::string& client_address,
+        unsigned int       client_port,
+        const std::string& server_address,
+        unsigned int       server_port,
+        int                timeout,
+        buffer_size_type   buffer_size,
+        std::shared_ptr< buffer_pool > pool
+    ) :
+        _serve_socket    { fd, client_address, client_port },
+        _server_address  { server_address                  },
+        _server_port     { server_port                     },
+        _buffer_size     { buffer_size                     },
+        _get_buffer_size { buffer_size                     },
+        _buffer_pool     { std::move( pool )               },
+        get_buffer       { _allocate_buffer( buffer_size ) },
+        _request_pending { false                           },
+        _requests_read   { 0                               },
+        _send_queue_front{ 0                               },
+        _put_queued      { 0                               },
+        _batching        { false                           }
+    {
+        this -> timeout( timeout );
+        setg(
+            get_buffer.get(),
+            get_buffer.get(),
+            get_buffer.get()
+        );
+        setp(
+            nullptr,
+            nullptr
+        );
+    }
+    
+    inline void connection::flush()
+    {
+        _throw_if_interrupted( try_flush() );
+    }
+    
+    inline io_status connection::try_flush()
+    {
+#if defined( __linux__ )
+        // File data left in the pipe by an interrupted `send_file()` was
+        // taken before anything written since
+        auto status = _try_send_spliced();
+        if( status != io_status::SUCCESS )
+            return status;
+#else
+        auto status = io_status::SUCCESS;
+#endif
+
+        _queue_put_buffer();
+        status = _try_send_queued();
+        if( status != io_status::SUCCESS )
+            return status;
+        
+        _send_queue.clear();
+        _send_queue_front = 0;
+        _owned_chunks.clear();
+        _put_queued = 0;
+        
+        if( epptr() - pbase() != _buffer_size )
+        {
+            // Reallocated at the new size on the next write
+            put_buffer.reset();
+            setp(
+                nullptr,
+                nullptr
+            );
+        }
+        else
+            setp(
+                pbase(),
+                epptr()
+            );
+        
+        return io_status::SUCCESS;
+    }
+    
+    inline buffer_pool::buffer connection::_allocate_buffer(
+        buffer_size_type size
+    )
+    {
+        if( _buffer_pool )
+            return _buffer_pool -> acquire( size );
+        else
+            return buffer_pool::unpooled( size );
+    }
+    
+    inline void connection::_reserve_put_buffer()
+    {
+        if( !put_buffer )
+        {
+            put_buffer = _allocate_buffer( _buffer_size );
+            setp(
+                put_buffer.get(),
+                put_buffer.get() + _buffer_size
+            );
+        }
+    }
+    
+    inline std::streamsize connection::_read( char* s, std::streamsize count )
+    {
+        std::streamsize bytes_read;
+        _throw_if_interrupted( _try_read( s, count, bytes_read ) );
+        return bytes_read;
+    }
+    
+    inline io_status connection::_try_read(
+        char*            s,
+        std::streamsize  count,
+        std::streamsize& bytes_read
+    )
+    {
+        ssize_t result{ 0 };
+        
+        while( result < 1 )
+        {
+            if(
+                _timeout != 0
+                && _serve_socket.try_wait_for(
+                    _socket::READ,
+                    _timeout,
+                    "request read"
+                ) == _socket::NONE
+            )
+                return io_status::TIMEOUT;
+            
+            result = read(
+                _serve_socket.descriptor,
+                s,
+                static_cast< std::size_t >( count )
+            );
+            
+            if( result == -1 )  // Error
+            {
+                auto errno_copy = errno;
+                
+                if( errno_copy == EAGAIN || errno_copy == EWOULDBLOCK )
+                    return io_status::TIMEOUT;
+                else if( errno_copy == ECONNRESET )
+                    return io_status::DISCONNECTED;
+                else if( errno_copy != EINTR )
+                    // EINTR means the read() was interrupted and we just
+                    // need to try again
+                    throw socket_error{
+                        "failure to read request: "
+                        + std::string{ std::strerror( errno_copy ) }
+                    };
+            }
+            else if( result == 0 )  // EOF
+                return io_status::DISCONNECTED;
+        }
+        
+        bytes_read = static_cast< std::streamsize >( result );
+        return io_status::SUCCESS;
+    }
+    
+    inline void connection::_queue( const char* data, std::size_t size )
+    {
+        if( size < 1 )
+            return;
+        
+        _queue_put_buffer();
+        
+        iovec v;
+        v.iov_base = const_cast< char* >( data );
+        v.iov_len  = size;
+        _send_queue.push_back( v );
+    }
+    
+    inline void connection::_queue( std::string&& data )
+    {
+        if( data.size() < 1 )
+            return;
+        
+        _owned_chunks.emplace_back( std::move( data ) );
+        _queue( _owned_chunks.back().data(), _owned_chunks.back().size() );
+    }
+    
+    inline void connection::_queue_put_buffer()
+    {
+        auto written = static_cast< std::size_t >( pptr() - pbase() );
+        if( written > _put_queued )
+        {
+            iovec v;
+            v.iov_base = pbase() + _put_queued;
+            v.iov_len  = written - _put_queued;
+            _send_queue.push_back( v );
+            _put_queued = written;
+        }
+    }
+    
+    inline void connection::_own_queued( const char* data, std::size_t size )
+    {
+        for( auto i = _send_queue_front; i < _send_queue.size(); ++i )
+        {
+            auto& v    = _send_queue[ i ];
+            auto  base = static_cast< const char* >( v.iov_base );
+            if( base >= data && base < data + size )
+            {
+                _owned_chunks.emplace_back( base, v.iov_len );
+                v.iov_base = &_owned_chunks.back()[ 0 ];
+            }
+        }
+    }
+    
+    inline bool connection::_output_pending() const
+    {
+        return (
+            _send_queue_front < _send_queue.size()
+            || static_cast< std::size_t >( pptr() - pbase() ) > _put_queued
+            || _splice_pipe.pending > 0
+        );
+    }
+    
+    inline void connection::_send_queued()
+    {
+        _throw_if_interrupted( _try_send_queued() );
+    }
+    
+    inline io_status connection::_try_send_queued()
+    {
+        while( _send_queue_front < _send_queue.size() )
+        {
+            if( !_try_wait_to_send() )
+                return io_status::TIMEOUT;
+            
+            auto vector_count = _send_queue.size() - _send_queue_front;
+            if( vector_count > MAX_SEND_VECTORS )
+                vector_count = MAX_SEND_VECTORS;
+            
+            auto bytes_sent = writev(
+                _serve_socket.descriptor,
+                &_send_queue[ _send_queue_front ],
+                static_cast< int >( vector_count )
+            );
+            
+            if( bytes_sent == -1 )
+            {
+                auto status = _send_status( errno );
+                if( status != io_status::SUCCESS )
+                    return status;
+                continue;
+            }
+            
+            // Skip past everything that was sent
+            auto remaining = static_cast< std::size_t >( bytes_sent );
+            while(
+                _send_queue_front < _send_queue.size()
+                && remaining >= _send_queue[ _send_queue_front ].iov_len
+            )
+                remaining -= _send_queue[ _send_queue_front++ ].iov_len;
+            if( remaining > 0 )
+            {
+                auto& v = _send_queue[ _send_queue_front ];
+                v.iov_base = static_cast< char* >( v.iov_base ) + remaining;
+                v.iov_len -= remaining;
+            }
+        }
+        
+        return io_status::SUCCESS;
+    }
+    
+    inline void connection::_wait_to_send()
+    {
+        if( !_try_wait_to_send() )
+            throw connection_timeout{};
+    }
+    
+    inline bool connection::_try_wait_to_send()
+    {
+        return _timeout == 0 || _serve_socket.try_wait_for(
+            _socket::WRITE,
+            _timeout,
+            "response send"
+        ) != _socket::NONE;
+    }
+    
+    inline void connection::_send_error( int errno_copy )
+    {
+        _throw_if_interrupted( _send_status( errno_copy ) );
+    }
+    
+    inline io_status connection::_send_status( int errno_copy )
+    {
+        if( errno_copy == EAGAIN || errno_copy == EWOULDBLOCK )
+            return io_status::TIMEOUT;
+        else if( errno_copy == ECONNRESET )
+            return io_status::DISCONNECTED;
+        else if( errno_copy != EINTR )
+            // EINTR means the send was interrupted and we just need to try
+            // again
+            throw socket_error{
+                "failure to send response: "
+                + std::string{ std::strerror( errno_copy ) }
+            };
+        return io_status::SUCCESS;
+    }
+    
+    inline connection::_splice_pipe_type::_splice_pipe_type(
+        _splice_pipe_type&& o
+    ) :
+        read_end { o.read_end  },
+        write_end{ o.write_end },
+        pending  { o.pending   }
+    {
+        o.read_end  = -1;
+        o.write_end = -1;
+        o.pending   =  0;
+    }
+    
+    inline connection::_splice_pipe_type::~_splice_pipe_type()
+    {
+        if( read_end != -1 )
+        {
+            close( read_end  );
+            close( write_end );
+        }
+    }
+    
+    inline connection::_splice_pipe_type&
+    connection::_splice_pipe_type::operator =( _splice_pipe_type&& o )
+    {
+        std::swap( read_end , o.read_end  );
+        std::swap( write_end, o.write_end );
+        std::swap( pending  , o.pending   );
+        return *this;
+    }
+    
+    inline io_status connection::_try_send_file(
+        int          file_descriptor,
+        off_t&       offset,
+        std::size_t& remaining
+    )
+    {
+        // Anything written or queued before the file has to go out first,
+        // including the rest of an earlier interrupted call
+        auto status = try_flush();
+        if( status != io_status::SUCCESS )
+            return status;
+        
+        off_t* position{ &offset };
+        if( lseek( file_descriptor, 0, SEEK_CUR ) == -1 && errno == ESPIPE )
+            position = nullptr;
+
+#if defined( __linux__ )
+        // `sendfile()` needs a descriptor it can read at an offset, while
+        // `splice()` works for anything as long as one end is a pipe
+        if( position && _send_file_sendfile(
+            file_descriptor,
+            position,
+            remaining,
+            status
+        ) )
+            return status;
+        if( _send_file_splice(
+            file_descriptor,
+            position,
+            remaining,
+            status
+        ) )
+            return status;
+#endif
+
+        return _send_file_copy( file_descriptor, position, remaining );
+    }
+
+#if defined( __linux__ )
+
+    inline bool connection::_send_file_sendfile(
+        int          file_descriptor,
+        off_t*       position,
+        std::size_t& remaining,
+        io_status&   status
+    )
+    {
+        bool sent_any{ false };
+        status = io_status::SUCCESS;
+        
+        while( remaining > 0 )
+        {
+            if( !_try_wait_to_send() )
+            {
+                status = io_status::TIMEOUT;
+                break;
+            }
+            
+            // Advances `*position` past whatever is sent
+            auto bytes_sent = sendfile(
+                _serve_socket.descriptor,
+                file_descriptor,
+                position,
+                remaining
+            );
+            
+            if( bytes_sent == -1 )
+            {
+                auto errno_copy = errno;
+                if(
+                    !sent_any
+                    && ( errno_copy == EINVAL || errno_copy == ENOSYS )
+                )
+                    return false;
+                status = _send_status( errno_copy );
+                if( status != io_status::SUCCESS )
+                    break;
+            }
+            else if( bytes_sent == 0 )
+                // The file ended early
+                break;
+            else
+            {
+                remaining -= static_cast< std::size_t >( bytes_sent );
+                sent_any   = true;
+            }
+        }
+        
+        return true;
+    }
+    
+    inline bool connection::_send_file_splice(
+        int          file_descriptor,
+        off_t*       position,
+        std::size_t& remaining,
+        io_status&   status
+    )
+    {
+        if( _splice_pipe.read_end == -1 )
+        {
+            int pipe_descriptors[ 2 ];
+            if( pipe2( pipe_descriptors, O_CLOEXEC ) == -1 )
+                return false;
+            _splice_pipe.read_end  = pipe_descriptors[ 0 ];
+            _splice_pipe.write_end = pipe_descriptors[ 1 ];
+        }
+        
+        bool read_any{ false };
+        status = io_status::SUCCESS;
+        
+        while( remaining > 0 )
+        {
+            // `splice()` takes a `loff_t`, which isn't necessarily `off_t`
+            loff_t splice_position{ position ? *position : 0 };
+            auto bytes_read = splice(
+                file_descriptor,
+                position ? &splice_position : nullptr,
+                _splice_pipe.write_end,
+                nullptr,
+                remaining,
+                SPLICE_F_MOVE
+            );
+            
+            if( bytes_read == -1 )
+            {
+                auto errno_copy = errno;
+                if( errno_copy == EINTR )
+                    continue;
+                else if( !read_any && errno_copy == EINVAL )
+                    return false;
+                throw socket_error{
+                    "failure to read file for response: "
+                    + std::string{ std::strerror( errno_copy ) }
+                };
+            }
+            else if( bytes_read == 0 )
+                break;
+            
+            // Once in the pipe the data is as good as sent, as nothing else
+            // can go out before it
+            if( position )
+                *position = static_cast< off_t >( splice_position );
+            remaining           -= static_cast< std::size_t >( bytes_read );
+            _splice_pipe.pending  = static_cast< std::size_t >( bytes_read );
+            read_any              = true;
+            
+            status = _try_send_spliced();
+            if( status != io_status::SUCCESS )
+                break;
+        }
+        
+        return true;
+    }
+    
+    inline io_status connection::_try_send_spliced()
+    {
+        while( _splice_pipe.pending > 0 )
+        {
+            if( !_try_wait_to_send() )
+                return io_status::TIMEOUT;
+            
+            auto bytes_sent = splice(
+                _splice_pipe.read_end,
+                nullptr,
+                _serve_socket.descriptor,
+                nullptr,
+                _splice_pipe.pending,
+                SPLICE_F_MOVE
+            );
+            
+            if( bytes_sent == -1 )
+            {
+                auto status = _send_status( errno );
+                if( status != io_status::SUCCESS )
+                    return status;
+            }
+            else
+                _splice_pipe.pending -= static_cast< std::size_t >(
+                    bytes_sent
+                );
+        }
+        
+        return io_status::SUCCESS;
+    }
+
+#endif
+
+    inline io_status connection::_send_file_copy(
+        int          file_descriptor,
+        off_t*       position,
+        std::size_t& remaining
+    )
+    {
+        while( remaining > 0 )
+        {
+            _reserve_put_buffer();
+            
+            auto count = std::min(
+                remaining,
+                static_cast< std::size_t >( epptr() - pptr() )
+            );
+            auto bytes_read = position ? pread(
+                file_descriptor,
+                pptr(),
+                count,
+                *position
+            ) : read(
+                file_descriptor,
+                pptr(),
+                count
+            );
+            
+            if( bytes_read == -1 )
+            {
+                auto errno_copy = errno;
+                if( errno_copy == EINTR )
+                    continue;
+                throw socket_error{
+                    "failure to read file for response: "
+                    + std::string{ std::strerror( errno_copy ) }
+                };
+            }
+            else if( bytes_read == 0 )
+                break;
+            
+            // Once in the put buffer the data is as good as sent, as a flush
+            // interrupted now picks up where it left off
+            if( position )
+                *position += bytes_read;
+            pbump( static_cast< int >( bytes_read ) );
+            remaining -= static_cast< std::size_t >( bytes_read );
+            
+            auto status = try_flush();
+            if( status != io_status::SUCCESS )
+                return status;
+        }
+        
+        return io_status::SUCCESS;
+    }
+    
+    inline std::streamsize connection::showmanyc()
+    {
+        return egptr() - gptr();
+    }
+    
+    inline connection::int_type connection::underflow()
+    {
+        _throw_if_interrupted( _try_fill() );
+        return traits_type::to_int_type( *gptr() );
+    }
+    
+    inline io_status connection::_try_fill()
+    {
+        if( showmanyc() > 0 )
+            return io_status::SUCCESS;
+        
+        if( _get_buffer_size != _buffer_size )
+        {
+            get_buffer = _allocate_buffer( _buffer_size );
+            _get_buffer_size = _buffer_size;
+            setg(
+                get_buffer.get(),
+                get_buffer.get(),
+                get_buffer.get()
+            );
+        }
+        
+        std::streamsize bytes_read;
+        auto status = _try_read( eback(), _get_buffer_size, bytes_read );
+        if( status != io_status::SUCCESS )
+            return status;
+        
+        setg(
+            eback(),
+            eback(),
+            eback() + bytes_read
+        );
+        return io_status::SUCCESS;
+    }
+    
+    inline std::streamsize connection::xsgetn(
+        char_type* s,
+        std::streamsize count
+    )
+    {
+        std::streamsize bytes_read;
+        _throw_if_interrupted( try_read( s, count, bytes_read ) );
+        return bytes_read;
+    }
+    
+    inline io_status connection::try_read(
+        char*            s,
+        std::streamsize  count,
+        std::streamsize& bytes_read
+    )
+    {
+        bytes_read = 0;
+        if( count < 1 )
+            return io_status::SUCCESS;
+        
+        // Like `read()`, this only waits for more data if none is buffered,
+        // and may return fewer than `count` bytes
+        auto available = showmanyc();
+        
+        if( available < 1 )
+        {
+            // Reads at least as large as the buffer skip it entirely
+            if( count >= _buffer_size )
+                return _try_read( s, count, bytes_read );
+            
+            auto status = _try_fill();
+            if( status != io_status::SUCCESS )
+                return status;
+            available = showmanyc();
+        }
+        
+        if( count > available )
+            count = available;
+        
+        std::memcpy( s, gptr(), static_cast< std::size_t >( count ) );
+        gbump( static_cast< int >( count ) );
+        bytes_read = count;
+        return io_status::SUCCESS;
+    }
+    
+    inline io_status connection::try_write(
+        const char*      s,
+        std::streamsize  count,
+        std::streamsize& bytes_written
+    )
+    {
+        bytes_written = 0;
+        while( bytes_written < count )
+        {
+            _reserve_put_buffer();
+            auto space = epptr() - pptr();
+            if( space < 1 )
+            {
+                // The buffer stays queued if this times out, so the next
+                // call sends the rest of it before taking any more
+                auto status = try_flush();
+                if( status != io_status::SUCCESS )
+                    return status;
+                continue;
+            }
+            
+            auto size = std::min< std::streamsize >(
+                space,
+                count - bytes_written
+            );
+            std::memcpy(
+                pptr(),
+                s + bytes_written,
+                static_cast< std::size_t >( size )
+            );
+            pbump( static_cast< int >( size ) );
+            bytes_written += size;
+        }
+        return io_status::SUCCESS;
+    }
+    
+    inline connection::int_type connection::pbackfail( int_type c )
+    {
+        /*
+        Parameters:
+        `c` - character to put back or `Traits::eof()` if only back out is
+            requested
+        http://en.cppreference.com/w/cpp/io/basic_streambuf/pbackfail
+        */
+        if( traits_type::not_eof( c ) == traits_type::to_int_type( c ) )
+        {
+            if( gptr() > eback() )
+                setg(
+                    eback(),
+                    gptr() - 1,
+                    egptr()
+                );
+            else if( egptr() < eback() + _get_buffer_size )
+            {
+                setg(
+                    eback(),
+                    gptr(),
+                    egptr() + 1
+                );
+                
+                for( char* i = eback(); i < egptr(); ++i )
+                    *( i + 1 ) = *i;
+            }
+            else
+                // No room to back up, can't reallocate buffer
+                return traits_type::eof();
+            
+            *( gptr() ) = traits_type::to_char_type( c );
+            
+            /*
+            Return value:
+            `Traits::eof()` in case of failure, some other value to indicate
+            success.
+            http://en.cppreference.com/w/cpp/io/basic_streambuf/pbackfail
+            */
+            return c;
+        }
+        else
+        {
+            if( gptr() > eback() )
+                setg(
+                    eback(),
+                    gptr() - 1,
+                    egptr()
+                );
+            else
+                // A buffer shift will only work if a character is being put
+                // back, so fail
+                return traits_type::eof();
+            
+            /*
+            Return value:
+            `Traits::eof()` in case of failure, some other value to indicate
+            success.
+            http://en.cppreference.com/w/cpp/io/basic_streambuf/pbackfail
+            */
+            return traits_type::to_int_type( static_cast< char >( ASCII_ACK ) );
+        }
+    }
+    
+    inline std::streamsize connection::xsputn(
+        const char_type* s,
+        std::streamsize count
+    )
+    {
+        auto            space = epptr() - pptr();
+        std::streamsize written{ 0 };
+        
+        if( count <= space )
+        {
+            std::memcpy( pptr(), s, static_cast< std::size_t >( count ) );
+            pbump( static_cast< int >( count ) );
+            return count;
+        }
+        
+        try
+        {
+            if( count < _buffer_size )
+            {
+                // Top off the buffer, send it, and start over with the rest
+                if( space > 0 )
+                {
+                    std::memcpy(
+                        pptr(),
+                        s,
+                        static_cast< std::size_t >( space )
+                    );
+                    pbump( static_cast< int >( space ) );
+                    written = space;
+                }
+                flush();
+                _reserve_put_buffer();
+                
+                std::memcpy(
+                    pptr(),
+                    s + space,
+                    static_cast< std::size_t >( count - space )
+                );
+                pbump( static_cast< int >( count - space ) );
+            }
+            else
+            {
+                // Too big to be worth staging, so send it right after
+                // whatever's buffered in one go
+                _queue( s, static_cast< std::size_t >( count ) );
+                try
+                {
+                    flush();
+                }
+                catch( ... )
+                {
+                    _own_queued( s, static_cast< std::size_t >( count ) );
+                    throw;
+                }
+            }
+        }
+        catch( const socket_error& e )
+        {
+            // Consistent with `overflow()`
+            return written;
+        }
+        
+        return count;
+    }
+    
+    inline connection::int_type connection::overflow( int_type ch )
+    {
+        try
+        {
+            flush();
+        }
+        catch( const socket_error& e )
+        {
+            return traits_type::eof();
+        }
+        
+        _reserve_put_buffer();
+        
+        if( traits_type::not_eof( ch ) == traits_type::to_int_type( ch ) )
+        {
+            *( pptr() ) = traits_type::to_char_type( ch );
+            pbump( 1 );
+            return ch;
+        }
+        else
+            return traits_type::to_int_type( static_cast< char >( ASCII_ACK ) );
+    }
+    
+    inline void connection::_read_header_block()
+    {
+        _throw_if_interrupted( _try_read_header_block() );
+        _request_pending = false;
+    }
+    
+    inline io_status connection::_try_read_header_block()
+    {
+        while( !_parse_buffered_header_block() )
+        {
+            auto status = _try_fill();
+            if( status != io_status::SUCCESS )
+                return status;
+        }
+        
+        if( _request_parser.status() == request_parse_status::FAILED )
+        {
+            _request_pending = false;
+            throw request_parse_error{ _request_parser.error() };
         }
-        else if( count <= available )
+        return io_status::SUCCESS;
+    }
+    
+    inline bool connection::_parse_buffered_header_block()
+    {
+        if( _request_pending )
+            return true;
+        
+        // Only start over once the last request was finished with; otherwise
+        // this picks up wherever a timeout interrupted it
+        if( _request_parser.status() != request_parse_status::INCOMPLETE )
+            _request_parser.reset();
+        
+        std::size_t used;
+        auto status = _request_parser.feed(
+            gptr(),
+            static_cast< std::size_t >( egptr() - gptr() ),
+            used
+        );
+        gbump( static_cast< int >( used ) );
+        
+        if( status == request_parse_status::INCOMPLETE )
+            return false;
+        _request_pending = true;
+        if( status == request_parse_status::COMPLETE )
+            ++_requests_read;
+        return true;
+    }
+    
+    inline io_status connection::try_read_request()
+    {
+        return _try_read_header_block();
+    }
+    
+    template< typename Handler > bool connection::handle_pipelined(
+        Handler handler
+    )
+    {
+        bool keep_open;
+        bool took_request;
+        _batching = true;
+        try
         {
-            std::copy( gptr(), egptr(), s );
-            setg(
-                eback(),
-                gptr() + count,
-                egptr()
+            do
+            {
+                auto was_pending   = _request_pending;
+                auto requests_read = _requests_read;
+                keep_open = handler( *this );
+                // A handler that returns without taking a request would
+                // otherwise be called for the same one forever
+                took_request = !_request_pending && (
+                    was_pending || _requests_read != requests_read
+                );
+            } while(
+                keep_open
+                && took_request
+                && _parse_buffered_header_block()
             );
-            return count;
         }
+        catch( ... )
+        {
+            // Still send the responses to the requests handled so far, but
+            // the original exception is the one worth reporting
+            _batching = false;
+            try
+            {
+                flush();
+            }
+            catch( ... ) {}
+            throw;
+        }
+        _batching = false;
+        flush();
+        return keep_open;
+    }
+    
+    inline connection::connection( connection&& o ) :
+        _serve_socket    { std::move( o._serve_socket     ) },
+        _timeout         { std::move( o._timeout          ) },
+        _server_address  { std::move( o._server_address   ) },
+        _server_port     { std::move( o._server_port      ) },
+        _buffer_size     { std::move( o._buffer_size      ) },
+        _get_buffer_size { std::move( o._get_buffer_size  ) },
+        _buffer_pool     { std::move( o._buffer_pool      ) },
+        get_buffer       { std::move( o.get_buffer        ) },
+        put_buffer       { std::move( o.put_buffer        ) },
+        _request_parser  { std::move( o._request_parser   ) },
+        _request_pending { std::move( o._request_pending  ) },
+        _requests_read   { std::move( o._requests_read    ) },
+        _send_queue      { std::move( o._send_queue       ) },
+        _send_queue_front{ std::move( o._send_queue_front ) },
+        _owned_chunks    { std::move( o._owned_chunks     ) },
+        _put_queued      { std::move( o._put_queued       ) },
+        _batching        { std::move( o._batching         ) },
+        _splice_pipe     { std::move( o._splice_pipe      ) }
+    {
+        setg(
+            o.eback(),
+            o. gptr(),
+            o.egptr()
+        );
+        setp(
+            o.pbase(),
+            o.epptr()
+        );
+        pbump( static_cast< int >( o.pptr() - o.pbase() ) );
+        
+        o.setg( nullptr, nullptr, nullptr );
+        o.setp( nullptr, nullptr );
+    }
+    
+    inline connection& connection::operator =( connection&& o )
+    {
+        std::swap( _serve_socket    , o._serve_socket     );
+        std::swap( _timeout         , o._timeout          );
+        std::swap( _server_address  , o._server_address   );
+        std::swap( _server_port     , o._server_port      );
+        std::swap( _buffer_size     , o._buffer_size      );
+        std::swap( _get_buffer_size , o._get_buffer_size  );
+        std::swap( _buffer_pool     , o._buffer_pool      );
+        std::swap( get_buffer       , o.get_buffer        );
+        std::swap( put_buffer       , o.put_buffer        );
+        std::swap( _request_parser  , o._request_parser   );
+        std::swap( _request_pending , o._request_pending  );
+        std::swap( _requests_read   , o._requests_read    );
+        std::swap( _send_queue      , o._send_queue       );
+        std::swap( _send_queue_front, o._send_queue_front );
+        std::swap( _owned_chunks    , o._owned_chunks     );
+        std::swap( _put_queued      , o._put_queued       );
+        std::swap( _batching        , o._batching         );
+        std::swap( _splice_pipe     , o._splice_pipe      );
+        
+        auto eback_temp = eback();
+        auto  gptr_temp =  gptr();
+        auto egptr_temp = egptr();
+        setg(
+            o.eback(),
+            o. gptr(),
+            o.egptr()
+        );
+        o.setg(
+            eback_temp,
+             gptr_temp,
+            egptr_temp
+        );
+        
+        auto pbase_temp = pbase();
+        auto  pptr_temp =  pptr();
+        auto epptr_temp = epptr();
+        setp(
+            o.pbase(),
+            o.epptr()
+        );
+        pbump( static_cast< int >( o.pptr() - o.pbase() ) );
+        o.setp(
+            pbase_temp,
+            epptr_temp
+        );
+        o.pbump( static_cast< int >( pptr_temp - pbase_temp ) );
+        
+        return *this;
+    }
+    
+    inline int connection::timeout() const
+    {
+        return _timeout;
+    }
+    
+    inline int connection::timeout( int t )
+    {
+        _timeout = t;
+        return _timeout;
+    }
+    
+    inline buffer_size_type connection::buffer_size() const
+    {
+        return _buffer_size;
+    }
+    
+    inline buffer_size_type connection::buffer_size( buffer_size_type s )
+    {
+        if( s < 1 )
+            throw std::invalid_argument{ "buffer size must be at least 1" };
+        _buffer_size = s;
+        return _buffer_size;
+    }
+}
+
+
+namespace show // `show::_request_content` implementation //////////////////////
+{
+    inline _request_content::_request_content( class connection& c ) :
+        _connection            { &c          },
+        _unknown_content_length{ YES         },
+        _content_length        { 0           },
+        read_content           { 0           },
+        _chunk_state           { NOT_CHUNKED },
+        _chunk_size            { 0           },
+        _chunk_remaining       { 0           }
+    {}
+    
+    inline _request_content::_request_content( _request_content&& o ) :
+        _connection            {            o._connection                },
+        _unknown_content_length{ std::move( o._unknown_content_length  ) },
+        _content_length        { std::move( o._content_length          ) },
+        read_content           { std::move( o.read_content             ) },
+        _chunk_state           { std::move( o._chunk_state             ) },
+        _chunk_size            { std::move( o._chunk_size              ) },
+        _chunk_remaining       { std::move( o._chunk_remaining         ) }
+    {
+        // Neither `request` nor `request_view` can use an implicit or explicit
+        // default move constructor, as that relies on the `std::streambuf`
+        // implementation to be move-friendly, which unfortunately it doesn't
+        // seem to be for some of the major compilers.
+        o._connection = nullptr;
+    }
+    
+    inline void _request_content::_swap_content( _request_content& o )
+    {
+        std::swap( _connection            , o._connection              );
+        std::swap( read_content           , o.read_content             );
+        std::swap( _unknown_content_length, o._unknown_content_length  );
+        std::swap( _content_length        , o._content_length          );
+        std::swap( _chunk_state           , o._chunk_state             );
+        std::swap( _chunk_size            , o._chunk_size              );
+        std::swap( _chunk_remaining       , o._chunk_remaining         );
+    }
+    
+    inline void _request_content::_parse_content_length(
+        std::size_t        header_count,
+        const std::string& first_value
+    )
+    {
+        if( header_count < 1 )
+            _unknown_content_length = YES;
+        else if( header_count > 1 )
+            _unknown_content_length = MAYBE;
         else
-            return xsgetn( s, available );
+            try
+            {
+                std::size_t convert_stopped;
+                _content_length = std::stoull(
+                    first_value,
+                    &convert_stopped,
+                    10
+                );
+                if( convert_stopped < first_value.size() )
+                    _unknown_content_length = MAYBE;
+                else
+                    _unknown_content_length = NO;
+            }
+            catch( const std::invalid_argument& e )
+            {
+                _unknown_content_length = MAYBE;
+            }
     }
     
-    inline connection::int_type connection::pbackfail( int_type c )
+    inline string_view _request_content::_last_transfer_coding(
+        string_view value
+    )
     {
-        /*
-        Parameters:
-        `c` - character to put back or `Traits::eof()` if only back out is
-            requested
-        http://en.cppreference.com/w/cpp/io/basic_streambuf/pbackfail
-        */
-        if( traits_type::not_eof( c ) == traits_type::to_int_type( c ) )
+        auto is_space = []( char c ){ return c == ' ' || c == '\t'; };
+        
+        // Lists may contain empty elements, which don't count
+        auto end = value.size();
+        while( true )
         {
-            if( gptr() > eback() )
-                setg(
-                    eback(),
-                    gptr() - 1,
-                    egptr()
-                );
-            else if( egptr() < eback() + BUFFER_SIZE )
+            while( end > 0 && is_space( value[ end - 1 ] ) )
+                --end;
+            if( end == 0 || value[ end - 1 ] != ',' )
+                break;
+            --end;
+        }
+        auto start = end;
+        while( start > 0 && value[ start - 1 ] != ',' )
+            --start;
+        while( start < end && is_space( value[ start ] ) )
+            ++start;
+        
+        return value.substr( start, end - start );
+    }
+    
+    inline void _request_content::_parse_transfer_encoding(
+        string_view final_coding
+    )
+    {
+        // Falling back to "Content-Length" here would let a proxy & this
+        // server disagree on where the request ends
+        if( !_equal_ignore_case_ASCII( final_coding, "chunked" ) )
+            throw request_parse_error{
+                "final transfer coding is not chunked"
+            };
+        
+        _unknown_content_length = YES;
+        _content_length         = 0;
+        _chunk_state            = CHUNK_SIZE_START;
+    }
+    
+    inline bool _request_content::_next_chunk_data( bool wait )
+    {
+        while( _chunk_state != CHUNKS_DONE )
+        {
+            if( _chunk_state == CHUNK_DATA )
             {
-                setg(
-                    eback(),
-                    gptr(),
-                    egptr() + 1
-                );
-                
-                for( char* i = eback(); i < egptr(); ++i )
-                    *( i + 1 ) = *i;
+                if( _chunk_remaining > 0 )
+                    break;
+                _chunk_state = CHUNK_DATA_END;
             }
-            else
-                // No room to back up, can't reallocate buffer
-                return traits_type::eof();
-            
-            *( gptr() ) = traits_type::to_char_type( c );
             
-            /*
-            Return value:
-            `Traits::eof()` in case of failure, some other value to indicate
-            success.
-            http://en.cppreference.com/w/cpp/io/basic_streambuf/pbackfail
-            */
-            return c;
+            if( !wait && _connection -> showmanyc() < 1 )
+                return false;
+            auto c = _connection -> sbumpc();
+            if( traits_type::not_eof( c ) != c )
+                throw client_disconnected{};
+            _decode_chunk_framing( traits_type::to_char_type( c ) );
         }
-        else
+        return true;
+    }
+    
+    inline void _request_content::_decode_chunk_framing( char c )
+    {
+        auto malformed_line_ending = [](){
+            return request_parse_error{ "malformed HTTP line ending" };
+        };
+        
+        switch( _chunk_state )
         {
-            if( gptr() > eback() )
-                setg(
-                    eback(),
-                    gptr() - 1,
-                    egptr()
-                );
+        case CHUNK_SIZE_START:
+        case CHUNK_SIZE:
+            {
+                auto digit = _url_hex_values()[
+                    static_cast< unsigned char >( c )
+                ];
+                if( digit >= 0 )
+                {
+                    if( _chunk_size > ( ~0ull >> 4 ) )
+                        throw request_parse_error{ "chunk size too large" };
+                    _chunk_size = (
+                        ( _chunk_size << 4 )
+                        | static_cast< unsigned long long >( digit )
+                    );
+                    _chunk_state = CHUNK_SIZE;
+                    return;
+                }
+            }
+            if( _chunk_state == CHUNK_SIZE_START )
+                throw request_parse_error{ "malformed chunk size" };
+            if( c == ';' || c == ' ' || c == '\t' )
+                _chunk_state = CHUNK_EXTENSION;
+            else if( c == '\r' )
+                _chunk_state = CHUNK_SIZE_LF;
+            else if( c == '\n' )
+                break;
             else
-                // A buffer shift will only work if a character is being put
-                // back, so fail
-                return traits_type::eof();
-            
-            /*
-            Return value:
-            `Traits::eof()` in case of failure, some other value to indicate
-            success.
-            http://en.cppreference.com/w/cpp/io/basic_streambuf/pbackfail
-            */
-            return traits_type::to_int_type( static_cast< char >( ASCII_ACK ) );
+                throw request_parse_error{ "malformed chunk size" };
+            return;
+        
+        case CHUNK_EXTENSION:
+            if( c == '\r' )
+                _chunk_state = CHUNK_SIZE_LF;
+            else if( c == '\n' )
+                break;
+            return;
+        
+        case CHUNK_SIZE_LF:
+            if( c != '\n' )
+                throw malformed_line_ending();
+            break;
+        
+        case CHUNK_DATA_END:
+            if( c == '\r' )
+                _chunk_state = CHUNK_DATA_LF;
+            else if( c == '\n' )
+            {
+                _chunk_state = CHUNK_SIZE_START;
+                _chunk_size  = 0;
+            }
+            else
+                throw request_parse_error{ "chunk larger than its size" };
+            return;
+        
+        case CHUNK_DATA_LF:
+            if( c != '\n' )
+                throw malformed_line_ending();
+            _chunk_state = CHUNK_SIZE_START;
+            _chunk_size  = 0;
+            return;
+        
+        case TRAILER_START:
+            if( c == '\r' )
+                _chunk_state = TRAILER_END_LF;
+            else if( c == '\n' )
+                _chunk_state = CHUNKS_DONE;
+            else
+                _chunk_state = TRAILER;
+            return;
+        
+        case TRAILER:
+            if( c == '\r' )
+                _chunk_state = TRAILER_LF;
+            else if( c == '\n' )
+                _chunk_state = TRAILER_START;
+            return;
+        
+        case TRAILER_LF:
+            if( c != '\n' )
+                throw malformed_line_ending();
+            _chunk_state = TRAILER_START;
+            return;
+        
+        case TRAILER_END_LF:
+            if( c != '\n' )
+                throw malformed_line_ending();
+            _chunk_state = CHUNKS_DONE;
+            return;
+        
+        default:
+            return;
+        }
+        
+        // End of a chunk size line; the last chunk is empty
+        if( _chunk_size > 0 )
+        {
+            _chunk_state     = CHUNK_DATA;
+            _chunk_remaining = _chunk_size;
+        }
+        else
+            _chunk_state = TRAILER_START;
+    }
+    
+    inline bool _request_content::eof() const
+    {
+        if( chunked() )
+            return _chunk_state == CHUNKS_DONE;
+        return !_unknown_content_length && read_content >= _content_length;
+    }
+    
+    inline void _request_content::flush()
+    {
+        while( !eof() ) sbumpc();
+    }
+    
+    inline std::streamsize _request_content::showmanyc()
+    {
+        if( chunked() )
+        {
+            // Only counts the rest of the current chunk, as the next one
+            // might not have arrived yet
+            if( !_next_chunk_data( false ) )
+                return 0;
+            if( eof() )
+                return -1;
+            auto in_connection = _connection -> showmanyc();
+            return static_cast< unsigned long long >( in_connection )
+                < _chunk_remaining
+                ? in_connection
+                : static_cast< std::streamsize >( _chunk_remaining );
+        }
+        else if( eof() )
+            return -1;
+        else
+        {
+            // Don't just return `remaining` as that may cause reading to hang
+            // on unresponsive clients (trying to read bytes we don't have yet)
+            auto remaining = static_cast< std::streamsize >(
+                _content_length - read_content
+            );
+            auto in_connection = _connection -> showmanyc();
+            return in_connection < remaining ? in_connection : remaining;
+        }
+    }
+    
+    inline _request_content::int_type _request_content::underflow()
+    {
+        if( chunked() )
+            _next_chunk_data( true );
+        if( eof() )
+            return traits_type::eof();
+        else
+        {
+            auto c = _connection -> underflow();
+            if( c != traits_type::not_eof( c ) )
+                throw client_disconnected{};
+            return c;
         }
     }
     
-    inline std::streamsize connection::xsputn(
-        const char_type* s,
+    inline _request_content::int_type _request_content::uflow()
+    {
+        if( chunked() )
+            _next_chunk_data( true );
+        if( eof() )
+            return traits_type::eof();
+        auto c = _connection -> uflow();
+        if( traits_type::not_eof( c ) != c )
+            throw client_disconnected{};
+        ++read_content;
+        if( chunked() )
+            --_chunk_remaining;
+        return c;
+    }
+    
+    inline std::streamsize _request_content::xsgetn(
+        char_type* s,
         std::streamsize count
     )
     {
-        std::streamsize chars_written{ 0 };
+        std::streamsize read;
         
-        while(
-            chars_written < count
-            && traits_type::not_eof(
-                sputc( traits_type::to_char_type( s[ chars_written ] ) )
-            ) == traits_type::to_int_type( s[ chars_written ] )
-        )
-            ++chars_written;
+        if( chunked() )
+        {
+            // Copies straight out of the connection a chunk at a time; once
+            // something has been read, stops rather than wait for more
+            read = 0;
+            while( read < count && _next_chunk_data( read == 0 ) && !eof() )
+            {
+                auto want = static_cast< unsigned long long >( count - read );
+                auto got = _connection -> sgetn(
+                    s + read,
+                    static_cast< std::streamsize >(
+                        want < _chunk_remaining ? want : _chunk_remaining
+                    )
+                );
+                _chunk_remaining -= static_cast< unsigned long long >( got );
+                read             += got;
+                if( _connection -> showmanyc() < 1 )
+                    break;
+            }
+        }
+        else if( _unknown_content_length )
+            read = _connection -> sgetn( s, count );
+        else if( !eof() )
+        {
+            auto remaining = static_cast< std::streamsize >(
+                _content_length - read_content
+            );
+            read = _connection -> sgetn(
+                s,
+                count > remaining ? remaining : count
+            );
+        }
+        else
+            return 0;
         
-        return chars_written;
+        read_content += read;
+        return read;
     }
     
-    inline connection::int_type connection::overflow( int_type ch )
+    inline _request_content::int_type _request_content::pbackfail( int_type c )
     {
-        try
-        {
-            flush();
-        }
-        catch( const socket_error& e )
-        {
+        // Can't put back past the start of the current chunk's data
+        if( chunked() && !(
+            _chunk_state == CHUNK_DATA && _chunk_remaining < _chunk_size
+        ) )
             return traits_type::eof();
+        
+        auto result = _connection -> pbackfail( c );
+        
+        if( traits_type::not_eof( result ) == result )
+        {
+            --read_content;
+            if( chunked() )
+                ++_chunk_remaining;
         }
         
-        if( traits_type::not_eof( ch ) == traits_type::to_int_type( ch ) )
+        return result;
+    }
+}
+
+
+namespace show // Header tokenizing ////////////////////////////////////////////
+{
+    inline bool _is_header_delimiter( char c )
+    {
+        switch( c )
         {
-            *( pptr() ) = traits_type::to_char_type( ch );
-            pbump( 1 );
-            return ch;
+        case ' ':
+        case '?':
+        case '\t':
+        case '\r':
+        case '\n':
+        case ':':
+            return true;
+        default:
+            return false;
         }
-        else
-            return traits_type::to_int_type( static_cast< char >( ASCII_ACK ) );
     }
     
-    inline connection::connection( connection&& o ) :
-        _serve_socket  { std::move( o._serve_socket   ) },
-        get_buffer     { std::move( o.get_buffer      ) },
-        put_buffer     { std::move( o.put_buffer      ) },
-        _timeout       { std::move( o._timeout        ) },
-        _server_address{ std::move( o._server_address ) },
-        _server_port   { std::move( o._server_port    ) }
+    inline const char* _find_header_delimiter_scalar(
+        const char* begin,
+        const char* end
+    )
     {
-        setg(
-            o.eback(),
-            o. gptr(),
-            o.egptr()
-        );
-        setp(
-            o.pbase(),
-            o.epptr()
-        );
+        while( begin < end && !_is_header_delimiter( *begin ) )
+            ++begin;
+        return begin;
     }
-    
-    inline connection& connection::operator =( connection&& o )
+
+#if defined( SHOW_X86_SIMD )
+
+    __attribute__(( target( "sse4.2" ) ))
+    inline const char* _find_header_delimiter_sse42(
+        const char* begin,
+        const char* end
+    )
     {
-        std::swap( _serve_socket  , o._serve_socket   );
-        std::swap( get_buffer     , o.get_buffer      );
-        std::swap( put_buffer     , o.put_buffer      );
-        std::swap( _timeout       , o._timeout        );
-        std::swap( _server_address, o._server_address );
-        std::swap( _server_port   , o._server_port    );
-        
-        auto eback_temp = eback();
-        auto  gptr_temp =  gptr();
-        auto egptr_temp = egptr();
-        setg(
-            o.eback(),
-            o. gptr(),
-            o.egptr()
-        );
-        o.setg(
-            eback_temp,
-             gptr_temp,
-            egptr_temp
-        );
+        const __m128i delimiters{ _mm_setr_epi8(
+            ' ', '?', '\t', '\r', '\n', ':', 0, 0,
+            0  , 0  , 0   , 0   , 0   , 0  , 0, 0
+        ) };
         
-        auto pbase_temp = pbase();
-        auto epptr_temp = epptr();
-        setp(
-            o.pbase(),
-            o.epptr()
-        );
-        o.setp(
-            pbase_temp,
-            epptr_temp
-        );
+        while( end - begin >= 16 )
+        {
+            auto chunk = _mm_loadu_si128(
+                reinterpret_cast< const __m128i* >( begin )
+            );
+            auto index = _mm_cmpestri(
+                delimiters,
+                6,
+                chunk,
+                16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT
+            );
+            if( index < 16 )
+                return begin + index;
+            begin += 16;
+        }
         
-        return *this;
+        return _find_header_delimiter_scalar( begin, end );
     }
     
-    inline int connection::timeout() const
+    __attribute__(( target( "avx2" ) ))
+    inline const char* _find_header_delimiter_avx2(
+        const char* begin,
+        const char* end
+    )
     {
-        return _timeout;
+        // Most header tokens are shorter than 16 bytes, so check the first 16
+        // with SSE4.2 (which every CPU with AVX2 also has) before paying to
+        // set up the wider search
+        if( end - begin >= 16 )
+        {
+            auto found = _find_header_delimiter_sse42( begin, begin + 16 );
+            if( found < begin + 16 )
+                return found;
+            begin += 16;
+        }
+        
+        // Every delimiter has a distinct low nibble except '\n' & ':', so two
+        // shuffles by low nibble produce, for each byte, the delimiter(s) it
+        // would have to equal.  Bytes with the high bit set shuffle to 0, and
+        // unused entries are 0xFF, so neither can cause a false match.
+        const auto delimiters_1{ _mm256_setr_epi8(
+            ' ', -1  , -1  , -1, -1, -1  , -1, -1 ,
+            -1 , '\t', '\n', -1, -1, '\r', -1, '?',
+            ' ', -1  , -1  , -1, -1, -1  , -1, -1 ,
+            -1 , '\t', '\n', -1, -1, '\r', -1, '?'
+        ) };
+        const auto delimiters_2{ _mm256_setr_epi8(
+            -1, -1, -1 , -1, -1, -1, -1, -1,
+            -1, -1, ':', -1, -1, -1, -1, -1,
+            -1, -1, -1 , -1, -1, -1, -1, -1,
+            -1, -1, ':', -1, -1, -1, -1, -1
+        ) };
+        
+        while( end - begin >= 32 )
+        {
+            auto chunk = _mm256_loadu_si256(
+                reinterpret_cast< const __m256i* >( begin )
+            );
+            auto matches = _mm256_or_si256(
+                _mm256_cmpeq_epi8(
+                    chunk,
+                    _mm256_shuffle_epi8( delimiters_1, chunk )
+                ),
+                _mm256_cmpeq_epi8(
+                    chunk,
+                    _mm256_shuffle_epi8( delimiters_2, chunk )
+                )
+            );
+            auto mask = static_cast< unsigned int >(
+                _mm256_movemask_epi8( matches )
+            );
+            if( mask )
+                return begin + __builtin_ctz( mask );
+            begin += 32;
+        }
+        
+        return _find_header_delimiter_sse42( begin, end );
     }
-    
-    inline int connection::timeout( int t )
+
+#endif
+
+    // Finds the first of ' ', '?', '\t', '\r', '\n', or ':' in [begin, end),
+    // returning `end` if there is none.  The request parsers use this to
+    // consume runs of ordinary characters a whole token at a time rather than
+    // a byte at a time.  The implementation is picked once, on first use.
+    inline const char* _find_header_delimiter(
+        const char* begin,
+        const char* end
+    )
     {
-        _timeout = t;
-        return _timeout;
+        using finder_type = const char* (*)( const char*, const char* );
+        
+        static const finder_type finder{ [](){
+#if defined( SHOW_X86_SIMD )
+            __builtin_cpu_init();
+            if( __builtin_cpu_supports( "avx2" ) )
+                return static_cast< finder_type >(
+                    &_find_header_delimiter_avx2
+                );
+            if( __builtin_cpu_supports( "sse4.2" ) )
+                return static_cast< finder_type >(
+                    &_find_header_delimiter_sse42
+                );
+#endif
+            return static_cast< finder_type >(
+                &_find_header_delimiter_scalar
+            );
+        }() };
+        
+        return finder( begin, end );
     }
 }
 
 
-namespace show // `show::request` implementation ///////////////////////////////
+namespace show // `show::header_parser` implementation /////////////////////////
 {
-    inline request::request( request&& o ) :
-        _connection            {            o._connection                },
-        read_content           { std::move( o.read_content             ) },
-        _protocol              { std::move( o._protocol                ) },
-        _protocol_string       { std::move( o._protocol_string         ) },
-        _method                { std::move( o._method                  ) },
-        _path                  { std::move( o._path                    ) },
-        _query_args            { std::move( o._query_args              ) },
-        _headers               { std::move( o._headers                 ) },
-        _unknown_content_length{ std::move( o._unknown_content_length  ) },
-        _content_length        { std::move( o._content_length          ) }
+    inline header_parser::header_parser(
+        std::size_t max_fields,
+        std::size_t max_block_size
+    ) :
+        _max_fields    { max_fields     },
+        _max_block_size{ max_block_size },
+        _line_empty    { true           },
+        _after_cr      { false          }
+    {}
+    
+    inline void header_parser::reset()
     {
-        // `request` can use neither an implicit nor explicit default move
-        // constructor, as that relies on the `std::streambuf` implementation to
-        // be move-friendly, which unfortunately it doesn't seem to be for some
-        // of the major compilers.
-        o._connection = nullptr;
+        _block.clear();
+        _fields.clear();
+        _line_empty = true;
+        _after_cr   = false;
     }
     
-    inline request& request::operator =( request&& o )
+    inline header_parse_status header_parser::append(
+        const char*  begin,
+        const char*  end,
+        std::size_t& used
+    )
     {
-        std::swap( _connection            , o._connection              );
-        std::swap( read_content           , o.read_content             );
-        std::swap( _protocol              , o._protocol                );
-        std::swap( _protocol_string       , o._protocol_string         );
-        std::swap( _method                , o._method                  );
-        std::swap( _path                  , o._path                    );
-        std::swap( _query_args            , o._query_args              );
-        std::swap( _headers               , o._headers                 );
-        std::swap( _unknown_content_length, o._unknown_content_length  );
-        std::swap( _content_length        , o._content_length          );
+        used = 0;
         
-        return *this;
+        for( auto c = begin; c < end; ++c )
+        {
+            // \r\n does not make the FSM parser happy
+            if( _after_cr && *c != '\n' )
+                return header_parse_status::MALFORMED_LINE_ENDING;
+            
+            if( *c == '\r' )
+            {
+                _after_cr = true;
+                continue;
+            }
+            _after_cr = false;
+            
+            if( *c == '\n' )
+            {
+                if( _line_empty )
+                {
+                    used = static_cast< std::size_t >( c + 1 - begin );
+                    if( _block.size() + used > _max_block_size )
+                        return header_parse_status::HEADERS_TOO_LARGE;
+                    _block.insert( _block.end(), begin, c + 1 );
+                    return header_parse_status::SUCCESS;
+                }
+                _line_empty = true;
+            }
+            else
+                _line_empty = false;
+        }
+        
+        used = static_cast< std::size_t >( end - begin );
+        if( _block.size() + used > _max_block_size )
+            return header_parse_status::HEADERS_TOO_LARGE;
+        _block.insert( _block.end(), begin, end );
+        return header_parse_status::INCOMPLETE;
     }
     
-    inline request::request( class connection& c ) :
-        _connection { &c },
-        read_content{ 0  }
+    inline header_parse_status header_parser::parse_fields(
+        std::size_t offset
+    )
     {
-        int  bytes_read;
-        bool reading                   { true  };
+        // Nothing kept is longer than what was read, so the fields are
+        // compacted in place towards the start of the block
+        _fields.clear();
+        
+        auto        buffer    = _block.data();
+        auto        size      = _block.size();
+        std::size_t write_pos { offset };
+        
         int  seq_newlines              { 0     };
-        bool in_endline_seq            { false };
         // See https://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2
         bool check_for_multiline_header{ false };
-        bool path_begun                { false };
-        std::stack< std::string > key_buffer_stack;
-        std::string key_buffer, value_buffer;
+        span key  { write_pos, 0 };
+        span value{ write_pos, 0 };
         
         enum {
-            READING_METHOD,
-            READING_PATH,
-            READING_QUERY_ARGS,
-            READING_PROTOCOL,
             READING_HEADER_NAME,
             READING_HEADER_PADDING,
             READING_HEADER_VALUE
-        } parse_state{ READING_METHOD };
+        } parse_state{ READING_HEADER_NAME };
         
-        while( reading )
+        for( auto read_pos = offset; read_pos < size; ++read_pos )
         {
-            auto current_char = connection::traits_type::to_char_type(
-                _connection -> sbumpc()
-            );
-            
-            // \r\n does not make the FSM parser happy
-            if( in_endline_seq )
+            // Runs of characters with no special meaning are moved a whole
+            // token at a time
+            if(
+                !check_for_multiline_header
+                && parse_state != READING_HEADER_PADDING
+            )
             {
-                if( current_char == '\n' )
-                    in_endline_seq = false;
-                else
-                    throw request_parse_error{
-                        "malformed HTTP line ending"
-                    };
+                auto run_begin = buffer + read_pos;
+                auto run_size  = static_cast< std::size_t >(
+                    _find_header_delimiter( run_begin, buffer + size )
+                    - run_begin
+                );
+                
+                if( run_size > 0 )
+                {
+                    if( parse_state == READING_HEADER_NAME )
+                        for( std::size_t i = 0; i < run_size; ++i )
+                        {
+                            auto c = run_begin[ i ];
+                            if( !(
+                                   ( c >= 'a' && c <= 'z' )
+                                || ( c >= 'A' && c <= 'Z' )
+                                || ( c >= '0' && c <= '9' )
+                                || c == '-'
+                            ) )
+                                return header_parse_status::MALFORMED_HEADER;
+                        }
+                    else
+                        value.size += run_size;
+                    
+                    std::memmove( buffer + write_pos, run_begin, run_size );
+                    write_pos    += run_size;
+                    seq_newlines  = 0;
+                    read_pos     += run_size - 1;
+                    continue;
+                }
             }
             
-            if( current_char == '\n' )
-                ++seq_newlines;
-            else if( current_char == '\r' )
-            {
-                in_endline_seq = true;
+            auto current_char = buffer[ read_pos ];
+            
+            // `append()` already made sure every \r is followed by a \n
+            if( current_char == '\r' )
                 continue;
-            }
+            else if( current_char == '\n' )
+                ++seq_newlines;
             else
                 seq_newlines = 0;
             
             switch( parse_state )
-            {
-            case READING_METHOD:
-                {
-                    switch( current_char )
-                    {
-                    case ' ':
-                        parse_state = READING_PATH;
-                        break;
-                    default:
-                        _method += _ASCII_upper( current_char );
-                        break;
-                    }
-                }
-                break;
-                
-            case READING_PATH:
-                {
-                    switch( current_char )
-                    {
-                    case '?':
-                        parse_state = READING_QUERY_ARGS;
-                        break;
-                    case '\n':
-                        parse_state = READING_HEADER_NAME;
-                        break;
-                    case ' ':
-                        parse_state = READING_PROTOCOL;
-                        break;
-                    case '/':
-                        if( path_begun )
-                            try
-                            {
-                                if( _path.size() < 1 )
-                                    _path.push_back( "" );
-                                *_path.rbegin() = url_decode(
-                                    *_path.rbegin()
-                                );
-                                _path.push_back( "" );
-                            }
-                            catch( const url_decode_error& ude )
-                            {
-                                throw request_parse_error{ ude.what() };
-                            }
-                        else
-                            path_begun = true;
-                        break;
-                    default:
-                        if( _path.size() < 1 )
-                        {
-                            path_begun = true;
-                            _path.push_back( std::string( &current_char, 1 ) );
-                        }
-                        else
-                            _path[ _path.size() - 1 ] += current_char;
-                        break;
-                    }
-                    
-                    if(
-                        parse_state != READING_PATH
-                        && _path.size() > 0
-                    )
-                        try
-                        {
-                            *_path.rbegin() = url_decode( *_path.rbegin() );
-                        }
-                        catch( const url_decode_error& ude )
-                        {
-                            throw request_parse_error{ ude.what() };
-                        }
-                }
-                break;
-                
-            case READING_QUERY_ARGS:
-                {
-                    switch( current_char )
-                    {
-                    case '=':
-                        key_buffer_stack.push( "" );
-                        break;
-                    case '\n':
-                    case ' ':
-                    case '&':
-                        if( key_buffer_stack.size() > 1 )
-                            try
-                            {
-                                value_buffer = url_decode(
-                                    key_buffer_stack.top()
-                                );
-                                key_buffer_stack.pop();
-                            }
-                            catch( const url_decode_error& ude )
-                            {
-                                throw request_parse_error{ ude.what() };
-                            }
-                        else
-                            value_buffer = "";
-                        
-                        while( !key_buffer_stack.empty() )
-                            try
-                            {
-                                _query_args[
-                                    url_decode( key_buffer_stack.top() )
-                                ].push_back( value_buffer );
-                                key_buffer_stack.pop();
-                            }
-                            catch( const url_decode_error& ude )
-                            {
-                                throw request_parse_error{ ude.what() };
-                            }
-                        
-                        if( current_char == '\n' )
-                            parse_state = READING_HEADER_NAME;
-                        else if( current_char == ' ' )
-                            parse_state = READING_PROTOCOL;
-                        
-                        break;
-                    default:
-                        if( key_buffer_stack.empty() )
-                            key_buffer_stack.push( "" );
-                        key_buffer_stack.top() += current_char;
-                        break;
-                    }
-                }
-                break;
-                
-            case READING_PROTOCOL:
-                if( current_char == '\n' )
-                    parse_state = READING_HEADER_NAME;
-                else
-                    _protocol_string += current_char;
-                break;
-                
+            {
             case READING_HEADER_NAME:
                 {
                     switch( current_char )
                     {
                     case ':':
+                        key.size    = write_pos - key.offset;
+                        value       = { write_pos, 0 };
                         parse_state = READING_HEADER_PADDING;
                         break;
                     case '\n':
-                        if( key_buffer.size() < 1 )
-                        {
-                            reading = false;
-                            break;
-                        }
+                        if( write_pos == key.offset )
+                            return header_parse_status::SUCCESS;
                     default:
                         if( !(
                                ( current_char >= 'a' && current_char <= 'z' )
@@ -1096,14 +3830,14 @@ namespace show // `show::request` implementation ///////////////////////////////
                             || ( current_char >= '0' && current_char <= '9' )
                             || current_char == '-'
                         ) )
-                            throw request_parse_error{ "malformed header" };
+                            return header_parse_status::MALFORMED_HEADER;
                         
-                        key_buffer += current_char;
+                        buffer[ write_pos++ ] = current_char;
                         break;
                     }
                 }
                 break;
-                
+            
             case READING_HEADER_PADDING:
                 if( current_char == ' ' || current_char == '\t' )
                 {
@@ -1113,8 +3847,8 @@ namespace show // `show::request` implementation ///////////////////////////////
                 else if( current_char == '\n' )
                     parse_state = READING_HEADER_VALUE;
                 else
-                    throw request_parse_error{ "malformed header" };
-                
+                    return header_parse_status::MALFORMED_HEADER;
+            
             case READING_HEADER_VALUE:
                 {
                     switch( current_char )
@@ -1123,17 +3857,8 @@ namespace show // `show::request` implementation ///////////////////////////////
                         if( seq_newlines >= 2 )
                         {
                             if( check_for_multiline_header )
-                            {
-                                if( value_buffer.size() < 1 )
-                                    throw request_parse_error{
-                                        "missing header value"
-                                    };
-                                _headers[ key_buffer ].push_back(
-                                    value_buffer
-                                );
-                            }
-                            
-                            reading = false;
+                                return _push_field( key, value );
+                            return header_parse_status::SUCCESS;
                         }
                         else
                             check_for_multiline_header = true;
@@ -1142,35 +3867,31 @@ namespace show // `show::request` implementation ///////////////////////////////
                     case '\t':
                         if( check_for_multiline_header )
                             check_for_multiline_header = false;
-                        if(
-                            value_buffer.size() > 0
-                            && *value_buffer.rbegin() != ' '
-                        )
-                            value_buffer += ' ';
+                        if( value.size > 0 && buffer[ write_pos - 1 ] != ' ' )
+                        {
+                            buffer[ write_pos++ ] = ' ';
+                            ++value.size;
+                        }
                         break;
                     default:
                         if( check_for_multiline_header )
                         {
-                            if( value_buffer.size() < 1 )
-                                throw request_parse_error{
-                                    "missing header value"
-                                };
-                            
-                            _headers[ key_buffer ].push_back(
-                                value_buffer
-                            );
+                            auto status = _push_field( key, value );
+                            if( status != header_parse_status::SUCCESS )
+                                return status;
                             
                             // Start new key with current value
-                            key_buffer = current_char;
-                            value_buffer = "";
+                            key   = { write_pos, 0 };
+                            value = { write_pos, 0 };
+                            buffer[ write_pos++ ] = current_char;
                             check_for_multiline_header = false;
                             
                             parse_state = READING_HEADER_NAME;
                         }
                         else
                         {
-                            value_buffer += current_char;
-                            check_for_multiline_header = false;
+                            buffer[ write_pos++ ] = current_char;
+                            ++value.size;
                         }
                         break;
                     }
@@ -1179,139 +3900,664 @@ namespace show // `show::request` implementation ///////////////////////////////
             }
         }
         
-        std::string protocol_string_upper{ _ASCII_upper( _protocol_string ) };
+        // Only reachable if the block wasn't completed by `append()`
+        return header_parse_status::INCOMPLETE;
+    }
+    
+    inline header_parse_status header_parser::_push_field(
+        const span& key,
+        const span& value
+    )
+    {
+        if( value.size < 1 )
+            return header_parse_status::MISSING_HEADER_VALUE;
+        if( _fields.size() >= _max_fields )
+            return header_parse_status::TOO_MANY_HEADERS;
+        _fields.push_back( { key, value } );
+        return header_parse_status::SUCCESS;
+    }
+    
+    inline string_view header_parser::view( const span& s ) const
+    {
+        return { _block.data() + s.offset, s.size };
+    }
+    
+    inline string_view header_parser::name( std::size_t i ) const
+    {
+        return view( _fields.at( i ).first );
+    }
+    
+    inline string_view header_parser::value( std::size_t i ) const
+    {
+        return view( _fields.at( i ).second );
+    }
+    
+    inline void header_parser::copy_to( headers_type& headers ) const
+    {
+        for( const auto& field : _fields )
+            headers[ view( field.first ).to_string() ].push_back(
+                view( field.second ).to_string()
+            );
+    }
+    
+    inline void header_parser::copy_to( header_map& headers ) const
+    {
+        for( const auto& field : _fields )
+            headers.add( view( field.first ), view( field.second ) );
+    }
+    
+    inline std::size_t header_parser::max_fields() const
+    {
+        return _max_fields;
+    }
+    
+    inline std::size_t header_parser::max_fields( std::size_t m )
+    {
+        _max_fields = m;
+        return _max_fields;
+    }
+    
+    inline std::size_t header_parser::max_block_size() const
+    {
+        return _max_block_size;
+    }
+    
+    inline std::size_t header_parser::max_block_size( std::size_t m )
+    {
+        _max_block_size = m;
+        return _max_block_size;
+    }
+    
+    inline const char* _header_parse_error_message( header_parse_status status )
+    {
+        switch( status )
+        {
+        case header_parse_status::MALFORMED_LINE_ENDING:
+            return "malformed HTTP line ending";
+        case header_parse_status::MALFORMED_HEADER:
+            return "malformed header";
+        case header_parse_status::MISSING_HEADER_VALUE:
+            return "missing header value";
+        case header_parse_status::TOO_MANY_HEADERS:
+            return "too many headers";
+        case header_parse_status::HEADERS_TOO_LARGE:
+            return "header block too large";
+        case header_parse_status::INCOMPLETE:
+            return "incomplete header block";
+        default:
+            return "header parse succeeded";
+        }
+    }
+}
+
+
+namespace show // Request line parsing /////////////////////////////////////////
+{
+    // Splits & decodes a raw (still URL-encoded) path into its elements
+    inline std::vector< std::string > _decode_path( string_view raw )
+    {
+        std::vector< std::string > path;
+        bool path_begun{ false };
         
-        if( protocol_string_upper == "HTTP/1.0" )
-            _protocol = HTTP_1_0;
-        else if( protocol_string_upper == "HTTP/1.1" )
-            _protocol = HTTP_1_1;
-        else if( protocol_string_upper == "" )
-            _protocol = NONE;
-        else
-            _protocol = UNKNOWN;
+        try
+        {
+            for( auto current_char : raw )
+                if( current_char == '/' )
+                {
+                    if( path_begun )
+                    {
+                        if( path.size() < 1 )
+                            path.push_back( "" );
+                        *path.rbegin() = url_decode( *path.rbegin() );
+                        path.push_back( "" );
+                    }
+                    else
+                        path_begun = true;
+                }
+                else if( path.size() < 1 )
+                {
+                    path_begun = true;
+                    path.push_back( std::string( &current_char, 1 ) );
+                }
+                else
+                    *path.rbegin() += current_char;
+            
+            if( path.size() > 0 )
+                *path.rbegin() = url_decode( *path.rbegin() );
+        }
+        catch( const url_decode_error& ude )
+        {
+            throw request_parse_error{ ude.what() };
+        }
         
-        auto content_length_header = _headers.find( "Content-Length" );
+        return path;
+    }
+    
+    // Splits & decodes a raw (still URL-encoded) query string into its
+    // arguments
+    inline query_args_type _decode_query_args( string_view raw )
+    {
+        query_args_type query_args;
+        std::stack< std::string > key_buffer_stack;
+        std::string value_buffer;
         
-        if( content_length_header != _headers.end() )
+        auto flush_args = [ & ](){
+            try
+            {
+                if( key_buffer_stack.size() > 1 )
+                {
+                    value_buffer = url_decode( key_buffer_stack.top() );
+                    key_buffer_stack.pop();
+                }
+                else
+                    value_buffer = "";
+                
+                while( !key_buffer_stack.empty() )
+                {
+                    query_args[
+                        url_decode( key_buffer_stack.top() )
+                    ].push_back( value_buffer );
+                    key_buffer_stack.pop();
+                }
+            }
+            catch( const url_decode_error& ude )
+            {
+                throw request_parse_error{ ude.what() };
+            }
+        };
+        
+        for( auto current_char : raw )
+            switch( current_char )
+            {
+            case '=':
+                key_buffer_stack.push( "" );
+                break;
+            case '&':
+                flush_args();
+                break;
+            default:
+                if( key_buffer_stack.empty() )
+                    key_buffer_stack.push( "" );
+                key_buffer_stack.top() += current_char;
+                break;
+            }
+        flush_args();
+        
+        return query_args;
+    }
+    
+    // Finds the method, path, query string, & protocol in the request line at
+    // the start of a header block, upper-casing the method in place, and
+    // returns the offset of the header fields following it
+    inline std::size_t _parse_request_line(
+        char*                data,
+        std::size_t          size,
+        header_parser::span& method,
+        header_parser::span& path,
+        header_parser::span& query,
+        header_parser::span& protocol
+    )
+    {
+        method   = { 0, 0 };
+        path     = { 0, 0 };
+        query    = { 0, 0 };
+        protocol = { 0, 0 };
+        
+        enum {
+            READING_METHOD,
+            READING_PATH,
+            READING_QUERY_ARGS,
+            READING_PROTOCOL
+        } parse_state{ READING_METHOD };
+        
+        std::size_t i{ 0 };
+        for( ; i < size && data[ i ] != '\n'; ++i )
         {
-            if( content_length_header -> second.size() > 1 )
-                _unknown_content_length = MAYBE;
-            else
-                try
+            // Skip runs of ordinary characters a whole token at a time, as
+            // only delimiters can change the state
+            auto run_end = _find_header_delimiter( data + i, data + size );
+            if( run_end != data + i )
+            {
+                i = static_cast< std::size_t >( run_end - data ) - 1;
+                continue;
+            }
+            
+            // `header_parser::append()` already made sure every \r is
+            // followed by a \n, so it can only be at the end of the line
+            if( data[ i ] == '\r' )
+                continue;
+            
+            switch( parse_state )
+            {
+            case READING_METHOD:
+                if( data[ i ] == ' ' )
                 {
-                    std::size_t convert_stopped;
-                    std::size_t value_size{
-                        content_length_header -> second[ 0 ].size()
-                    };
-                    _content_length = std::stoull(
-                        content_length_header -> second[ 0 ],
-                        &convert_stopped,
-                        10
-                    );
-                    if( convert_stopped < value_size )
-                        _unknown_content_length = MAYBE;
-                    else
-                        _unknown_content_length = NO;
+                    method.size = i;
+                    path        = { i + 1, 0 };
+                    parse_state = READING_PATH;
                 }
-                catch( const std::invalid_argument& e )
+                break;
+            
+            case READING_PATH:
+                if( data[ i ] == '?' )
                 {
-                    _unknown_content_length = MAYBE;
+                    path.size   = i - path.offset;
+                    query       = { i + 1, 0 };
+                    parse_state = READING_QUERY_ARGS;
                 }
+                else if( data[ i ] == ' ' )
+                {
+                    path.size   = i - path.offset;
+                    protocol    = { i + 1, 0 };
+                    parse_state = READING_PROTOCOL;
+                }
+                break;
+            
+            case READING_QUERY_ARGS:
+                if( data[ i ] == ' ' )
+                {
+                    query.size  = i - query.offset;
+                    protocol    = { i + 1, 0 };
+                    parse_state = READING_PROTOCOL;
+                }
+                break;
+            
+            case READING_PROTOCOL:
+                break;
+            }
         }
+        
+        // Close whichever part the line ended in
+        auto line_end = i;
+        if( line_end > 0 && data[ line_end - 1 ] == '\r' )
+            --line_end;
+        switch( parse_state )
+        {
+        case READING_METHOD:
+            method.size = line_end;
+            break;
+        case READING_PATH:
+            path.size = line_end - path.offset;
+            break;
+        case READING_QUERY_ARGS:
+            query.size = line_end - query.offset;
+            break;
+        case READING_PROTOCOL:
+            protocol.size = line_end - protocol.offset;
+            break;
+        }
+        
+        _ASCII_upper_in_place( data + method.offset, method.size );
+        
+        return i < size ? i + 1 : i;
+    }
+}
+
+
+namespace show // `show::request_parser` implementation ////////////////////////
+{
+    inline request_parser::request_parser(
+        std::size_t max_fields,
+        std::size_t max_block_size
+    ) :
+        _fields         { max_fields, max_block_size       },
+        _status         { request_parse_status::INCOMPLETE },
+        _error          { header_parse_status::SUCCESS     },
+        _protocol       { NONE                             },
+        _method         { 0, 0                             },
+        _path           { 0, 0                             },
+        _query          { 0, 0                             },
+        _protocol_string{ 0, 0                             }
+    {}
+    
+    inline void request_parser::reset()
+    {
+        _fields.reset();
+        _status          = request_parse_status::INCOMPLETE;
+        _error           = header_parse_status::SUCCESS;
+        _protocol        = NONE;
+        _method          = { 0, 0 };
+        _path            = { 0, 0 };
+        _query           = { 0, 0 };
+        _protocol_string = { 0, 0 };
+    }
+    
+    inline request_parse_status request_parser::feed(
+        const char*  data,
+        std::size_t  size,
+        std::size_t& used
+    )
+    {
+        used = 0;
+        if( _status != request_parse_status::INCOMPLETE )
+            return _status;
+        
+        // Servers should ignore empty lines before a request line; see
+        // https://tools.ietf.org/html/rfc7230#section-3.5
+        if( _fields.size() == 0 )
+            while(
+                used < size
+                && ( data[ used ] == '\r' || data[ used ] == '\n' )
+            )
+                ++used;
+        if( used >= size )
+            return _status;
+        
+        std::size_t appended;
+        auto status = _fields.append( data + used, data + size, appended );
+        used += appended;
+        if( status == header_parse_status::INCOMPLETE )
+            return _status;
+        if( status != header_parse_status::SUCCESS )
+            return _fail( status );
+        
+        auto fields_offset = _parse_request_line(
+            _fields.data(),
+            _fields.size(),
+            _method,
+            _path,
+            _query,
+            _protocol_string
+        );
+        status = _fields.parse_fields( fields_offset );
+        if( status != header_parse_status::SUCCESS )
+            return _fail( status );
+        
+        if( _protocol_string.size < 1 )
+            _protocol = NONE;
+        else if( _equal_ignore_case_ASCII( protocol_string(), "HTTP/1.0" ) )
+            _protocol = HTTP_1_0;
+        else if( _equal_ignore_case_ASCII( protocol_string(), "HTTP/1.1" ) )
+            _protocol = HTTP_1_1;
         else
-            _unknown_content_length = YES;
+            _protocol = UNKNOWN;
+        
+        _status = request_parse_status::COMPLETE;
+        return _status;
     }
     
-    inline bool request::eof() const
+    inline const char* request_parser::error() const
     {
-        return !_unknown_content_length && read_content >= _content_length;
+        if( _status != request_parse_status::FAILED )
+            return "";
+        return _header_parse_error_message( _error );
     }
     
-    inline void request::flush()
+    inline request_parse_status request_parser::_fail(
+        header_parse_status status
+    )
     {
-        while( !eof() ) sbumpc();
+        _error  = status;
+        _status = request_parse_status::FAILED;
+        return _status;
     }
+}
+
+
+namespace show // `show::request` implementation ///////////////////////////////
+{
+    inline request::request( request&& o ) :
+        _request_content{ std::move( o                   ) },
+        _protocol       { std::move( o._protocol         ) },
+        _protocol_string{ std::move( o._protocol_string  ) },
+        _method         { std::move( o._method           ) },
+        _path           { std::move( o._path             ) },
+        _query_args     { std::move( o._query_args       ) },
+        _headers        { std::move( o._headers          ) }
+    {}
     
-    inline std::streamsize request::showmanyc()
+    inline request& request::operator =( request&& o )
     {
-        if( eof() )
-            return -1;
+        _swap_content( o );
+        std::swap( _protocol              , o._protocol                );
+        std::swap( _protocol_string       , o._protocol_string         );
+        std::swap( _method                , o._method                  );
+        std::swap( _path                  , o._path                    );
+        std::swap( _query_args            , o._query_args              );
+        std::swap( _headers               , o._headers                 );
+        
+        return *this;
+    }
+    
+    inline request::request( class connection& c ) :
+        _request_content{ c }
+    {
+        _connection -> _read_header_block();
+        
+        const auto& parser = _connection -> _request_parser;
+        _protocol        = parser.protocol();
+        _protocol_string = parser.protocol_string().to_string();
+        _method          = parser.method         ().to_string();
+        _path            = _decode_path      ( parser.raw_path () );
+        _query_args      = _decode_query_args( parser.raw_query() );
+        parser.fields().copy_to( _headers );
+        
+        auto content_length_header = _headers.find( "Content-Length" );
+        
+        if( content_length_header != _headers.end() )
+            _parse_content_length(
+                content_length_header -> second.size(),
+                content_length_header -> second[ 0 ]
+            );
         else
+            _parse_content_length( 0, "" );
+        
+        // Transfer codings are listed in the order they were applied, across
+        // however many headers they're split over, so only the last matters
+        auto transfer_encoding_header = _headers.find( "Transfer-Encoding" );
+        if( transfer_encoding_header != _headers.end() )
         {
-            // Don't just return `remaining` as that may cause reading to hang
-            // on unresponsive clients (trying to read bytes we don't have yet)
-            auto remaining = static_cast< std::streamsize >(
-                _content_length - read_content
-            );
-            auto in_connection = _connection -> showmanyc();
-            return in_connection < remaining ? in_connection : remaining;
+            string_view final_coding;
+            for( const auto& value : transfer_encoding_header -> second )
+            {
+                auto coding = _last_transfer_coding( value );
+                if( coding.size() > 0 )
+                    final_coding = coding;
+            }
+            _parse_transfer_encoding( final_coding );
+        }
+    }
+}
+
+
+namespace show // `show::request_view` implementation //////////////////////////
+{
+    inline request_view::request_view( class connection& c ) :
+        _request_content{ c }
+    {
+        _connection -> _read_header_block();
+        
+        std::size_t content_length_count{ 0 };
+        string_view content_length_value;
+        bool        has_transfer_encoding{ false };
+        string_view final_transfer_coding;
+        for( std::size_t i = 0; i < field_count(); ++i )
+        {
+            auto f = field( i );
+            if( _equal_ignore_case_ASCII( f.name, "Content-Length" ) )
+            {
+                if( content_length_count++ == 0 )
+                    content_length_value = f.value;
+            }
+            else if( _equal_ignore_case_ASCII( f.name, "Transfer-Encoding" ) )
+            {
+                has_transfer_encoding = true;
+                auto coding = _last_transfer_coding( f.value );
+                if( coding.size() > 0 )
+                    final_transfer_coding = coding;
+            }
+        }
+        _parse_content_length(
+            content_length_count,
+            content_length_value.to_string()
+        );
+        if( has_transfer_encoding )
+            _parse_transfer_encoding( final_transfer_coding );
+    }
+    
+    inline request_view::request_view( request_view&& o ) :
+        _request_content{ std::move( o ) }
+    {}
+    
+    inline request_view& request_view::operator =( request_view&& o )
+    {
+        _swap_content( o );
+        return *this;
+    }
+    
+    inline std::vector< std::string > request_view::path() const
+    {
+        return _decode_path( raw_path() );
+    }
+    
+    inline query_args_type request_view::query_args() const
+    {
+        return _decode_query_args( raw_query() );
+    }
+    
+    inline headers_type request_view::headers() const
+    {
+        headers_type headers;
+        for( std::size_t i = 0; i < field_count(); ++i )
+        {
+            auto f = field( i );
+            headers[ f.name.to_string() ].push_back( f.value.to_string() );
+        }
+        return headers;
+    }
+    
+    inline request_view::header_field request_view::field( std::size_t i ) const
+    {
+        const auto& parser = _connection -> _request_parser.fields();
+        return { parser.name( i ), parser.value( i ) };
+    }
+    
+    inline string_view request_view::header( string_view name ) const
+    {
+        const auto& parser = _connection -> _request_parser.fields();
+        for( std::size_t i = 0; i < parser.field_count(); ++i )
+            if( _equal_ignore_case_ASCII( parser.name( i ), name ) )
+                return parser.value( i );
+        return {};
+    }
+}
+
+
+namespace show // `show::response` implementation //////////////////////////////
+{
+    // Capitalizes a header name the standard way; it must already have been
+    // checked with `_check_header_name()`
+    inline void _standardize_header_name( char* name, std::size_t size )
+    {
+        bool next_should_be_capitalized{ true };
+        for( std::size_t i = 0; i < size; ++i )
+        {
+            auto& c = name[ i ];
+            if( c >= 'a' && c <= 'z' )
+            {
+                if( next_should_be_capitalized )
+                    c &= ~0x20;
+            }
+            else if( c >= 'A' && c <= 'Z' )
+            {
+                if( !next_should_be_capitalized )
+                    c |= 0x20;
+            }
+            next_should_be_capitalized = ( c == '-' );
         }
     }
     
-    inline request::int_type request::underflow()
+    inline void _check_header_name( string_view name )
     {
-        if( eof() )
-            return traits_type::eof();
-        else
-        {
-            auto c = _connection -> underflow();
-            if( c != traits_type::not_eof( c ) )
-                throw client_disconnected{};
-            return c;
-        }
+        if( name.size() < 1 )
+            throw response_marshall_error{ "empty header name" };
+        for( auto c : name )
+            if( !(
+                   ( c >= 'a' && c <= 'z' )
+                || ( c >= 'A' && c <= 'Z' )
+                || ( c >= '0' && c <= '9' )
+                || c == '-'
+            ) )
+                throw response_marshall_error{ "invalid header name" };
     }
     
-    inline request::int_type request::uflow()
+    inline const char* _find_line_break( const char* begin, const char* end )
     {
-        if( eof() )
-            return traits_type::eof();
-        auto c = _connection -> uflow();
-        if( traits_type::not_eof( c ) != c )
-            throw client_disconnected{};
-        ++read_content;
-        return c;
+        auto size = static_cast< std::size_t >( end - begin );
+        auto lf   = static_cast< const char* >(
+            std::memchr( begin, '\n', size )
+        );
+        auto cr   = static_cast< const char* >( std::memchr(
+            begin,
+            '\r',
+            lf ? static_cast< std::size_t >( lf - begin ) : size
+        ) );
+        return cr ? cr : lf ? lf : end;
     }
     
-    inline std::streamsize request::xsgetn(
-        char_type* s,
-        std::streamsize count
+    // Calls `f( data, size, continuation )` for each line of a header value,
+    // dropping empty lines; every line after the first break is to be sent
+    // as a continuation line
+    template< typename Function > void _for_each_header_value_line(
+        string_view value,
+        Function    f
     )
     {
-        std::streamsize read;
+        if( value.size() < 1 )
+            throw response_marshall_error{ "empty header value" };
         
-        if( _unknown_content_length )
-            read = _connection -> sgetn( s, count );
-        else if( !eof() )
+        auto begin        = value.begin();
+        auto end          = value.end();
+        bool continuation{ false };
+        while( begin != end )
         {
-            auto remaining = static_cast< std::streamsize >(
-                _content_length - read_content
-            );
-            read = _connection -> sgetn(
-                s,
-                count > remaining ? remaining : count
-            );
+            auto line_break = _find_line_break( begin, end );
+            if( line_break != begin )
+                f(
+                    begin,
+                    static_cast< std::size_t >( line_break - begin ),
+                    continuation
+                );
+            for(
+                begin = line_break;
+                begin != end && ( *begin == '\r' || *begin == '\n' );
+                ++begin
+            )
+                continuation = true;
         }
-        else
-            return 0;
-        
-        read_content += read;
-        return read;
     }
     
-    inline request::int_type request::pbackfail( int_type c )
+    // Calls `f( name, id, value )` for every header value; `id` is `UNKNOWN`
+    // for any name that hasn't been checked
+    template< typename Function > void _for_each_header(
+        const headers_type& headers,
+        Function            f
+    )
     {
-        auto result = _connection -> pbackfail( c );
-        
-        if( traits_type::not_eof( result ) == result )
-            --read_content;
-        
-        return result;
+        for( auto& name_values_pair : headers )
+        {
+            // Still rejected even though nothing would be sent for it
+            if( name_values_pair.second.empty() )
+                _check_header_name( name_values_pair.first );
+            for( auto& value : name_values_pair.second )
+                f( name_values_pair.first, header_id::UNKNOWN, value );
+        }
     }
-}
-
-
-namespace show // `show::response` implementation //////////////////////////////
-{
+    template< typename Function > void _for_each_header(
+        const header_map& headers,
+        Function          f
+    )
+    {
+        for( auto& field : headers )
+            f( field.name, field.id, field.value );
+    }
+    
+    inline char* _write_to( char* out, string_view s )
+    {
+        std::memcpy( out, s.data(), s.size() );
+        return out + s.size();
+    }
+    
     inline response::response(
         connection         & c,
         http_protocol        protocol,
@@ -1319,82 +4565,120 @@ namespace show // `show::response` implementation //////////////////////////////
         const headers_type & headers
     ) : _connection{ &c }
     {
-        std::stringstream headers_stream;
+        _write_header_block( protocol, code, headers );
+    }
+    
+    template< typename Headers, typename >
+    inline response::response(
+        connection         & c,
+        http_protocol        protocol,
+        const response_code& code,
+        const Headers      & headers
+    ) : _connection{ &c }
+    {
+        _write_header_block( protocol, code, headers );
+    }
+    
+    template< typename Headers > inline void response::_write_header_block(
+        http_protocol        protocol,
+        const response_code& code,
+        const Headers&       headers
+    )
+    {
+        // Format the code's digits right-aligned in `code_digits`
+        char  code_digits[ 8 ];
+        auto  code_end   = code_digits + sizeof( code_digits );
+        auto  code_begin = code_end;
+        auto  code_value = code.code;
+        do
+        {
+            *--code_begin = static_cast< char >( '0' + code_value % 10 );
+            code_value /= 10;
+        } while( code_value > 0 );
+        string_view code_string{
+            code_begin,
+            static_cast< std::size_t >( code_end - code_begin )
+        };
         
-        if( protocol == HTTP_1_1 )
-            headers_stream << "HTTP/1.1 ";
+        // Work out the exact size first, which also checks everything so
+        // nothing is written if any of it is invalid
+        std::size_t size{
+            9 + code_string.size() + 1 + code.description.size() + 2 + 2
+        };
+        _for_each_header( headers, [ &size ](
+            string_view name,
+            header_id   id,
+            string_view value
+        ){
+            if( id == header_id::UNKNOWN )
+                _check_header_name( name );
+            size += name.size() + 2 + 2;
+            _for_each_header_value_line( value, [ &size ](
+                const char* ,
+                std::size_t line_size,
+                bool        continuation
+            ){
+                size += line_size + ( continuation ? 3 : 0 );
+            } );
+        } );
+        
+        // The block is almost always small enough to go right into the put
+        // buffer; only if it isn't does it need its own allocation
+        _connection -> _reserve_put_buffer();
+        std::string overflow_block;
+        char*       out;
+        if(
+            static_cast< std::size_t >(
+                _connection -> epptr() - _connection -> pptr()
+            ) >= size
+        )
+            out = _connection -> pptr();
         else
-            headers_stream << "HTTP/1.0 ";
+        {
+            overflow_block.resize( size );
+            out = &overflow_block[ 0 ];
+        }
         
-        // Marshall response code & description
-        headers_stream
-            << code.code
-            << " "
-            << code.description
-            << "\r\n"
-        ;
+        out = _write_to(
+            out,
+            protocol == HTTP_1_1 ? "HTTP/1.1 " : "HTTP/1.0 "
+        );
+        out = _write_to( out, code_string      );
+        out = _write_to( out, " "              );
+        out = _write_to( out, code.description );
+        out = _write_to( out, "\r\n"           );
         
-        // Marshall headers
-        for( auto& name_values_pair : headers )
-        {
-            auto header_name = name_values_pair.first;
-            
-            if( header_name.size() < 1 )
-                throw response_marshall_error{ "empty header name" };
+        _for_each_header( headers, [ &out ](
+            string_view name,
+            header_id   id,
+            string_view value
+        ){
+            if( id != header_id::UNKNOWN )
+                // Known names are already capitalized the standard way
+                out = _write_to( out, header_name( id ) );
             else
             {
-                bool next_should_be_capitalized{ true };
-                for( auto& c : header_name )
-                    if( c >= 'a' && c <= 'z' )
-                    {
-                        if( next_should_be_capitalized )
-                        {
-                            c &= ~0x20;
-                            next_should_be_capitalized = false;
-                        }
-                    }
-                    else if( c >= 'A' && c <= 'Z' )
-                    {
-                        if( !next_should_be_capitalized )
-                            c |= 0x20;
-                        next_should_be_capitalized = false;
-                    }
-                    else if( c == '-' )
-                        next_should_be_capitalized = true;
-                    else if( c >= '0' && c <= '9' )
-                        next_should_be_capitalized = false;
-                    else
-                        throw response_marshall_error{ "invalid header name" };
-            }
-            
-            for( auto& value : name_values_pair.second )
-            {
-                if( value.size() < 1 )
-                    throw response_marshall_error{ "empty header value" };
-                
-                headers_stream << header_name << ": ";
-                bool insert_newline{ false };
-                for( auto c : value )
-                    if( c == '\r' || c == '\n' )
-                        insert_newline = true;
-                    else
-                    {
-                        if( insert_newline )
-                        {
-                            headers_stream << "\r\n ";
-                            insert_newline = false;
-                        }
-                        headers_stream << c;
-                    }
-                headers_stream << "\r\n";
+                out = _write_to( out, name );
+                _standardize_header_name( out - name.size(), name.size() );
             }
-        }
-        headers_stream << "\r\n";
+            out = _write_to( out, ": " );
+            _for_each_header_value_line( value, [ &out ](
+                const char* line,
+                std::size_t line_size,
+                bool        continuation
+            ){
+                if( continuation )
+                    out = _write_to( out, "\r\n " );
+                out = _write_to( out, { line, line_size } );
+            } );
+            out = _write_to( out, "\r\n" );
+        } );
+        out = _write_to( out, "\r\n" );
         
-        sputn(
-            headers_stream.str().c_str(),
-            headers_stream.str().size()
-        );
+        if( overflow_block.empty() )
+            _connection -> pbump( static_cast< int >( size ) );
+        else
+            _connection -> _queue( std::move( overflow_block ) );
     }
     
     inline response::response( response&& o ) :
@@ -1417,7 +4701,48 @@ namespace show // `show::response` implementation //////////////////////////////
     
     inline void response::flush()
     {
-        _connection -> flush();
+        if( _connection -> _batching )
+            _connection -> _queue_put_buffer();
+        else
+            _connection -> flush();
+    }
+    
+    inline void response::queue( const char* data, std::size_t size )
+    {
+        _connection -> _queue( data, size );
+    }
+    
+    inline void response::queue( std::string data )
+    {
+        _connection -> _queue( std::move( data ) );
+    }
+    
+    inline std::size_t response::send_file(
+        int         file_descriptor,
+        off_t       offset,
+        std::size_t length
+    )
+    {
+        auto remaining = length;
+        _throw_if_interrupted( _connection -> _try_send_file(
+            file_descriptor,
+            offset,
+            remaining
+        ) );
+        return length - remaining;
+    }
+    
+    inline io_status response::try_send_file(
+        int          file_descriptor,
+        off_t&       offset,
+        std::size_t& remaining
+    )
+    {
+        return _connection -> _try_send_file(
+            file_descriptor,
+            offset,
+            remaining
+        );
     }
     
     inline std::streamsize response::xsputn(
@@ -1440,16 +4765,24 @@ namespace show // `show::server` implementation ////////////////////////////////
     inline server::server(
         const std::string& address,
         unsigned int       port,
-        int                timeout
-    )
+        int                timeout,
+        int                backlog
+    ) :
+        _backlog    { backlog                                 },
+        _buffer_size{ connection::DEFAULT_BUFFER_SIZE         },
+        _buffer_pool{ std::make_shared< show::buffer_pool >() }
     {
         auto listen_socket_fd = socket(
             AF_INET6,
+#if defined( SOCK_NONBLOCK )
+            SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+#else
             SOCK_STREAM,
+#endif
             getprotobyname( "TCP" ) -> p_proto
         );
         
-        if( listen_socket_fd == 0 )
+        if( listen_socket_fd == -1 )
             throw socket_error{
                 "failed to create listen socket: "
                 + std::string{ std::strerror( errno ) }
@@ -1506,7 +4839,7 @@ namespace show // `show::server` implementation ////////////////////////////////
                 + std::string{ std::strerror( errno ) }
             };
         
-        if( listen( listen_socket -> descriptor, 3 ) == -1 )
+        if( listen( listen_socket -> descriptor, _backlog ) == -1 )
             throw socket_error{
                 "could not listen on socket: "
                 + std::string{ std::strerror( errno ) }
@@ -1514,8 +4847,12 @@ namespace show // `show::server` implementation ////////////////////////////////
     }
     
     inline server::server( server&& o ) :
-        _timeout     { o._timeout      },
-        listen_socket{ o.listen_socket }
+        _timeout     { o._timeout                   },
+        _backlog     { o._backlog                   },
+        _buffer_size { o._buffer_size               },
+        _buffer_pool { o._buffer_pool               },
+        _accept_error{ std::move( o._accept_error ) },
+        listen_socket{ o.listen_socket                }
     {
         o.listen_socket = nullptr;
     }
@@ -1529,28 +4866,48 @@ namespace show // `show::server` implementation ////////////////////////////////
     inline server& server::operator =( server&& o )
     {
         std::swap( listen_socket, o.listen_socket );
-        _timeout = o._timeout;
+        std::swap( _accept_error, o._accept_error );
+        _timeout      = o._timeout;
+        _backlog      = o._backlog;
+        _buffer_size  = o._buffer_size;
+        _buffer_pool  = o._buffer_pool;
         return *this;
     }
     
-    inline connection server::serve()
+    inline socket_fd server::_accept(
+        std::string & client_address,
+        unsigned int& client_port,
+        unsigned int& server_port
+    )
     {
-        if( _timeout != 0 )
-            listen_socket -> wait_for(
-                _socket::wait_for_type::READ,
-                _timeout,
-                "listen"
-            );
-        
         sockaddr_in6 address_info;
         socklen_t address_info_len = sizeof( address_info );
         
         char address_buffer[ INET6_ADDRSTRLEN ];
         
-        auto serve_socket = accept(
-            listen_socket -> descriptor,
-            reinterpret_cast< sockaddr* >( &address_info ),
-            &address_info_len
+        socket_fd serve_socket;
+        do
+        {
+            // `accept4()` sets the same flags as `SOCK_NONBLOCK` and
+            // `SOCK_CLOEXEC` on the listen socket, but atomically on accept
+#if defined( SOCK_NONBLOCK )
+            serve_socket = accept4(
+                listen_socket -> descriptor,
+                reinterpret_cast< sockaddr* >( &address_info ),
+                &address_info_len,
+                SOCK_NONBLOCK | SOCK_CLOEXEC
+            );
+#else
+            serve_socket = accept(
+                listen_socket -> descriptor,
+                reinterpret_cast< sockaddr* >( &address_info ),
+                &address_info_len
+            );
+#endif
+        } while(
+            serve_socket == -1
+            // Interrupted, or the client gave up before being accepted
+            && ( errno == EINTR || errno == ECONNABORTED )
         );
         
         if(
@@ -1573,8 +4930,11 @@ namespace show // `show::server` implementation ////////////////////////////////
         {
             auto errno_copy = errno;
             
+            if( serve_socket != -1 )
+                close( serve_socket );
+            
             if( errno_copy == EAGAIN || errno_copy == EWOULDBLOCK )
-                throw connection_timeout{};
+                return -1;
             else
                 throw socket_error{
                     "could not create serve socket: "
@@ -1582,8 +4942,8 @@ namespace show // `show::server` implementation ////////////////////////////////
                 };
         }
         
-        std::string  client_address{ address_buffer                  };
-        unsigned int client_port   { ntohs( address_info.sin6_port ) };
+        client_address = address_buffer;
+        client_port    = ntohs( address_info.sin6_port );
         
         if(
             getsockname(
@@ -1594,22 +4954,128 @@ namespace show // `show::server` implementation ////////////////////////////////
         )
         {
             auto errno_copy = errno;
+            close( serve_socket );
             throw socket_error{
                 "could not get port information from socket: "
                 + std::string{ std::strerror( errno_copy ) }
             };
         }
         
+        server_port = ntohs( address_info.sin6_port );
+        
+        return serve_socket;
+    }
+    
+    inline bool server::_wait_to_accept()
+    {
+        return _timeout == 0 || listen_socket -> try_wait_for(
+            _socket::wait_for_type::READ,
+            _timeout,
+            "listen"
+        ) != _socket::NONE;
+    }
+    
+    inline bool server::_accept_into( std::vector< connection >& connections )
+    {
+        std::string  client_address;
+        unsigned int client_port;
+        unsigned int server_port;
+        
+        auto serve_socket = _accept( client_address, client_port, server_port );
+        if( serve_socket == -1 )
+            return false;
+        
+        connections.push_back( connection{
+            serve_socket,
+            client_address,
+            client_port,
+            listen_socket -> address,
+            server_port,
+            timeout(),
+            _buffer_size,
+            _buffer_pool
+        } );
+        return true;
+    }
+    
+    inline void server::_rethrow_accept_error()
+    {
+        if( _accept_error )
+        {
+            auto error = _accept_error;
+            _accept_error = nullptr;
+            std::rethrow_exception( error );
+        }
+    }
+    
+    inline connection server::serve()
+    {
+        _rethrow_accept_error();
+        if( !_wait_to_accept() )
+            throw connection_timeout{};
+        
+        std::string  client_address;
+        unsigned int client_port;
+        unsigned int server_port;
+        
+        auto serve_socket = _accept( client_address, client_port, server_port );
+        if( serve_socket == -1 )
+            throw connection_timeout{};
+        
         return connection{
             serve_socket,
             client_address,
             client_port,
             listen_socket -> address,
-            ntohs( address_info.sin6_port ),
-            timeout()
+            server_port,
+            timeout(),
+            _buffer_size,
+            _buffer_pool
         };
     }
     
+    inline std::vector< connection > server::serve_many()
+    {
+        std::vector< connection > connections;
+        if( try_serve_many( connections ) != io_status::SUCCESS )
+            throw connection_timeout{};
+        return connections;
+    }
+    
+    inline io_status server::try_serve(
+        std::vector< connection >& connections
+    )
+    {
+        _rethrow_accept_error();
+        if( _wait_to_accept() && _accept_into( connections ) )
+            return io_status::SUCCESS;
+        return io_status::TIMEOUT;
+    }
+    
+    inline io_status server::try_serve_many(
+        std::vector< connection >& connections
+    )
+    {
+        _rethrow_accept_error();
+        if( !_wait_to_accept() || !_accept_into( connections ) )
+            return io_status::TIMEOUT;
+        
+        // Drain the whole accept queue in response to a single wakeup; if
+        // that fails part-way (e.g. out of descriptors), the connections
+        // already accepted are still returned & the failure is left for the
+        // next call to report
+        try
+        {
+            while( _accept_into( connections ) );
+        }
+        catch( ... )
+        {
+            _accept_error = std::current_exception();
+        }
+        
+        return io_status::SUCCESS;
+    }
+    
     inline const std::string& server::address() const
     {
         return listen_socket -> address;
@@ -1620,6 +5086,11 @@ namespace show // `show::server` implementation ////////////////////////////////
         return listen_socket -> port;
     }
     
+    inline int server::backlog() const
+    {
+        return _backlog;
+    }
+    
     inline int server::timeout() const
     {
         return _timeout;
@@ -1630,96 +5101,197 @@ namespace show // `show::server` implementation ////////////////////////////////
         _timeout = t;
         return _timeout;
     }
+    
+    inline buffer_size_type server::buffer_size() const
+    {
+        return _buffer_size;
+    }
+    
+    inline buffer_size_type server::buffer_size( buffer_size_type s )
+    {
+        if( s < 1 )
+            throw std::invalid_argument{ "buffer size must be at least 1" };
+        _buffer_size = s;
+        return _buffer_size;
+    }
+    
+    inline std::shared_ptr< buffer_pool > server::buffer_pool() const
+    {
+        return _buffer_pool;
+    }
+    
+    inline std::shared_ptr< buffer_pool > server::buffer_pool(
+        std::shared_ptr< show::buffer_pool > p
+    )
+    {
+        _buffer_pool = std::move( p );
+        return _buffer_pool;
+    }
 }
 
 
 namespace show // URL-encoding implementations /////////////////////////////////
 {
-    inline std::string url_encode(
-        const std::string& o,
-        bool use_plus_space
+    // Value of each hex digit, or -1 for any other character
+    inline const signed char* _url_hex_values()
+    {
+        static const signed char values[ 256 ]{
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+             0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+            -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+        };
+        return values;
+    }
+    
+    // Characters that don't need escaping, per RFC 3986 §2.3
+    inline const bool* _url_unreserved()
+    {
+        static const bool unreserved[ 256 ]{
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0,
+            1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+            0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+            1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+            0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+            1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+        };
+        return unreserved;
+    }
+    
+    inline std::size_t url_encode(
+        const char* in,
+        std::size_t size,
+        char*       out,
+        bool        use_plus_space
     )
     {
-        std::stringstream encoded;
-        encoded << std::hex;
-        
-        std::string space{ use_plus_space ? "+" : "%20" };
+        static const char hex_digits[]{ "0123456789ABCDEF" };
+        auto unreserved = _url_unreserved();
+        auto start      = out;
         
-        for( auto c : o )
+        for( auto end = in + size; in < end; ++in )
         {
-            if( c == ' ' )
-                encoded << space;
-            else if (
-                   ( c >= 'A' && c <= 'Z' )
-                || ( c >= 'a' && c <= 'z' )
-                || ( c >= '0' && c <= '9' )
-                || c == '-'
-                || c == '_'
-                || c == '.'
-                || c == '~'
-            )
-                encoded << c;
+            auto c = static_cast< unsigned char >( *in );
+            if( unreserved[ c ] )
+                *out++ = *in;
+            else if( c == ' ' && use_plus_space )
+                *out++ = '+';
             else
-                encoded
-                    << '%'
-                    << std::uppercase
-                    << std::setfill( '0' )
-                    << std::setw( 2 )
-                    << static_cast< unsigned int >(
-                        static_cast< unsigned char >( c )
-                    )
-                    << std::nouppercase
-                ;
+            {
+                *out++ = '%';
+                *out++ = hex_digits[ c >> 4   ];
+                *out++ = hex_digits[ c & 0x0F ];
+            }
         }
         
-        return encoded.str();
+        return static_cast< std::size_t >( out - start );
     }
     
-    inline std::string url_decode( const std::string& o )
+    inline url_decode_status url_decode(
+        const char*  in,
+        std::size_t  size,
+        char*        out,
+        std::size_t& decoded_size
+    )
     {
-        std::string decoded;
-        std::string hex_convert_space{ "00" };
+        auto hex_values = _url_hex_values();
+        auto hex_value  = [ hex_values ]( char c ){
+            return hex_values[ static_cast< unsigned char >( c ) ];
+        };
+        auto start      = out;
+        auto end        = in + size;
+        auto status     = url_decode_status::SUCCESS;
         
-        for( std::string::size_type i = 0; i < o.size(); ++i )
+        while( in < end )
         {
-            if( o[ i ] == '%' )
+            if( *in == '%' )
             {
-                if( o.size() < i + 3 )
-                    throw url_decode_error{
-                        "incomplete URL-encoded sequence"
-                    };
-                else
+                if( end - in < 3 )
                 {
-                    try
-                    {
-                        hex_convert_space[ 0 ] = o[ i + 1 ];
-                        hex_convert_space[ 1 ] = o[ i + 2 ];
-                        std::size_t convert_stopped;
-                        decoded += static_cast< char >( std::stoi(
-                            hex_convert_space,
-                            &convert_stopped,
-                            16
-                        ) );
-                        if( convert_stopped < hex_convert_space.size() )
-                            throw url_decode_error{
-                                "invalid URL-encoded sequence"
-                            };
-                        i += 2;
-                    }
-                    catch( const std::invalid_argument& e )
-                    {
-                        throw url_decode_error{
-                            "invalid URL-encoded sequence"
-                        };
-                    }
+                    status = url_decode_status::INCOMPLETE_SEQUENCE;
+                    break;
+                }
+                
+                int high = hex_value( in[ 1 ] );
+                int low  = hex_value( in[ 2 ] );
+                if( ( high | low ) < 0 )
+                {
+                    status = url_decode_status::INVALID_SEQUENCE;
+                    break;
                 }
+                
+                *out++ = static_cast< char >( ( high << 4 ) | low );
+                in += 3;
             }
-            else if( o[ i ] == '+' )
-                decoded += ' ';
             else
-                decoded += o[ i ];
+            {
+                *out++ = *in == '+' ? ' ' : *in;
+                ++in;
+            }
+        }
+        
+        decoded_size = static_cast< std::size_t >( out - start );
+        return status;
+    }
+    
+    inline std::string url_encode(
+        const std::string& o,
+        bool use_plus_space
+    )
+    {
+        std::string encoded( o.size() * 3, '\0' );
+        encoded.resize( url_encode(
+            o.data(),
+            o.size(),
+            &encoded[ 0 ],
+            use_plus_space
+        ) );
+        return encoded;
+    }
+    
+    inline std::string url_decode( const std::string& o )
+    {
+        std::string decoded{ o };
+        std::size_t decoded_size;
+        
+        switch( url_decode(
+            decoded.data(),
+            decoded.size(),
+            &decoded[ 0 ],
+            decoded_size
+        ) )
+        {
+        case url_decode_status::INCOMPLETE_SEQUENCE:
+            throw url_decode_error{ "incomplete URL-encoded sequence" };
+        case url_decode_status::INVALID_SEQUENCE:
+            throw url_decode_error{ "invalid URL-encoded sequence" };
+        default:
+            break;
         }
         
+        decoded.resize( decoded_size );
         return decoded;
     }
 }
@@ -5,6 +5,9 @@
 
 #include "../show.hpp"
 
+#include <cstring>    // std::memcmp(), std::memmove(), std::memset()
+#include <streambuf>
+
 
 namespace show
 {
@@ -37,77 +40,607 @@ namespace show
     };
     
     
-    inline std::string base64_encode(
-        const std::string& o,
-        const char* chars
+    // Implemented later, used by the stream buffers
+    using _base64_simd_function = std::size_t (*)(
+        const char*,
+        std::size_t,
+        char*,
+        char,
+        char
+    );
+    static const std::size_t BASE64_DECODE_SLACK{ 8 };
+    
+    
+    // Reads base64 from another stream buffer, such as a `show::request` or
+    // `show::multipart::segment`, and decodes it a block at a time, so memory
+    // use doesn't depend on the size of the content.  Errors are the same as
+    // for `base64_decode()` but are only thrown once the reader reaches them.
+    class base64_decode_buf : public std::streambuf
+    {
+    public:
+        base64_decode_buf(
+            std::streambuf& source,
+            const char*     chars = base64_chars_standard,
+            base64_flags    flags = 0x00
+        );
+        
+        base64_decode_buf( const base64_decode_buf& ) = delete;
+        base64_decode_buf& operator =( const base64_decode_buf& ) = delete;
+    
+    protected:
+        static const std::size_t ENCODED_BLOCK_SIZE{ 4096 };
+        
+        std::streambuf&       _source;
+        const char*           _chars;
+        base64_flags          _flags;
+        signed char           _custom_reverse[ 256 ];
+        const signed char*    _reverse;
+        _base64_simd_function _simd_decoder;
+        // Characters read but not yet decoded, as only whole groups of 4 are
+        // decoded before the end of the source
+        std::size_t           _carried;
+        // Padding characters seen so far; once there are any, only more
+        // padding can follow
+        std::size_t           _padding;
+        bool                  _finished;
+        char                  _encoded[ ENCODED_BLOCK_SIZE ];
+        char                  _decoded[
+            ENCODED_BLOCK_SIZE / 4 * 3 + BASE64_DECODE_SLACK
+        ];
+        
+        // std::streambuf get functions
+        virtual int_type underflow();
+    };
+    
+    // Encodes everything written to it as base64 a block at a time and writes
+    // that to another stream buffer, such as a `show::response`.  As the last
+    // group of bytes can't be encoded until it's known there are no more,
+    // `finish()` must be called (or the buffer destroyed) once everything has
+    // been written.
+    class base64_encode_buf : public std::streambuf
+    {
+    public:
+        base64_encode_buf(
+            std::streambuf& sink,
+            const char*     chars = base64_chars_standard
+        );
+        ~base64_encode_buf();
+        
+        base64_encode_buf( const base64_encode_buf& ) = delete;
+        base64_encode_buf& operator =( const base64_encode_buf& ) = delete;
+        
+        // Encodes & writes out anything left along with any padding; nothing
+        // more can be written afterwards.  Returns `false` if the sink didn't
+        // accept everything.
+        bool finish();
+    
+    protected:
+        static const std::size_t RAW_BLOCK_SIZE{ 3072 };
+        
+        std::streambuf&       _sink;
+        const char*           _chars;
+        _base64_simd_function _simd_encoder;
+        bool                  _finished;
+        char                  _raw    [ RAW_BLOCK_SIZE         ];
+        char                  _encoded[ RAW_BLOCK_SIZE / 3 * 4 ];
+        
+        // Encodes & writes out all whole groups of 3 bytes written so far, or
+        // everything if `last`
+        bool _send( bool last );
+        
+        // std::streambuf put functions
+        virtual int_type overflow(
+            int_type ch = std::streambuf::traits_type::eof()
+        );
+        virtual int      sync();
+    };
+    
+    
+    // Base64 internals ////////////////////////////////////////////////////////
+    
+    
+    // Reverse lookups for the two standard dictionaries, giving each
+    // character's sextet or -1 if it isn't in the dictionary
+    inline const signed char* _base64_reverse_standard()
+    {
+        static const signed char reverse[ 256 ]{
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+            52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+            -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+            15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+            -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+            41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+        };
+        return reverse;
+    }
+    
+    inline const signed char* _base64_reverse_urlsafe()
+    {
+        static const signed char reverse[ 256 ]{
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1,
+            52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+            -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+            15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+            -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+            41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+        };
+        return reverse;
+    }
+    
+    // Both standard dictionaries, and any other that only differs from them in
+    // the last two characters, can be handled with arithmetic on character
+    // ranges rather than lookups, which is what the SIMD versions rely on
+    inline bool _base64_simd_compatible( const char* chars )
+    {
+        auto special = []( char c ){
+            return !(
+                   ( c >= 'A' && c <= 'Z' )
+                || ( c >= 'a' && c <= 'z' )
+                || ( c >= '0' && c <= '9' )
+                || c == '='
+            );
+        };
+        return (
+            !std::memcmp( chars, base64_chars_standard, 62 )
+            && special( chars[ 62 ] )
+            && special( chars[ 63 ] )
+            && chars[ 62 ] != chars[ 63 ]
+        );
+    }
+
+#if defined( SHOW_X86_SIMD )
+
+    // The SIMD versions encode or decode as many whole blocks as they can and
+    // return how much of the input they consumed, leaving the rest for the
+    // scalar code.  See http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+    // and http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html for
+    // explanations of the techniques used.
+    
+    __attribute__(( target( "ssse3" ) ))
+    inline __m128i _base64_encode_block_ssse3(
+        __m128i in,
+        __m128i offsets
     )
     {
-        unsigned char current_sextet;
-        std::string encoded;
+        // Spread each 3 bytes across 4, then shift each sextet into place
+        in = _mm_shuffle_epi8( in, _mm_setr_epi8(
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+        ) );
+        auto indices = _mm_or_si128(
+            _mm_mulhi_epu16(
+                _mm_and_si128( in, _mm_set1_epi32( 0x0FC0FC00 ) ),
+                _mm_set1_epi32( 0x04000040 )
+            ),
+            _mm_mullo_epi16(
+                _mm_and_si128( in, _mm_set1_epi32( 0x003F03F0 ) ),
+                _mm_set1_epi32( 0x01000010 )
+            )
+        );
         
-        auto b64_size = ( ( o.size() + 2 ) / 3 ) * 4;
+        // Map each sextet to the index of its range's offset: 0-25 -> 13,
+        // 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, & 63 -> 12
+        auto ranges = _mm_or_si128(
+            _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) ),
+            _mm_and_si128(
+                _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices ),
+                _mm_set1_epi8( 13 )
+            )
+        );
+        return _mm_add_epi8( indices, _mm_shuffle_epi8( offsets, ranges ) );
+    }
+    
+    __attribute__(( target( "ssse3" ) ))
+    inline __m128i _base64_encode_offsets_ssse3( char c62, char c63 )
+    {
+        return _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52,
+            static_cast< char >( c62 - 62 ),
+            static_cast< char >( c63 - 63 ),
+            'A', 0, 0
+        );
+    }
+    
+    __attribute__(( target( "ssse3" ) ))
+    inline std::size_t _base64_encode_ssse3(
+        const char* in,
+        std::size_t size,
+        char*       out,
+        char        c62,
+        char        c63
+    )
+    {
+        auto offsets = _base64_encode_offsets_ssse3( c62, c63 );
+        std::size_t consumed{ 0 };
         
-        for(
-            std::string::size_type i{ 0 }, j{ 0 };
-            i < b64_size;
-            ++i
-        )
+        // Each block reads 16 bytes but only encodes 12 of them
+        while( size - consumed >= 16 )
         {
-            switch( i % 4 )
-            {
-            case 0:
-                // j
-                // ******** ******** ********
-                // ^^^^^^
-                // i
-                current_sextet = ( o[ j ] >> 2 ) & 0x3F /* 00111111 */;
-                encoded += chars[ current_sextet ];
-                break;
-            case 1:
-                // j        j++
-                // ******** ******** ********
-                //       ^^ ^^^^
-                //       i
-                current_sextet = ( o[ j ] << 4 ) & 0x30 /* 00110000 */;
-                ++j;
-                if( j < o.size() )
-                    current_sextet |= ( o[ j ] >> 4 ) & 0x0F /* 00001111 */;
-                encoded += chars[ current_sextet ];
-                break;
-            case 2:
-                //          j        j++
-                // ******** ******** ********
-                //              ^^^^ ^^
-                //              i
-                if( j < o.size() )
-                {
-                    current_sextet = ( o[ j ] << 2 ) & 0x3C /* 00111100 */;
-                    ++j;
-                    if( j < o.size() )
-                        current_sextet |= ( o[ j ] >> 6 ) & 0x03 /* 00000011 */;
-                    encoded += chars[ current_sextet ];
-                }
-                else
-                    encoded += '=';
+            _mm_storeu_si128(
+                reinterpret_cast< __m128i* >( out ),
+                _base64_encode_block_ssse3(
+                    _mm_loadu_si128(
+                        reinterpret_cast< const __m128i* >( in + consumed )
+                    ),
+                    offsets
+                )
+            );
+            consumed += 12;
+            out      += 16;
+        }
+        
+        return consumed;
+    }
+    
+    __attribute__(( target( "avx2" ) ))
+    inline std::size_t _base64_encode_avx2(
+        const char* in,
+        std::size_t size,
+        char*       out,
+        char        c62,
+        char        c63
+    )
+    {
+        auto offsets = _mm256_broadcastsi128_si256(
+            _base64_encode_offsets_ssse3( c62, c63 )
+        );
+        std::size_t consumed{ 0 };
+        
+        // Each lane gets 12 bytes of input, loaded separately so the second
+        // load can overlap the first
+        while( size - consumed >= 28 )
+        {
+            auto block = _mm256_inserti128_si256(
+                _mm256_castsi128_si256( _mm_loadu_si128(
+                    reinterpret_cast< const __m128i* >( in + consumed )
+                ) ),
+                _mm_loadu_si128(
+                    reinterpret_cast< const __m128i* >( in + consumed + 12 )
+                ),
+                1
+            );
+            
+            block = _mm256_shuffle_epi8( block, _mm256_setr_epi8(
+                1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+            ) );
+            auto indices = _mm256_or_si256(
+                _mm256_mulhi_epu16(
+                    _mm256_and_si256( block, _mm256_set1_epi32( 0x0FC0FC00 ) ),
+                    _mm256_set1_epi32( 0x04000040 )
+                ),
+                _mm256_mullo_epi16(
+                    _mm256_and_si256( block, _mm256_set1_epi32( 0x003F03F0 ) ),
+                    _mm256_set1_epi32( 0x01000010 )
+                )
+            );
+            auto ranges = _mm256_or_si256(
+                _mm256_subs_epu8( indices, _mm256_set1_epi8( 51 ) ),
+                _mm256_and_si256(
+                    _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), indices ),
+                    _mm256_set1_epi8( 13 )
+                )
+            );
+            _mm256_storeu_si256(
+                reinterpret_cast< __m256i* >( out ),
+                _mm256_add_epi8(
+                    indices,
+                    _mm256_shuffle_epi8( offsets, ranges )
+                )
+            );
+            
+            consumed += 24;
+            out      += 32;
+        }
+        
+        return consumed + _base64_encode_ssse3(
+            in + consumed,
+            size - consumed,
+            out,
+            c62,
+            c63
+        );
+    }
+    
+    // Decoding stops at the first block containing anything other than
+    // dictionary characters so the scalar code can report the error.  Each
+    // block writes 4 bytes (SSSE3) or 8 bytes (AVX2) past what it decodes.
+    
+    // Sets each byte of the result to 0xFF if that byte of `block` is in
+    // [low, high], for ASCII ranges
+    __attribute__(( target( "ssse3" ) ))
+    inline __m128i _base64_in_range_ssse3( __m128i block, char low, char high )
+    {
+        return _mm_and_si128(
+            _mm_cmpgt_epi8( block, _mm_set1_epi8( low  - 1 ) ),
+            _mm_cmpgt_epi8( _mm_set1_epi8( high + 1 ), block )
+        );
+    }
+    
+    __attribute__(( target( "avx2" ) ))
+    inline __m256i _base64_in_range_avx2( __m256i block, char low, char high )
+    {
+        return _mm256_and_si256(
+            _mm256_cmpgt_epi8( block, _mm256_set1_epi8( low  - 1 ) ),
+            _mm256_cmpgt_epi8( _mm256_set1_epi8( high + 1 ), block )
+        );
+    }
+    
+    __attribute__(( target( "ssse3" ) ))
+    inline std::size_t _base64_decode_ssse3(
+        const char* in,
+        std::size_t size,
+        char*       out,
+        char        c62,
+        char        c63
+    )
+    {
+        std::size_t consumed{ 0 };
+        
+        while( size - consumed >= 16 )
+        {
+            auto block = _mm_loadu_si128(
+                reinterpret_cast< const __m128i* >( in + consumed )
+            );
+            
+            auto upper = _base64_in_range_ssse3( block, 'A', 'Z' );
+            auto lower = _base64_in_range_ssse3( block, 'a', 'z' );
+            auto digit = _base64_in_range_ssse3( block, '0', '9' );
+            auto is_62 = _mm_cmpeq_epi8( block, _mm_set1_epi8( c62 ) );
+            auto is_63 = _mm_cmpeq_epi8( block, _mm_set1_epi8( c63 ) );
+            
+            auto valid = _mm_or_si128(
+                _mm_or_si128( upper, lower ),
+                _mm_or_si128( digit, _mm_or_si128( is_62, is_63 ) )
+            );
+            if( _mm_movemask_epi8( valid ) != 0xFFFF )
                 break;
-            case 3:
-                //                   j
-                // ******** ******** ********
-                //                     ^^^^^^
-                //                     i
-                if( j < o.size() )
-                {
-                    current_sextet = o[ j ] & 0x3F /* 00111111 */;
-                    ++j;
-                    encoded += chars[ current_sextet ];
-                }
-                else
-                    encoded += '=';
+            
+            auto shift = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128( upper, _mm_set1_epi8( -'A'      ) ),
+                    _mm_and_si128( lower, _mm_set1_epi8( 26 - 'a'  ) )
+                ),
+                _mm_or_si128(
+                    _mm_and_si128( digit, _mm_set1_epi8( 52 - '0'  ) ),
+                    _mm_or_si128(
+                        _mm_and_si128( is_62, _mm_set1_epi8(
+                            static_cast< char >( 62 - c62 )
+                        ) ),
+                        _mm_and_si128( is_63, _mm_set1_epi8(
+                            static_cast< char >( 63 - c63 )
+                        ) )
+                    )
+                )
+            );
+            
+            // Pack each 4 sextets into 3 bytes
+            auto packed = _mm_madd_epi16(
+                _mm_maddubs_epi16(
+                    _mm_add_epi8( block, shift ),
+                    _mm_set1_epi32( 0x01400140 )
+                ),
+                _mm_set1_epi32( 0x00011000 )
+            );
+            _mm_storeu_si128(
+                reinterpret_cast< __m128i* >( out ),
+                _mm_shuffle_epi8( packed, _mm_setr_epi8(
+                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+                ) )
+            );
+            
+            consumed += 16;
+            out      += 12;
+        }
+        
+        return consumed;
+    }
+    
+    __attribute__(( target( "avx2" ) ))
+    inline std::size_t _base64_decode_avx2(
+        const char* in,
+        std::size_t size,
+        char*       out,
+        char        c62,
+        char        c63
+    )
+    {
+        std::size_t consumed{ 0 };
+        
+        while( size - consumed >= 32 )
+        {
+            auto block = _mm256_loadu_si256(
+                reinterpret_cast< const __m256i* >( in + consumed )
+            );
+            
+            auto upper = _base64_in_range_avx2( block, 'A', 'Z' );
+            auto lower = _base64_in_range_avx2( block, 'a', 'z' );
+            auto digit = _base64_in_range_avx2( block, '0', '9' );
+            auto is_62 = _mm256_cmpeq_epi8( block, _mm256_set1_epi8( c62 ) );
+            auto is_63 = _mm256_cmpeq_epi8( block, _mm256_set1_epi8( c63 ) );
+            
+            auto valid = _mm256_or_si256(
+                _mm256_or_si256( upper, lower ),
+                _mm256_or_si256( digit, _mm256_or_si256( is_62, is_63 ) )
+            );
+            if( ~static_cast< unsigned int >( _mm256_movemask_epi8( valid ) ) )
                 break;
-            }
+            
+            auto shift = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_and_si256( upper, _mm256_set1_epi8( -'A'     ) ),
+                    _mm256_and_si256( lower, _mm256_set1_epi8( 26 - 'a' ) )
+                ),
+                _mm256_or_si256(
+                    _mm256_and_si256( digit, _mm256_set1_epi8( 52 - '0' ) ),
+                    _mm256_or_si256(
+                        _mm256_and_si256( is_62, _mm256_set1_epi8(
+                            static_cast< char >( 62 - c62 )
+                        ) ),
+                        _mm256_and_si256( is_63, _mm256_set1_epi8(
+                            static_cast< char >( 63 - c63 )
+                        ) )
+                    )
+                )
+            );
+            
+            auto packed = _mm256_madd_epi16(
+                _mm256_maddubs_epi16(
+                    _mm256_add_epi8( block, shift ),
+                    _mm256_set1_epi32( 0x01400140 )
+                ),
+                _mm256_set1_epi32( 0x00011000 )
+            );
+            packed = _mm256_shuffle_epi8( packed, _mm256_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+            ) );
+            // Close the gap between the two lanes' 12 bytes
+            _mm256_storeu_si256(
+                reinterpret_cast< __m256i* >( out ),
+                _mm256_permutevar8x32_epi32(
+                    packed,
+                    _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 7, 7 )
+                )
+            );
+            
+            consumed += 32;
+            out      += 24;
         }
         
-        return encoded;
+        return consumed + _base64_decode_ssse3(
+            in + consumed,
+            size - consumed,
+            out,
+            c62,
+            c63
+        );
+    }
+
+#endif
+
+    // The SIMD implementations are picked once, on first use; these are
+    // `nullptr` if the CPU doesn't support any of them, in which case
+    // `_base64_encode()` & `_base64_decode()` only use the scalar code
+    inline _base64_simd_function _base64_simd_encoder()
+    {
+        static const _base64_simd_function encoder{ []() -> _base64_simd_function {
+#if defined( SHOW_X86_SIMD )
+            __builtin_cpu_init();
+            if( __builtin_cpu_supports( "avx2" ) )
+                return &_base64_encode_avx2;
+            if( __builtin_cpu_supports( "ssse3" ) )
+                return &_base64_encode_ssse3;
+#endif
+            return nullptr;
+        }() };
+        return encoder;
+    }
+    
+    inline _base64_simd_function _base64_simd_decoder()
+    {
+        static const _base64_simd_function decoder{ []() -> _base64_simd_function {
+#if defined( SHOW_X86_SIMD )
+            __builtin_cpu_init();
+            if( __builtin_cpu_supports( "avx2" ) )
+                return &_base64_decode_avx2;
+            if( __builtin_cpu_supports( "ssse3" ) )
+                return &_base64_decode_ssse3;
+#endif
+            return nullptr;
+        }() };
+        return decoder;
+    }
+    
+    // The actual implementations, which take the SIMD function to use (or
+    // `nullptr` for none) so each can be tested & benchmarked
+    std::string _base64_encode(
+        const std::string&,
+        const char*,
+        _base64_simd_function
+    );
+    std::string _base64_decode(
+        const std::string&,
+        const char*,
+        base64_flags,
+        _base64_simd_function
+    );
+    
+    // Picks one of the precomputed reverse lookups if `chars` is one of the
+    // standard dictionaries, otherwise fills in and returns `custom`, which
+    // must have room for 256 entries
+    const signed char* _base64_reverse_lookup(
+        const char*  chars,
+        signed char* custom
+    );
+    
+    // Encodes `size` bytes including any padding, returning the end of the
+    // output
+    char* _base64_encode_into(
+        const char*           in,
+        std::size_t           size,
+        char*                 out,
+        const char*           chars,
+        _base64_simd_function simd_encoder
+    );
+    // Decodes `size` characters that have already had their padding removed,
+    // returning the end of the output; the SIMD decoders may write up to
+    // `BASE64_DECODE_SLACK` bytes past that
+    char* _base64_decode_into(
+        const char*           in,
+        std::size_t           size,
+        char*                 out,
+        const char*           chars,
+        const signed char*    reverse,
+        _base64_simd_function simd_decoder
+    );
+    
+    // Throws the error for the first character in [begin, end) that isn't in
+    // the dictionary
+    inline void _base64_throw_invalid(
+        const signed char* reverse,
+        const char*        begin,
+        const char*        end
+    )
+    {
+        for( ; begin < end; ++begin )
+            if( *begin == '=' )
+                throw base64_decode_error{ "premature padding" };
+            else if( reverse[ static_cast< unsigned char >( *begin ) ] < 0 )
+                throw base64_decode_error{ "invalid base64 character" };
+    }
+    
+    
+    // Implementations /////////////////////////////////////////////////////////
+    
+    
+    inline std::string base64_encode(
+        const std::string& o,
+        const char* chars
+    )
+    {
+        return _base64_encode( o, chars, _base64_simd_encoder() );
     }
     
     inline std::string base64_decode(
@@ -115,19 +648,37 @@ namespace show
         const char* chars,
         base64_flags flags
     )
+    {
+        return _base64_decode( o, chars, flags, _base64_simd_decoder() );
+    }
+    
+    inline std::string _base64_encode(
+        const std::string&    o,
+        const char*           chars,
+        _base64_simd_function simd_encoder
+    )
+    {
+        std::string encoded( ( ( o.size() + 2 ) / 3 ) * 4, '\0' );
+        _base64_encode_into(
+            o.data(),
+            o.size(),
+            &encoded[ 0 ],
+            chars,
+            simd_encoder
+        );
+        return encoded;
+    }
+    
+    inline std::string _base64_decode(
+        const std::string&    o,
+        const char*           chars,
+        base64_flags          flags,
+        _base64_simd_function simd_decoder
+    )
     {
         auto unpadded_len = o.size();
-        for(
-            auto r_iter = o.rbegin();
-            r_iter != o.rend();
-            ++r_iter
-        )
-        {
-            if( *r_iter == '=' )
-                --unpadded_len;
-            else
-                break;
-        }
+        while( unpadded_len > 0 && o[ unpadded_len - 1 ] == '=' )
+            --unpadded_len;
         
         auto b64_size = unpadded_len;
         if( b64_size % 4 )
@@ -136,70 +687,344 @@ namespace show
         if( !( flags & base64_ignore_padding ) && b64_size > o.size() )
             throw base64_decode_error{ "missing required padding" };
         
-        std::map< char, /*unsigned*/ char > reverse_lookup;
-        for( /*unsigned*/ char i{ 0 }; i < 64; ++i )
-            reverse_lookup[ chars[ i ] ] = i;
+        signed char custom_reverse[ 256 ];
+        auto reverse = _base64_reverse_lookup( chars, custom_reverse );
         
-        auto get_hextet = [ &reverse_lookup ]( /*unsigned*/ char c ){
-            if( c == '=' )
-                throw base64_decode_error{ "premature padding" };
-            auto found_hextet = reverse_lookup.find( c );
-            if( found_hextet == reverse_lookup.end() )
-                throw base64_decode_error{ "invalid base64 character" };
-            return found_hextet -> second;
+        // Every 4 characters decode to 3 bytes, and any 2 or 3 left over to 1
+        // or 2 more
+        auto decoded_size = unpadded_len / 4 * 3 + (
+            unpadded_len % 4 > 1 ? unpadded_len % 4 - 1 : 0
+        );
+        std::string decoded( decoded_size + BASE64_DECODE_SLACK, '\0' );
+        _base64_decode_into(
+            o.data(),
+            unpadded_len,
+            &decoded[ 0 ],
+            chars,
+            reverse,
+            simd_decoder
+        );
+        decoded.resize( decoded_size );
+        return decoded;
+    }
+    
+    inline const signed char* _base64_reverse_lookup(
+        const char*  chars,
+        signed char* custom
+    )
+    {
+        if( !std::memcmp( chars, base64_chars_standard, 64 ) )
+            return _base64_reverse_standard();
+        else if( !std::memcmp( chars, base64_chars_urlsafe, 64 ) )
+            return _base64_reverse_urlsafe();
+        
+        std::memset( custom, -1, 256 );
+        for( signed char i{ 0 }; i < 64; ++i )
+            // Padding is never treated as data, even if it's in `chars`
+            if( chars[ i ] != '=' )
+                custom[ static_cast< unsigned char >( chars[ i ] ) ] = i;
+        return custom;
+    }
+    
+    inline char* _base64_encode_into(
+        const char*           in,
+        std::size_t           size,
+        char*                 out,
+        const char*           chars,
+        _base64_simd_function simd_encoder
+    )
+    {
+        auto end = in + size;
+        
+        if( simd_encoder && _base64_simd_compatible( chars ) )
+        {
+            auto consumed = simd_encoder(
+                in,
+                size,
+                out,
+                chars[ 62 ],
+                chars[ 63 ]
+            );
+            in  += consumed;
+            out += consumed / 3 * 4;
+        }
+        
+        auto byte = []( const char* c ){
+            return static_cast< unsigned char >( *c );
         };
         
-        /*unsigned*/ char current_octet;
-        std::string decoded;
-        for( std::string::size_type i{ 0 }; i < unpadded_len; ++i )
+        for( ; end - in >= 3; in += 3, out += 4 )
         {
-            auto first_hextet = get_hextet( o[ i ] );
-            char second_hextet = 0x00;
-            if( i + 1 < unpadded_len )
-                second_hextet = get_hextet( o[ i + 1 ] );
+            // ******** ******** ********
+            // ^^^^^^^^ ^^^^^^^^ ^^^^^^^^
+            // 000000 111111 222222 333333
+            auto a = byte( in ), b = byte( in + 1 ), c = byte( in + 2 );
+            out[ 0 ] = chars[   a >> 2                   ];
+            out[ 1 ] = chars[ ( a & 0x03 ) << 4 | b >> 4 ];
+            out[ 2 ] = chars[ ( b & 0x0F ) << 2 | c >> 6 ];
+            out[ 3 ] = chars[   c & 0x3F                 ];
+        }
+        
+        if( end - in == 1 )
+        {
+            auto a = byte( in );
+            *out++ = chars[   a >> 2          ];
+            *out++ = chars[ ( a & 0x03 ) << 4 ];
+            *out++ = '=';
+            *out++ = '=';
+        }
+        else if( end - in == 2 )
+        {
+            auto a = byte( in ), b = byte( in + 1 );
+            *out++ = chars[   a >> 2                   ];
+            *out++ = chars[ ( a & 0x03 ) << 4 | b >> 4 ];
+            *out++ = chars[ ( b & 0x0F ) << 2          ];
+            *out++ = '=';
+        }
+        
+        return out;
+    }
+    
+    inline char* _base64_decode_into(
+        const char*           in,
+        std::size_t           size,
+        char*                 out,
+        const char*           chars,
+        const signed char*    reverse,
+        _base64_simd_function simd_decoder
+    )
+    {
+        auto end = in + size;
+        
+        if( simd_decoder && _base64_simd_compatible( chars ) )
+        {
+            auto consumed = simd_decoder(
+                in,
+                size,
+                out,
+                chars[ 62 ],
+                chars[ 63 ]
+            );
+            in  += consumed;
+            out += consumed / 4 * 3;
+        }
+        
+        auto sextet = [ reverse ]( const char* c ){
+            return static_cast< int >(
+                reverse[ static_cast< unsigned char >( *c ) ]
+            );
+        };
+        
+        for( ; end - in >= 4; in += 4, out += 3 )
+        {
+            // ****** ****** ****** ******
+            // ^^^^^^ ^^^^^^ ^^^^^^ ^^^^^^
+            // 000000 001111 111122 222222
+            auto a = sextet( in     );
+            auto b = sextet( in + 1 );
+            auto c = sextet( in + 2 );
+            auto d = sextet( in + 3 );
+            if( ( a | b | c | d ) < 0 )
+                _base64_throw_invalid( reverse, in, in + 4 );
             
-            switch( i % 4 )
+            out[ 0 ] = static_cast< char >( a << 2 | b >> 4 );
+            out[ 1 ] = static_cast< char >( b << 4 | c >> 2 );
+            out[ 2 ] = static_cast< char >( c << 6 | d      );
+        }
+        
+        // A single leftover character doesn't make a whole byte, but is still
+        // checked
+        _base64_throw_invalid( reverse, in, end );
+        if( end - in > 1 )
+            *out++ = static_cast< char >(
+                sextet( in ) << 2 | sextet( in + 1 ) >> 4
+            );
+        if( end - in > 2 )
+            *out++ = static_cast< char >(
+                sextet( in + 1 ) << 4 | sextet( in + 2 ) >> 2
+            );
+        
+        return out;
+    }
+    
+    
+    // Stream buffers //////////////////////////////////////////////////////////
+    
+    
+    inline base64_decode_buf::base64_decode_buf(
+        std::streambuf& source,
+        const char*     chars,
+        base64_flags    flags
+    ) :
+        _source      { source                                           },
+        _chars       { chars                                            },
+        _flags       { flags                                            },
+        _reverse     { _base64_reverse_lookup( chars, _custom_reverse ) },
+        _simd_decoder{ _base64_simd_decoder()                           },
+        _carried     { 0                                                },
+        _padding     { 0                                                },
+        _finished    { false                                            }
+    {
+        setg( _decoded, _decoded, _decoded );
+    }
+    
+    inline base64_decode_buf::int_type base64_decode_buf::underflow()
+    {
+        while( gptr() >= egptr() )
+        {
+            if( _finished )
+                return traits_type::eof();
+            
+            auto read = _source.sgetn(
+                _encoded + _carried,
+                static_cast< std::streamsize >(
+                    ENCODED_BLOCK_SIZE - _carried
+                )
+            );
+            
+            if( read <= 0 )
             {
-            case 0:
-                // i
-                // ****** ****** ****** ******
-                // ^^^^^^ ^^
-                current_octet = (
-                      ( first_hextet << 2 )
-                    | ( ( second_hextet >> 4 ) & 0x03 ) /* 00000011 */
-                );
-                break;
-            case 1:
-                //        i
-                // ****** ****** ****** ******
-                //          ^^^^ ^^^^
-                current_octet = (
-                      ( first_hextet << 4 )
-                    | ( ( second_hextet >> 2 ) & 0x0F ) /* 00001111 */
-                );
-                break;
-            case 2:
-                //               i
-                // ****** ****** ****** ******
-                //                   ^^ ^^^^^^
-                current_octet = (
-                      ( first_hextet << 6 )
-                    | ( second_hextet & 0x3F ) /* 00111111 */
+                // The remaining 0-3 characters are decoded the same way the
+                // end of a string would be
+                auto padded_size = _carried;
+                if( padded_size % 4 )
+                    padded_size += 4 - ( padded_size % 4 );
+                if(
+                    !( _flags & base64_ignore_padding )
+                    && padded_size > _carried + _padding
+                )
+                    throw base64_decode_error{ "missing required padding" };
+                
+                auto decoded_end = _base64_decode_into(
+                    _encoded,
+                    _carried,
+                    _decoded,
+                    _chars,
+                    _reverse,
+                    _simd_decoder
                 );
-                break;
-            case 3:
-                //                      i
-                // ****** ****** ****** ******
+                setg( _decoded, _decoded, decoded_end );
+                _finished = true;
                 continue;
             }
             
-            if( i + 1 < unpadded_len )
-                decoded += current_octet;
-            else
-                break;
+            // Padding is only stripped from the end, so anything but more
+            // padding after the first one is an error -- after any errors in
+            // the characters before it
+            auto available = _carried + static_cast< std::size_t >( read );
+            auto data_end  = _padding ? _carried : available;
+            for( auto i = _carried; i < available; ++i )
+                if( _encoded[ i ] == '=' )
+                {
+                    if( !_padding )
+                        data_end = i;
+                    ++_padding;
+                }
+                else if( _padding )
+                {
+                    _base64_throw_invalid(
+                        _reverse,
+                        _encoded,
+                        _encoded + data_end
+                    );
+                    throw base64_decode_error{ "premature padding" };
+                }
+            
+            auto whole_groups = data_end / 4 * 4;
+            auto decoded_end  = _base64_decode_into(
+                _encoded,
+                whole_groups,
+                _decoded,
+                _chars,
+                _reverse,
+                _simd_decoder
+            );
+            
+            _carried = data_end - whole_groups;
+            std::memmove( _encoded, _encoded + whole_groups, _carried );
+            setg( _decoded, _decoded, decoded_end );
         }
         
-        return decoded;
+        return traits_type::to_int_type( *gptr() );
+    }
+    
+    inline base64_encode_buf::base64_encode_buf(
+        std::streambuf& sink,
+        const char*     chars
+    ) :
+        _sink        { sink                   },
+        _chars       { chars                  },
+        _simd_encoder{ _base64_simd_encoder() },
+        _finished    { false                  }
+    {
+        setp( _raw, _raw + RAW_BLOCK_SIZE );
+    }
+    
+    inline base64_encode_buf::~base64_encode_buf()
+    {
+        // Call `finish()` explicitly to find out if this fails
+        try
+        {
+            finish();
+        }
+        catch( ... ) {}
+    }
+    
+    inline bool base64_encode_buf::finish()
+    {
+        if( _finished )
+            return true;
+        _finished = true;
+        
+        auto sent = _send( true );
+        setp( nullptr, nullptr );
+        return sent;
+    }
+    
+    inline bool base64_encode_buf::_send( bool last )
+    {
+        auto buffered = static_cast< std::size_t >( pptr() - pbase() );
+        auto count    = last ? buffered : buffered / 3 * 3;
+        
+        auto encoded_end = _base64_encode_into(
+            _raw,
+            count,
+            _encoded,
+            _chars,
+            _simd_encoder
+        );
+        auto encoded_size = static_cast< std::streamsize >(
+            encoded_end - _encoded
+        );
+        
+        // Keep the 0-2 bytes that don't make up a whole group for next time
+        std::memmove( _raw, _raw + count, buffered - count );
+        setp( _raw, _raw + RAW_BLOCK_SIZE );
+        pbump( static_cast< int >( buffered - count ) );
+        
+        return _sink.sputn( _encoded, encoded_size ) == encoded_size;
+    }
+    
+    inline base64_encode_buf::int_type base64_encode_buf::overflow(
+        int_type ch
+    )
+    {
+        if( _finished || !_send( false ) )
+            return traits_type::eof();
+        
+        if( traits_type::eq_int_type( ch, traits_type::eof() ) )
+            return traits_type::not_eof( ch );
+        
+        *pptr() = traits_type::to_char_type( ch );
+        pbump( 1 );
+        return ch;
+    }
+    
+    inline int base64_encode_buf::sync()
+    {
+        if( !_finished && !_send( false ) )
+            return -1;
+        return _sink.pubsync();
     }
 }
 
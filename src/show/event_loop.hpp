@@ -0,0 +1,592 @@
+#pragma once
+#ifndef SHOW_EVENT_LOOP_HPP
+#define SHOW_EVENT_LOOP_HPP
+
+
+#include "../show.hpp"
+#include "timer_wheel.hpp"
+
+#include <algorithm>    // std::min()
+#include <atomic>
+#include <chrono>
+#include <cstdint>      // std::uint32_t, std::uint64_t
+#include <exception>    // std::exception_ptr
+#include <functional>   // std::function<>
+#include <memory>       // std::unique_ptr<>
+#include <stdexcept>    // std::invalid_argument
+#include <unordered_map>
+#include <utility>      // std::move()
+#include <vector>
+
+#if !defined( __linux__ )
+#error "show::event_loop requires epoll, which is only available on Linux"
+#endif
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+
+namespace show // `show::event_loop` class /////////////////////////////////////
+{
+    class event_loop
+    {
+    public:
+        using event_flags = unsigned int;
+        static const event_flags READABLE    = 0x01;
+        static const event_flags WRITABLE    = 0x02;
+        // The connection has been reset or has failed
+        static const event_flags HANGUP      = 0x04;
+        // The client has shut down its half of the connection, but may still
+        // be reading
+        static const event_flags READ_HANGUP = 0x08;
+        
+        // Return `false` to close the connection
+        using handler_type = std::function< bool(
+            connection&,
+            event_flags
+        ) >;
+    
+    protected:
+        static const int MAX_EVENTS{ 256 };
+        
+        enum : std::uint64_t { NO_DEADLINE = 0xFFFFFFFFFFFFFFFF };
+        
+        // Deadlines are in milliseconds since the loop was created
+        struct _client
+        {
+            std::unique_ptr< connection > conn;
+            std::uint64_t idle_deadline;
+            std::uint64_t header_deadline;
+            std::uint64_t request_deadline;
+            // A request has started arriving, & its header block has been
+            // read; the handler is done with it once it returns normally
+            bool          in_request;
+            bool          headers_read;
+            // The handler has been told the client won't send anything more,
+            // so all that's left is to send what it queued
+            bool          read_hangup;
+        };
+        
+        show::server      _server;
+        handler_type      _handler;
+        int               _connection_timeout;
+        int               _idle_timeout;
+        int               _header_timeout;
+        int               _request_timeout;
+        socket_fd         _epoll_descriptor;
+        socket_fd         _wake_descriptor;
+        std::atomic_bool  _stopped;
+        std::unordered_map< socket_fd, _client > _connections;
+        std::vector< epoll_event > _events;
+        std::chrono::steady_clock::time_point    _start;
+        // Holds the earliest deadline of each connection, keyed by descriptor
+        timer_wheel       _timers;
+        
+        void _watch( socket_fd, std::uint32_t events );
+        void _accept_all();
+        void _dispatch( socket_fd, event_flags, std::exception_ptr& );
+        // Sends what's queued on a connection after a read hangup, closing it
+        // once that's done
+        void _drain( socket_fd, _client&, event_flags, std::exception_ptr& );
+        void _close( socket_fd );
+        
+        std::uint64_t _milliseconds() const;
+        static std::uint64_t _deadline( std::uint64_t now, int timeout );
+        void _start_request( _client&, std::uint64_t now );
+        void _schedule( socket_fd, const _client& );
+    
+    public:
+        event_loop( show::server&&, handler_type );
+        ~event_loop();
+        
+        event_loop( const event_loop& ) = delete;
+        event_loop& operator =( const event_loop& ) = delete;
+        
+        std::size_t run_once( int timeout_milliseconds = -1 );
+        void        run();
+        void        stop();
+        
+        const show::server& server() const;
+        std::size_t         connection_count() const;
+        
+        int connection_timeout() const;
+        int connection_timeout( int );
+        
+        // Deadlines enforced by the loop itself, in milliseconds; -1 disables
+        // each (the default)
+        int idle_timeout   () const;
+        int idle_timeout   ( int );
+        int header_timeout () const;
+        int header_timeout ( int );
+        int request_timeout() const;
+        int request_timeout( int );
+    };
+}
+
+
+namespace show // `show::event_loop` implementation ////////////////////////////
+{
+    inline event_loop::event_loop( show::server&& s, handler_type handler ) :
+        _server            { std::move( s )       },
+        _handler           { std::move( handler ) },
+        _connection_timeout{ 0                    },
+        _idle_timeout      { -1                   },
+        _header_timeout    { -1                   },
+        _request_timeout   { -1                   },
+        _epoll_descriptor  { -1                   },
+        _wake_descriptor   { -1                   },
+        _stopped           { false                },
+        _events            ( MAX_EVENTS           ),
+        _start             ( std::chrono::steady_clock::now() )
+    {
+        // A connection waiting forever would stall every other connection, so
+        // the server's default of -1 isn't inherited
+        if( _server.timeout() > 0 )
+            _connection_timeout = _server.timeout();
+        
+        // The listen socket is only ever drained when epoll reports it as
+        // readable, so `serve()` should never wait
+        _server.timeout( 0 );
+        
+        _epoll_descriptor = epoll_create1( EPOLL_CLOEXEC );
+        if( _epoll_descriptor == -1 )
+            throw socket_error{
+                "failed to create event loop: "
+                + std::string{ std::strerror( errno ) }
+            };
+        
+        _wake_descriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        if( _wake_descriptor == -1 )
+        {
+            auto errno_copy = errno;
+            close( _epoll_descriptor );
+            throw socket_error{
+                "failed to create event loop wakeup descriptor: "
+                + std::string{ std::strerror( errno_copy ) }
+            };
+        }
+        
+        try
+        {
+            // Level-triggered, so connections left waiting when accepting
+            // fails (e.g. out of descriptors) are reported again next time
+            _watch( _server.listen_socket -> descriptor, EPOLLIN           );
+            _watch( _wake_descriptor                   , EPOLLIN | EPOLLET );
+        }
+        catch( ... )
+        {
+            close( _wake_descriptor  );
+            close( _epoll_descriptor );
+            throw;
+        }
+    }
+    
+    inline event_loop::~event_loop()
+    {
+        // Close client connections before the epoll descriptor so they are
+        // never left registered with a closed epoll instance
+        _connections.clear();
+        close( _wake_descriptor  );
+        close( _epoll_descriptor );
+    }
+    
+    inline void event_loop::_watch( socket_fd fd, std::uint32_t events )
+    {
+        epoll_event event;
+        std::memset( &event, 0, sizeof( event ) );
+        event.events  = events;
+        event.data.fd = fd;
+        
+        if( epoll_ctl( _epoll_descriptor, EPOLL_CTL_ADD, fd, &event ) == -1 )
+            throw socket_error{
+                "failed to add socket to event loop: "
+                + std::string{ std::strerror( errno ) }
+            };
+    }
+    
+    inline void event_loop::_accept_all()
+    {
+        // If this fails part-way, the server holds onto the error & throws it
+        // next time, so anything accepted here must still be watched
+        std::vector< connection > accepted;
+        if( _server.try_serve_many( accepted ) != io_status::SUCCESS )
+            return;
+        
+        std::exception_ptr first_exception;
+        auto now = _milliseconds();
+        for( auto& c : accepted )
+        {
+            c.timeout( _connection_timeout );
+            auto fd = c._serve_socket.descriptor;
+            
+            auto& client = _connections[ fd ];
+            client.conn.reset( new connection{ std::move( c ) } );
+            client.idle_deadline    = _deadline( now, _idle_timeout );
+            client.header_deadline  = NO_DEADLINE;
+            client.request_deadline = NO_DEADLINE;
+            client.in_request       = false;
+            client.headers_read     = false;
+            client.read_hangup      = false;
+            
+            try
+            {
+                _watch(
+                    fd,
+                    EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET
+                );
+            }
+            catch( ... )
+            {
+                _connections.erase( fd );
+                if( !first_exception )
+                    first_exception = std::current_exception();
+                continue;
+            }
+            _schedule( fd, client );
+        }
+        
+        if( first_exception )
+            std::rethrow_exception( first_exception );
+    }
+    
+    inline void event_loop::_dispatch(
+        socket_fd           fd,
+        event_flags         flags,
+        std::exception_ptr& first_exception
+    )
+    {
+        auto found = _connections.find( fd );
+        if( found == _connections.end() )
+            // Closed earlier in this same batch of events
+            return;
+        
+        auto& client = found -> second;
+        auto& c      = *client.conn;
+        bool keep_open{ true };
+        bool returned { false };
+        
+        if( client.read_hangup )
+        {
+            _drain( fd, client, flags, first_exception );
+            return;
+        }
+        
+        // The header & request deadlines run from when the first of a
+        // request arrives, rather than from when the previous one finished
+        if( !client.in_request && ( flags & READABLE ) )
+            _start_request( client, _milliseconds() );
+        auto requests_read = c._requests_read;
+        
+        try
+        {
+            // Data already pulled into the connection's buffer (e.g. a
+            // pipelined request) won't generate another edge, so keep calling
+            // the handler as long as it's making progress on it
+            std::streamsize buffered;
+            do
+            {
+                buffered  = c.showmanyc();
+                keep_open = _handler( c, flags );
+            } while(
+                keep_open
+                && c.showmanyc() > 0
+                && c.showmanyc() != buffered
+            );
+            returned = true;
+        }
+        catch( const show::connection_timeout& ct )
+        {
+            // Nothing more to read/send right now; wait for the next event
+        }
+        catch( const client_disconnected& cd )
+        {
+            keep_open = false;
+        }
+        catch( ... )
+        {
+            keep_open = false;
+            if( !first_exception )
+                first_exception = std::current_exception();
+        }
+        
+        if( !keep_open || ( flags & HANGUP ) )
+        {
+            _close( fd );
+            return;
+        }
+        
+        // A client that has only shut down its half of the connection may
+        // still be reading the response, so it's kept until that's sent; no
+        // more requests can arrive, so only the idle timeout applies
+        if( flags & READ_HANGUP )
+        {
+            client.header_deadline  = NO_DEADLINE;
+            client.request_deadline = NO_DEADLINE;
+            client.read_hangup      = true;
+            _drain( fd, client, flags, first_exception );
+            return;
+        }
+        
+        auto now = _milliseconds();
+        client.idle_deadline = _deadline( now, _idle_timeout );
+        if( c._requests_read != requests_read )
+        {
+            client.header_deadline = NO_DEADLINE;
+            client.headers_read    = true;
+        }
+        if( returned && client.headers_read )
+        {
+            client.request_deadline = NO_DEADLINE;
+            client.in_request       = false;
+            client.headers_read     = false;
+            // Part of a pipelined request may already be buffered, in which
+            // case no new event will mark its arrival
+            if( c.showmanyc() > 0 )
+                _start_request( client, now );
+        }
+        _schedule( fd, client );
+    }
+    
+    inline void event_loop::_drain(
+        socket_fd           fd,
+        _client&            client,
+        event_flags         flags,
+        std::exception_ptr& first_exception
+    )
+    {
+        bool drained{ true };
+        if( !( flags & HANGUP ) )
+            try
+            {
+                drained = client.conn -> try_flush() != io_status::TIMEOUT;
+            }
+            catch( ... )
+            {
+                if( !first_exception )
+                    first_exception = std::current_exception();
+            }
+        
+        if( drained )
+        {
+            _close( fd );
+            return;
+        }
+        
+        // Wait for the next edge, as long as the client keeps reading
+        client.idle_deadline = _deadline( _milliseconds(), _idle_timeout );
+        _schedule( fd, client );
+    }
+    
+    inline void event_loop::_close( socket_fd fd )
+    {
+        epoll_ctl( _epoll_descriptor, EPOLL_CTL_DEL, fd, nullptr );
+        _connections.erase( fd );
+        _timers.cancel( static_cast< timer_wheel::key_type >( fd ) );
+    }
+    
+    inline std::uint64_t event_loop::_milliseconds() const
+    {
+        return static_cast< std::uint64_t >(
+            std::chrono::duration_cast< std::chrono::milliseconds >(
+                std::chrono::steady_clock::now() - _start
+            ).count()
+        );
+    }
+    
+    inline std::uint64_t event_loop::_deadline(
+        std::uint64_t now,
+        int           timeout
+    )
+    {
+        if( timeout < 0 )
+            return NO_DEADLINE;
+        return now + static_cast< std::uint64_t >( timeout );
+    }
+    
+    inline void event_loop::_start_request( _client& client, std::uint64_t now )
+    {
+        client.header_deadline  = _deadline( now, _header_timeout  );
+        client.request_deadline = _deadline( now, _request_timeout );
+        client.in_request       = true;
+        client.headers_read     = false;
+    }
+    
+    inline void event_loop::_schedule( socket_fd fd, const _client& client )
+    {
+        auto deadline = std::min( {
+            client.idle_deadline,
+            client.header_deadline,
+            client.request_deadline
+        } );
+        auto key = static_cast< timer_wheel::key_type >( fd );
+        if( deadline == NO_DEADLINE )
+            _timers.cancel( key );
+        else
+            _timers.schedule( key, deadline );
+    }
+    
+    inline std::size_t event_loop::run_once( int timeout_milliseconds )
+    {
+        // Wake up in time to close connections that have passed a deadline
+        auto timer_wait = _timers.next_advance();
+        if( timer_wait >= 0 )
+        {
+            auto behind = static_cast< std::int64_t >(
+                _milliseconds() - _timers.now()
+            );
+            timer_wait = timer_wait > behind ? timer_wait - behind : 0;
+            if(
+                timeout_milliseconds < 0
+                || timer_wait < timeout_milliseconds
+            )
+                timeout_milliseconds = static_cast< int >( timer_wait );
+        }
+        
+        int event_count;
+        do
+        {
+            event_count = epoll_wait(
+                _epoll_descriptor,
+                _events.data(),
+                static_cast< int >( _events.size() ),
+                timeout_milliseconds
+            );
+        } while( event_count == -1 && errno == EINTR );
+        
+        if( event_count == -1 )
+            throw socket_error{
+                "failure to wait on event loop: "
+                + std::string{ std::strerror( errno ) }
+            };
+        
+        // Any exception thrown by a handler is held until every event in this
+        // batch has been dispatched, as edge-triggered events that are skipped
+        // will not be reported again
+        std::exception_ptr first_exception;
+        std::size_t        dispatched{ 0 };
+        
+        for( int i = 0; i < event_count; ++i )
+        {
+            auto  fd     = _events[ i ].data.fd;
+            auto  events = _events[ i ].events;
+            
+            if( fd == _server.listen_socket -> descriptor )
+                try
+                {
+                    _accept_all();
+                }
+                catch( ... )
+                {
+                    if( !first_exception )
+                        first_exception = std::current_exception();
+                }
+            else if( fd == _wake_descriptor )
+            {
+                std::uint64_t wakeups;
+                while( read( _wake_descriptor, &wakeups, sizeof( wakeups ) ) > 0 );
+            }
+            else
+            {
+                event_flags flags{ 0 };
+                if( events & EPOLLIN )
+                    flags |= READABLE;
+                if( events & EPOLLOUT )
+                    flags |= WRITABLE;
+                if( events & ( EPOLLHUP | EPOLLERR ) )
+                    flags |= HANGUP;
+                if( events & EPOLLRDHUP )
+                    flags |= READ_HANGUP;
+                
+                _dispatch( fd, flags, first_exception );
+                ++dispatched;
+            }
+        }
+        
+        _timers.advance( _milliseconds(), [ this ]( timer_wheel::key_type fd ){
+            _close( static_cast< socket_fd >( fd ) );
+        } );
+        
+        if( first_exception )
+            std::rethrow_exception( first_exception );
+        
+        return dispatched;
+    }
+    
+    inline void event_loop::run()
+    {
+        _stopped = false;
+        while( !_stopped )
+            run_once();
+    }
+    
+    inline void event_loop::stop()
+    {
+        _stopped = true;
+        std::uint64_t wakeup{ 1 };
+        // Failure here only means the counter is saturated, in which case the
+        // loop is already going to wake up
+        auto unused = write( _wake_descriptor, &wakeup, sizeof( wakeup ) );
+        ( void )unused;
+    }
+    
+    inline const show::server& event_loop::server() const
+    {
+        return _server;
+    }
+    
+    inline std::size_t event_loop::connection_count() const
+    {
+        return _connections.size();
+    }
+    
+    inline int event_loop::connection_timeout() const
+    {
+        return _connection_timeout;
+    }
+    
+    inline int event_loop::connection_timeout( int t )
+    {
+        if( t < 0 )
+            throw std::invalid_argument{
+                "event loop connection timeout must not be negative"
+            };
+        _connection_timeout = t;
+        return _connection_timeout;
+    }
+    
+    inline int event_loop::idle_timeout() const
+    {
+        return _idle_timeout;
+    }
+    
+    inline int event_loop::idle_timeout( int t )
+    {
+        _idle_timeout = t;
+        return _idle_timeout;
+    }
+    
+    inline int event_loop::header_timeout() const
+    {
+        return _header_timeout;
+    }
+    
+    inline int event_loop::header_timeout( int t )
+    {
+        _header_timeout = t;
+        return _header_timeout;
+    }
+    
+    inline int event_loop::request_timeout() const
+    {
+        return _request_timeout;
+    }
+    
+    inline int event_loop::request_timeout( int t )
+    {
+        _request_timeout = t;
+        return _request_timeout;
+    }
+}
+
+
+#endif
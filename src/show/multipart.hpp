@@ -5,8 +5,9 @@
 
 #include "../show.hpp"
 
-#include <functional>   // std::function<>
+#include <cstring>      // std::memcmp(), std::memmove()
 #include <streambuf>
+#include <system_error> // std::system_error
 #include <utility>      // std::forward<>()
 #include <vector>
 
@@ -16,6 +17,10 @@ namespace show // `show::multipart` class //////////////////////////////////////
     class multipart
     {
     protected:
+        // Content is read from `_buffer` in blocks of up to this size; it will
+        // be larger if needed to fit at least two delimiters
+        static const std::size_t SCAN_BLOCK_SIZE{ 64 * 1024 };
+        
         std::streambuf* _buffer;
         std::string     _boundary;
         enum class state
@@ -25,6 +30,29 @@ namespace show // `show::multipart` class //////////////////////////////////////
             FINISHED
         } _state;
         
+        // Segments end at "\n--" followed by the boundary, optionally preceded
+        // by a "\r"; `_delimiter_skip` is the Boyer-Moore-Horspool bad
+        // character table for finding it
+        std::string         _delimiter;
+        std::size_t         _delimiter_skip[ 256 ];
+        // Content read from `_buffer` but not yet given to a segment is in
+        // [`_scan_begin`, `_scan_end`)
+        std::vector< char > _scan_buffer;
+        std::size_t         _scan_begin;
+        std::size_t         _scan_end;
+        header_parser       _header_parser;
+        
+        // Reads whatever `_buffer` has available without waiting for more,
+        // or waits for at least one byte if it has none; returns `false` if
+        // `_buffer` has ended
+        bool        _fill();
+        std::size_t _find_delimiter() const;
+        // Sets [`begin`, `end`) to the next run of segment content, or
+        // returns `false` and consumes the boundary if it's been reached
+        bool        _next_run( char*& begin, char*& end );
+        // Consumes the "--", CRLF, or LF following a boundary
+        void        _read_boundary_end();
+    
     public:
         class segment;
         class iterator;
@@ -35,11 +63,10 @@ namespace show // `show::multipart` class //////////////////////////////////////
         class segment : public std::streambuf
         {
             friend class iterator;
-            
+        
         protected:
             multipart*   _parent;
             headers_type _headers;
-            std::string  _buffer;
             bool         _finished;
             
             static const char ASCII_ACK { '\x06' };
@@ -49,12 +76,17 @@ namespace show // `show::multipart` class //////////////////////////////////////
             segment(   segment&& ) = default;
             
             segment& operator =( segment&& );
-            
+        
         public:
             segment( const segment& ) = delete;
             
             const headers_type& headers();
             
+            // Writes the rest of the segment's content to a file descriptor
+            // or a newly-created file, returning the number of bytes written
+            std::size_t spool_to     ( int                file_descriptor );
+            std::size_t spool_to_path( const std::string& path            );
+            
             // std::streambuf get functions
             virtual std::streamsize showmanyc();
             virtual int_type        underflow();
@@ -66,13 +98,13 @@ namespace show // `show::multipart` class //////////////////////////////////////
         class iterator
         {
             friend class multipart;
-            
+        
         public:
             using value_type        = segment;
             using pointer           = segment*;
             using reference         = segment&;
             using iterator_category = std::input_iterator_tag;
-            
+        
         protected:
             multipart*      _parent;
             bool            _is_end;
@@ -81,7 +113,7 @@ namespace show // `show::multipart` class //////////////////////////////////////
             segment         _current_segment;
             
             iterator( multipart&, bool end = false );
-            
+        
         public:
             iterator( iterator&& );
             
@@ -114,20 +146,6 @@ namespace show // Utilities ////////////////////////////////////////////////////
     {
         using request_parse_error::request_parse_error;
     };
-    
-    std::streambuf::int_type _read_buffer_until_boundary(
-        bool                       crlf_start,
-        std::streambuf           & buffer,
-        const std::string        & boundary,
-        std::streambuf::char_type* get_buffer,
-        std::function< void(
-            std::streambuf::char_type*,
-            std::streambuf::char_type*,
-            std::streambuf::char_type*
-        ) >                        setg_callback,
-        bool                     & segment_boundary_reached,
-        std::function< void() >    parent_finished_callback
-    );
 }
 
 
@@ -141,183 +159,51 @@ namespace show // `show::multipart::segment` implementation ////////////////////
     {}
     
     inline multipart::segment::segment( multipart& p ) :
-        _parent  { &p                            },
-        // \r (usually), \n, and two dashes followed by boundary then possibly
-        // two more dashes
-        _buffer  ( p.boundary().size() + 6, '\0' ),
-        _finished{ false                         }
+        _parent  { &p    },
+        _finished{ false }
     {
-        // Non-cost std::string::data() only available in C++17
-        setg(
-            const_cast< char* >( _buffer.data() ),
-            const_cast< char* >( _buffer.data() ),
-            const_cast< char* >( _buffer.data() )
-        );
-        
-        // This is basically a miniature version of show::request::request()'s
-        // parsing that only handles headers; possibly they can be combined into
-        // a single utility function
-        
-        bool reading                   { true  };
-        int  seq_newlines              { 0     };
-        bool in_endline_seq            { false };
-        bool check_for_multiline_header{ false };
-        std::string key_buffer, value_buffer;
+        // The get area always points into the parent's scan buffer
+        setg( nullptr, nullptr, nullptr );
         
-        enum {
-            READING_HEADER_NAME,
-            READING_HEADER_PADDING,
-            READING_HEADER_VALUE
-        } parse_state{ READING_HEADER_NAME };
+        // Headers are parsed the same way as a request's, with the block
+        // stored in the parent so its memory is reused for every segment
+        auto& parser = p._header_parser;
+        parser.reset();
         
-        while( reading )
+        auto status = header_parse_status::INCOMPLETE;
+        while( status == header_parse_status::INCOMPLETE )
         {
-            auto current_char = traits_type::to_char_type( sbumpc() );
-            
-            if( in_endline_seq )
-            {
-                if( current_char == '\n' )
-                    in_endline_seq = false;
-                else
-                    throw multipart_parse_error{
-                        "malformed HTTP line ending in multipart data"
-                    };
-            }
-            
-            if( current_char == '\n' )
-                ++seq_newlines;
-            else if( current_char == '\r' )
-            {
-                in_endline_seq = true;
-                continue;
-            }
-            else
-                seq_newlines = 0;
+            if(
+                gptr() >= egptr()
+                && traits_type::eq_int_type( underflow(), traits_type::eof() )
+            )
+                throw multipart_parse_error{
+                    "premature end of multipart data"
+                };
             
-            switch( parse_state )
-            {
-            case READING_HEADER_NAME:
-                {
-                    switch( current_char )
-                    {
-                    case ':':
-                        parse_state = READING_HEADER_PADDING;
-                        break;
-                    case '\n':
-                        if( key_buffer.size() < 1 )
-                        {
-                            reading = false;
-                            break;
-                        }
-                    default:
-                        if( !(
-                               ( current_char >= 'a' && current_char <= 'z' )
-                            || ( current_char >= 'A' && current_char <= 'Z' )
-                            || ( current_char >= '0' && current_char <= '9' )
-                            || current_char == '-'
-                        ) )
-                            throw multipart_parse_error{
-                                "malformed header in multipart data"
-                            };
-                        
-                        key_buffer += current_char;
-                        break;
-                    }
-                }
-                break;
-                
-            case READING_HEADER_PADDING:
-                if( current_char == ' ' || current_char == '\t' )
-                {
-                    parse_state = READING_HEADER_VALUE;
-                    break;
-                }
-                else if( current_char == '\n' )
-                    parse_state = READING_HEADER_VALUE;
-                else
-                    throw multipart_parse_error{
-                        "malformed header in multipart data"
-                    };
-                
-            case READING_HEADER_VALUE:
-                {
-                    switch( current_char )
-                    {
-                    case '\n':
-                        if( seq_newlines >= 2 )
-                        {
-                            if( check_for_multiline_header )
-                            {
-                                if( value_buffer.size() < 1 )
-                                    throw multipart_parse_error{
-                                        "missing header value in multipart data"
-                                    };
-                                _headers[ key_buffer ].push_back(
-                                    value_buffer
-                                );
-                            }
-                            reading = false;
-                        }
-                        else
-                            check_for_multiline_header = true;
-                        break;
-                    case ' ':
-                    case '\t':
-                        if( check_for_multiline_header )
-                            check_for_multiline_header = false;
-                        if(
-                            value_buffer.size() > 0
-                            && *value_buffer.rbegin() != ' '
-                        )
-                            value_buffer += ' ';
-                        break;
-                    default:
-                        if( check_for_multiline_header )
-                        {
-                            if( value_buffer.size() < 1 )
-                                throw multipart_parse_error{
-                                    "missing header value in multipart data"
-                                };
-                            
-                            _headers[ key_buffer ].push_back(
-                                value_buffer
-                            );
-                            
-                            // Start new key with current value
-                            key_buffer = current_char;
-                            value_buffer = "";
-                            check_for_multiline_header = false;
-                            
-                            parse_state = READING_HEADER_NAME;
-                        }
-                        else
-                        {
-                            value_buffer += current_char;
-                            check_for_multiline_header = false;
-                        }
-                        break;
-                    }
-                }
-                break;
-            }
+            std::size_t used;
+            status = parser.append( gptr(), egptr(), used );
+            gbump( static_cast< int >( used ) );
         }
+        
+        if( status == header_parse_status::SUCCESS )
+            status = parser.parse_fields();
+        if( status != header_parse_status::SUCCESS )
+            throw multipart_parse_error{
+                _header_parse_error_message( status )
+                + std::string{ " in multipart data" }
+            };
+        parser.copy_to( _headers );
     }
     
     inline multipart::segment& multipart::segment::operator =( segment&& o )
     {
         _parent   = o._parent;
-        _headers  = o._headers;
-        _buffer   = o._buffer;
+        _headers  = std::move( o._headers );
         _finished = o._finished;
         
-        // Can't do this with std::swap() because that's not guaranteed to swap
-        // the strings' internal buffers, e.g. with small-string optimization.
-        // Non-cost std::string::data() only available in C++17
-        setg(
-            const_cast< char* >( _buffer.data() ) + ( o.eback() - o._buffer.data() ),
-            const_cast< char* >( _buffer.data() ) + ( o.gptr () - o._buffer.data() ),
-            const_cast< char* >( _buffer.data() ) + ( o.egptr() - o._buffer.data() )
-        );
+        // The get area is in the parent's buffer, so can be shared as-is
+        setg( o.eback(), o.gptr(), o.egptr() );
         
         return *this;
     }
@@ -327,6 +213,78 @@ namespace show // `show::multipart::segment` implementation ////////////////////
         return _headers;
     }
     
+    inline std::size_t multipart::segment::spool_to( int file_descriptor )
+    {
+        std::size_t spooled{ 0 };
+        
+        // Each run is written straight from the parent's scan buffer, so the
+        // content is never copied again in user space
+        while(
+            gptr() < egptr()
+            || !traits_type::eq_int_type( underflow(), traits_type::eof() )
+        )
+        {
+            auto written = write(
+                file_descriptor,
+                gptr(),
+                static_cast< std::size_t >( egptr() - gptr() )
+            );
+            
+            if( written == -1 )
+            {
+                if( errno == EINTR )
+                    continue;
+                throw std::system_error{
+                    errno,
+                    std::generic_category(),
+                    "failure to spool multipart segment"
+                };
+            }
+            
+            gbump( static_cast< int >( written ) );
+            spooled += static_cast< std::size_t >( written );
+        }
+        
+        return spooled;
+    }
+    
+    inline std::size_t multipart::segment::spool_to_path(
+        const std::string& path
+    )
+    {
+        auto file_descriptor = open(
+            path.c_str(),
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0666
+        );
+        if( file_descriptor == -1 )
+            throw std::system_error{
+                errno,
+                std::generic_category(),
+                "failure to open \"" + path + "\" for multipart segment"
+            };
+        
+        std::size_t spooled;
+        try
+        {
+            spooled = spool_to( file_descriptor );
+        }
+        catch( ... )
+        {
+            close( file_descriptor );
+            throw;
+        }
+        
+        // Some filesystems only report write errors on close
+        if( close( file_descriptor ) == -1 )
+            throw std::system_error{
+                errno,
+                std::generic_category(),
+                "failure to spool multipart segment"
+            };
+        return spooled;
+    }
+    
     inline std::streamsize multipart::segment::showmanyc()
     {
         // No standard content length information, so this is only ever either
@@ -343,24 +301,17 @@ namespace show // `show::multipart::segment` implementation ////////////////////
         if( _finished )
             return traits_type::eof();
         
-        return _read_buffer_until_boundary(
-            true,
-            *( _parent -> _buffer ),
-            _parent -> boundary(),
-            // Non-cost std::string::data() only available in C++17
-            const_cast< char* >( _buffer.data() ),
-            [ this ](
-                char_type* gbeg,
-                char_type* gcurr,
-                char_type* gend
-            ){
-                this -> setg( gbeg, gcurr, gend );
-            },
-            _finished,
-            [ this ](){
-                this -> _parent -> _state = state::FINISHED;
-            }
-        );
+        char_type* run_begin;
+        char_type* run_end;
+        if( _parent -> _next_run( run_begin, run_end ) )
+        {
+            setg( run_begin, run_begin, run_end );
+            return traits_type::to_int_type( *gptr() );
+        }
+        
+        _finished = true;
+        setg( nullptr, nullptr, nullptr );
+        return traits_type::eof();
     }
     
     inline multipart::segment::int_type multipart::segment::pbackfail(
@@ -435,12 +386,16 @@ namespace show // `show::multipart::iterator` implementation ///////////////////
                 "can't increment show::multipart::iterator copy"
             };
         
-        // Flush to end of current segment
-        segment::int_type bumped;
-        do
+        // Flush to end of current segment, skipping whole runs at a time
+        while( !_current_segment._finished )
         {
-            bumped = _current_segment.sbumpc();
-        } while( segment::traits_type::not_eof( bumped ) == bumped );
+            _current_segment.setg(
+                _current_segment.egptr(),
+                _current_segment.egptr(),
+                _current_segment.egptr()
+            );
+            _current_segment.underflow();
+        }
         
         ++_segment_index;
         if( _parent -> _state == state::FINISHED )
@@ -489,44 +444,186 @@ namespace show // `show::multipart` implementation /////////////////////////////
         std::streambuf& b,
         String&& boundary
     ) :
-        _buffer  { &b                                 },
-        _boundary{ std::forward< String >( boundary ) },
-        _state   { state::READY                       }
+        _buffer     { &b                                 },
+        _boundary   { std::forward< String >( boundary ) },
+        _state      { state::READY                       },
+        _scan_begin { 0                                  },
+        _scan_end   { 0                                  }
     {
         if( _boundary.size() < 1 )
             throw std::invalid_argument{ "empty string as multipart boundary" };
         
-        std::streambuf::int_type got_c;
-        // \r (usually), \n, and two dashes followed by boundary then possibly
-        // two more dashes
-        std::string got_boundary( _boundary.size() + 6, '\0' );
-        bool end_of_pre_content{ false };
+        _delimiter = "\n--" + _boundary;
+        auto minimum_size = _delimiter.size() * 2 + 4;
+        _scan_buffer.resize(
+            minimum_size > SCAN_BLOCK_SIZE ? minimum_size : SCAN_BLOCK_SIZE
+        );
+        
+        for( auto& skip : _delimiter_skip )
+            skip = _delimiter.size();
+        for( std::size_t i = 0; i < _delimiter.size() - 1; ++i )
+            _delimiter_skip[
+                static_cast< unsigned char >( _delimiter[ i ] )
+            ] = _delimiter.size() - 1 - i;
+        
         // There will not be a (CR)LF before the first boundary if there is no
         // pre-boundary content to be ignored
-        bool         crlf_start{ false };
-        do
+        auto first_boundary = _delimiter.size() - 1;
+        while( _scan_end < first_boundary && _fill() );
+        if(
+            _scan_end >= first_boundary
+            && !std::memcmp(
+                _scan_buffer.data(),
+                _delimiter.data() + 1,
+                first_boundary
+            )
+        )
         {
-            got_c = _read_buffer_until_boundary(
-                crlf_start,
-                *_buffer,
-                _boundary,
-                // Non-cost std::string::data() only available in C++17
-                const_cast< char* >( got_boundary.data() ),
-                [](
-                    std::streambuf::char_type* gbeg,
-                    std::streambuf::char_type* gcurr,
-                    std::streambuf::char_type* gend
-                ){
-                    
-                },
-                end_of_pre_content,
-                [ this ](){
-                    this -> _state = state::FINISHED;
-                }
+            _scan_begin = first_boundary;
+            _read_boundary_end();
+        }
+        else
+        {
+            char* run_begin;
+            char* run_end;
+            while( _next_run( run_begin, run_end ) );
+        }
+    }
+    
+    inline bool multipart::_fill()
+    {
+        if( _scan_begin > 0 )
+        {
+            std::memmove(
+                _scan_buffer.data(),
+                _scan_buffer.data() + _scan_begin,
+                _scan_end - _scan_begin
             );
-            crlf_start = true;
+            _scan_end  -= _scan_begin;
+            _scan_begin = 0;
+        }
+        
+        auto next = _buffer -> sgetc();
+        if( std::streambuf::traits_type::not_eof( next ) != next )
+            return false;
+        
+        // Only take what's already buffered so reading never blocks waiting
+        // for content beyond what's needed
+        auto space = static_cast< std::streamsize >(
+            _scan_buffer.size() - _scan_end
+        );
+        auto available = _buffer -> in_avail();
+        if( available < 1 )
+            available = 1;
+        if( available > space )
+            available = space;
+        
+        auto read = _buffer -> sgetn(
+            _scan_buffer.data() + _scan_end,
+            available
+        );
+        if( read < 1 )
+            return false;
+        _scan_end += static_cast< std::size_t >( read );
+        return true;
+    }
+    
+    inline std::size_t multipart::_find_delimiter() const
+    {
+        auto last = _delimiter.size() - 1;
+        auto data = _scan_buffer.data();
+        
+        for( auto i = _scan_begin; i + last < _scan_end; )
+        {
+            auto c = data[ i + last ];
+            if(
+                c == _delimiter[ last ]
+                && !std::memcmp( data + i, _delimiter.data(), last )
+            )
+                return i;
+            i += _delimiter_skip[ static_cast< unsigned char >( c ) ];
         }
-        while( !end_of_pre_content );
+        
+        return std::string::npos;
+    }
+    
+    inline bool multipart::_next_run( char*& begin, char*& end )
+    {
+        while( true )
+        {
+            auto found = _find_delimiter();
+            std::size_t run_end;
+            
+            if( found != std::string::npos )
+            {
+                run_end = found;
+                if(
+                    run_end > _scan_begin
+                    && _scan_buffer[ run_end - 1 ] == '\r'
+                )
+                    --run_end;
+                
+                if( run_end == _scan_begin )
+                {
+                    _scan_begin = found + _delimiter.size();
+                    _read_boundary_end();
+                    return false;
+                }
+            }
+            else
+            {
+                // Hold back enough to complete a delimiter (and a preceding
+                // CR) that's split across reads
+                if( _scan_end - _scan_begin > _delimiter.size() )
+                    run_end = _scan_end - _delimiter.size();
+                else
+                    run_end = _scan_begin;
+                
+                if( run_end == _scan_begin )
+                {
+                    if( _fill() )
+                        continue;
+                    // No delimiter is coming, but whatever's left is still
+                    // content up until it's all been read
+                    else if( _scan_end == _scan_begin )
+                        throw multipart_parse_error{
+                            "premature end of multipart data"
+                        };
+                    run_end = _scan_end;
+                }
+            }
+            
+            begin = _scan_buffer.data() + _scan_begin;
+            end   = _scan_buffer.data() + run_end;
+            _scan_begin = run_end;
+            return true;
+        }
+    }
+    
+    inline void multipart::_read_boundary_end()
+    {
+        while( _scan_end - _scan_begin < 2 )
+            if( !_fill() )
+                throw multipart_parse_error{
+                    "premature end of multipart boundary"
+                };
+        
+        auto char_1 = _scan_buffer[ _scan_begin     ];
+        auto char_2 = _scan_buffer[ _scan_begin + 1 ];
+        
+        if( char_1 == '-' && char_2 == '-' )
+        {
+            _scan_begin += 2;
+            _state = state::FINISHED;
+        }
+        else if( char_1 == '\r' && char_2 == '\n' )
+            _scan_begin += 2;
+        else if( char_1 == '\n' )
+            _scan_begin += 1;
+        else
+            throw multipart_parse_error{
+                "malformed multipart boundary"
+            };
     }
     
     inline const std::streambuf& multipart::buffer()
@@ -563,110 +660,4 @@ namespace show // `show::multipart` implementation /////////////////////////////
 }
 
 
-namespace show // Utility functions implementation /////////////////////////////
-{
-    inline std::streambuf::int_type _read_buffer_until_boundary(
-        bool                       crlf_start,
-        std::streambuf           & buffer,
-        const std::string        & boundary,
-        std::streambuf::char_type* get_buffer,
-        std::function< void(
-            std::streambuf::char_type*,
-            std::streambuf::char_type*,
-            std::streambuf::char_type*
-        ) >                        setg_callback,
-        bool                     & segment_boundary_reached,
-        std::function< void() >    parent_finished_callback
-    )
-    {
-        std::string boundary_string;
-        if( crlf_start )
-            boundary_string = { "\r\n--" + boundary };
-        else
-            boundary_string = { "--" + boundary };
-        
-        std::streamsize read_count{ 0 };
-        
-        setg_callback(
-            get_buffer,
-            get_buffer,
-            get_buffer
-        );
-        
-        std::string::size_type next_boundary_char{ 0 };
-        do
-        {
-            auto got_i = buffer.sgetc();
-            
-            if( std::streambuf::traits_type::not_eof( got_i ) != got_i )
-                throw multipart_parse_error{
-                    "premature end of multipart data"
-                };
-            
-            auto got_c = std::streambuf::traits_type::to_char_type( got_i );
-            
-            if(
-                got_c == boundary_string[ next_boundary_char ]
-                || ( next_boundary_char == 0 && got_c == '\n' )
-                || read_count == 0
-            )
-            {
-                *( get_buffer + read_count ) = got_c;
-                ++read_count;
-                setg_callback(
-                    get_buffer,
-                    get_buffer,
-                    get_buffer + read_count
-                );
-                buffer.sbumpc();
-            }
-            
-            if( got_c == boundary_string[ next_boundary_char ] )
-                next_boundary_char += 1;
-            else if( next_boundary_char == 0 && got_c == '\n' )
-                next_boundary_char += 2;
-            else
-                return std::streambuf::traits_type::to_int_type(
-                    get_buffer[ 0 ]
-                );
-            
-        } while( next_boundary_char < boundary_string.size() );
-        
-        auto  int_1 = buffer.sbumpc();
-        auto  int_2 = buffer.sgetc ();
-        auto char_1 = std::streambuf::traits_type::to_char_type( int_1 );
-        auto char_2 = std::streambuf::traits_type::to_char_type( int_2 );
-        
-        if(
-               std::streambuf::traits_type::not_eof( int_1 ) != int_1
-            || std::streambuf::traits_type::not_eof( int_2 ) != int_2
-        )
-            throw multipart_parse_error{
-                "premature end of multipart boundary"
-            };
-        else if( char_1 == '-' && char_2 == '-' )
-        {
-            buffer.sbumpc();
-            parent_finished_callback();
-        }
-        else if( char_1 == '\r' && char_2 == '\n' )
-        {
-            buffer.sbumpc();
-        }
-        else if( char_1 != '\n' )
-            throw multipart_parse_error{
-                "malformed multipart boundary"
-            };
-        
-        segment_boundary_reached = true;
-        setg_callback(
-            get_buffer,
-            get_buffer,
-            get_buffer
-        );
-        return std::streambuf::traits_type::eof();
-    }
-}
-
-
 #endif
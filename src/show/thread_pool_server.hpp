@@ -0,0 +1,300 @@
+#pragma once
+#ifndef SHOW_THREAD_POOL_SERVER_HPP
+#define SHOW_THREAD_POOL_SERVER_HPP
+
+
+#include "../show.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>    // std::exception_ptr
+#include <functional>   // std::function<>
+#include <memory>       // std::unique_ptr<>
+#include <mutex>
+#include <stdexcept>    // std::invalid_argument
+#include <thread>
+#include <vector>
+
+#if defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace show // `show::thread_pool_server` class /////////////////////////////
+{
+    class thread_pool_server
+    {
+    public:
+        using handler_type = std::function< void( connection& ) >;
+    
+    protected:
+        // Workers wake up this often (in seconds) to check if they've been
+        // stopped
+        static const int STOP_CHECK_INTERVAL{ 1 };
+        // How long (in milliseconds) a worker waits to try again after
+        // failing to accept a connection, so a lasting failure such as
+        // running out of descriptors doesn't spin
+        enum : int { ACCEPT_RETRY_DELAY = 10 };
+        // Passed to `_work()` to leave a worker unpinned
+        enum : int { NO_CPU = -1 };
+        
+        handler_type               _handler;
+        int                        _timeout;
+        unsigned int               _port;
+        std::atomic_bool           _stopped;
+        std::atomic_size_t         _accept_errors;
+        std::vector< std::unique_ptr< server > > _servers;
+        std::vector< std::thread > _workers;
+        std::mutex                 _exception_mutex;
+        std::exception_ptr         _exception;
+        
+        void _work( server&, int cpu );
+    
+    public:
+        thread_pool_server(
+            const std::string& address,
+            unsigned int       port,
+            handler_type       handler,
+            unsigned int       thread_count = 0,
+            int                timeout      = 30
+        );
+        ~thread_pool_server();
+        
+        thread_pool_server( const thread_pool_server& ) = delete;
+        thread_pool_server& operator =( const thread_pool_server& ) = delete;
+        
+        void stop();
+        void join();
+        
+        const std::string& address     () const;
+        unsigned int       port        () const;
+        unsigned int       thread_count() const;
+        int                timeout     () const;
+        
+        // Number of times a worker has failed to accept a connection
+        std::size_t accept_errors() const;
+    };
+}
+
+
+namespace show // `show::thread_pool_server` implementation ////////////////////
+{
+    inline thread_pool_server::thread_pool_server(
+        const std::string& address,
+        unsigned int       port,
+        handler_type       handler,
+        unsigned int       thread_count,
+        int                timeout
+    ) :
+        _handler      { std::move( handler ) },
+        _timeout      { timeout              },
+        _port         { port                 },
+        _stopped      { false                },
+        _accept_errors{ 0                    }
+    {
+        // Each worker serves one connection at a time, so a connection that
+        // may wait forever for an idle client could block its worker forever
+        if( _timeout < 0 )
+            throw std::invalid_argument{
+                "thread pool server timeout must not be negative"
+            };
+        
+        // Only CPUs the process is allowed to run on (e.g. under `taskset`
+        // or a cgroup) are used
+        std::vector< int > cpus;
+#if defined( __linux__ )
+        cpu_set_t allowed;
+        CPU_ZERO( &allowed );
+        if( sched_getaffinity( 0, sizeof( allowed ), &allowed ) == 0 )
+            for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+                if( CPU_ISSET( cpu, &allowed ) )
+                    cpus.push_back( cpu );
+#endif
+
+        if( thread_count < 1 )
+            thread_count = static_cast< unsigned int >( cpus.size() );
+        if( thread_count < 1 )
+            thread_count = std::thread::hardware_concurrency();
+        if( thread_count < 1 )
+            thread_count = 1;
+        
+        // Each worker gets its own listen socket; `show::server` sets
+        // `SO_REUSEPORT` so these can all bind to the same port, and the
+        // kernel balances incoming connections across them.  All sockets are
+        // created before any thread starts so bind errors are thrown here.
+        // They share one buffer pool, which already keeps a separate cache
+        // per thread.
+        auto pool = std::make_shared< buffer_pool >();
+        for( unsigned int i = 0; i < thread_count; ++i )
+        {
+            _servers.emplace_back( std::unique_ptr< server >{ new server{
+                address,
+                _port,
+                STOP_CHECK_INTERVAL
+            } } );
+            _servers.back() -> buffer_pool( pool );
+            
+            // If asked for any free port, the rest must bind to the one the
+            // first was given
+            if( _port == 0 )
+            {
+                sockaddr_in6 bound_address;
+                socklen_t    bound_address_len = sizeof( bound_address );
+                if( getsockname(
+                    _servers.back() -> listen_socket -> descriptor,
+                    reinterpret_cast< sockaddr* >( &bound_address ),
+                    &bound_address_len
+                ) == -1 )
+                    throw socket_error{
+                        "could not get port information from socket: "
+                        + std::string{ std::strerror( errno ) }
+                    };
+                _port = ntohs( bound_address.sin6_port );
+            }
+        }
+        
+        try
+        {
+            for( unsigned int i = 0; i < thread_count; ++i )
+                _workers.emplace_back(
+                    &thread_pool_server::_work,
+                    this,
+                    std::ref( *_servers[ i ] ),
+                    cpus.empty() ? NO_CPU : cpus[ i % cpus.size() ]
+                );
+        }
+        catch( ... )
+        {
+            stop();
+            for( auto& worker : _workers )
+                worker.join();
+            throw;
+        }
+    }
+    
+    inline thread_pool_server::~thread_pool_server()
+    {
+        stop();
+        for( auto& worker : _workers )
+            if( worker.joinable() )
+                worker.join();
+    }
+    
+    inline void thread_pool_server::_work( server& s, int cpu )
+    {
+#if defined( __linux__ )
+        // Pinning is only an optimization, so failure is ignored
+        if( cpu != NO_CPU )
+        {
+            cpu_set_t cpu_set;
+            CPU_ZERO( &cpu_set );
+            CPU_SET( cpu, &cpu_set );
+            pthread_setaffinity_np(
+                pthread_self(),
+                sizeof( cpu_set ),
+                &cpu_set
+            );
+        }
+#endif
+
+        std::vector< connection > accepted;
+        while( !_stopped )
+        {
+            try
+            {
+                // The accept wait times out regularly so the worker can
+                // check if it's been stopped, which shouldn't cost an
+                // exception each time
+                if( s.try_serve( accepted ) != io_status::SUCCESS )
+                    continue;
+            }
+            catch( const socket_error& se )
+            {
+                // Only this attempt failed; the connection is either still
+                // waiting or gone, & neither should stop the worker
+                ++_accept_errors;
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds{ ACCEPT_RETRY_DELAY }
+                );
+                continue;
+            }
+            
+            auto c = std::move( accepted.back() );
+            accepted.clear();
+            
+            try
+            {
+                c.timeout( _timeout );
+                _handler( c );
+            }
+            catch( const connection_interrupted& ci )
+            {
+                // The handler let a single client's interruption through,
+                // which doesn't stop the worker
+            }
+            catch( const socket_error& se )
+            {
+                // Likewise for a failure on a single client's connection,
+                // such as it being reset mid-response
+            }
+            catch( ... )
+            {
+                {
+                    std::lock_guard< std::mutex > lock{ _exception_mutex };
+                    if( !_exception )
+                        _exception = std::current_exception();
+                }
+                stop();
+            }
+        }
+    }
+    
+    inline void thread_pool_server::stop()
+    {
+        _stopped = true;
+    }
+    
+    inline void thread_pool_server::join()
+    {
+        for( auto& worker : _workers )
+            if( worker.joinable() )
+                worker.join();
+        
+        std::lock_guard< std::mutex > lock{ _exception_mutex };
+        if( _exception )
+        {
+            auto e = _exception;
+            _exception = nullptr;
+            std::rethrow_exception( e );
+        }
+    }
+    
+    inline const std::string& thread_pool_server::address() const
+    {
+        return _servers[ 0 ] -> address();
+    }
+    
+    inline unsigned int thread_pool_server::port() const
+    {
+        return _port;
+    }
+    
+    inline unsigned int thread_pool_server::thread_count() const
+    {
+        return static_cast< unsigned int >( _workers.size() );
+    }
+    
+    inline int thread_pool_server::timeout() const
+    {
+        return _timeout;
+    }
+    
+    inline std::size_t thread_pool_server::accept_errors() const
+    {
+        return _accept_errors;
+    }
+}
+
+
+#endif
@@ -0,0 +1,318 @@
+#pragma once
+#ifndef SHOW_TIMER_WHEEL_HPP
+#define SHOW_TIMER_WHEEL_HPP
+
+
+#include "../show.hpp"
+
+#include <array>
+#include <cstdint>      // std::uint32_t, std::uint64_t
+#include <vector>
+
+
+namespace show // `show::timer_wheel` class ////////////////////////////////////
+{
+    // A hierarchical timing wheel holding at most one timer per key, where
+    // keys are small dense integers such as socket descriptors.  Times are in
+    // whole ticks (e.g. milliseconds) from whatever epoch the caller likes.
+    // Scheduling, cancelling, and expiring a timer are all O(1); timers far
+    // in the future sit in coarser wheels and are moved down to finer ones as
+    // their time approaches.
+    class timer_wheel
+    {
+    public:
+        using key_type  = std::size_t;
+        using time_type = std::uint64_t;
+        
+        timer_wheel( time_type now = 0 );
+        
+        // Replaces any timer already scheduled for `key`; deadlines that have
+        // already passed expire on the next `advance()`
+        void schedule( key_type key, time_type deadline );
+        void cancel  ( key_type key );
+        
+        bool        scheduled( key_type key ) const;
+        time_type   deadline ( key_type key ) const;
+        time_type   now      () const { return _now;   }
+        std::size_t size     () const { return _count; }
+        bool        empty    () const { return _count == 0; }
+        
+        // Moves time forward to `now`, calling `expire( key )` for every timer
+        // whose deadline has been reached, in deadline order; `expire` may
+        // schedule & cancel timers.  Returns the number that expired.
+        template< typename Function > std::size_t advance(
+            time_type now,
+            Function  expire
+        );
+        
+        // How many ticks the caller can wait before calling `advance()`
+        // without falling behind, or -1 if no timers are scheduled.  This can
+        // be earlier than the next deadline, as timers in the coarser wheels
+        // need to be moved down on time.
+        std::int64_t next_advance() const;
+    
+    protected:
+        static const unsigned int SLOT_BITS{ 6 };
+        static const unsigned int SLOTS    { 1 << SLOT_BITS };
+        static const unsigned int LEVELS   { 6 };
+        
+        enum : std::uint32_t { NO_NODE = 0xFFFFFFFF };
+        
+        struct _node
+        {
+            time_type     deadline;
+            std::uint32_t slot;         // `NO_NODE` if not scheduled
+            std::uint32_t previous;
+            std::uint32_t next;
+        };
+        
+        time_type                                   _now;
+        std::size_t                                 _count;
+        std::vector< _node >                        _nodes;
+        std::array< std::uint32_t, LEVELS * SLOTS > _slots;
+        // Number of timers in each wheel
+        std::array< std::size_t, LEVELS >           _level_counts;
+        
+        // Low bits of a time that must be zero for the wheel at `level` to
+        // have reached the next of its slots
+        static time_type     _level_mask( unsigned int level );
+        static std::uint32_t _slot_index( unsigned int level, time_type t );
+        
+        void _insert( std::uint32_t key );
+        void _remove( std::uint32_t key );
+        // Whether reaching `t` moves any timers down from a coarser wheel
+        bool _cascades( time_type t ) const;
+        // Moves every timer in a coarse slot down to the finer wheels
+        void _cascade( unsigned int level );
+    };
+}
+
+
+namespace show // `show::timer_wheel` implementation ///////////////////////////
+{
+    inline timer_wheel::timer_wheel( time_type now ) :
+        _now  { now },
+        _count{ 0   }
+    {
+        _slots.fill( NO_NODE );
+        _level_counts.fill( 0 );
+    }
+    
+    inline void timer_wheel::schedule( key_type key, time_type deadline )
+    {
+        if( key >= NO_NODE )
+            throw std::out_of_range{ "show::timer_wheel key too large" };
+        if( key >= _nodes.size() )
+        {
+            _node unscheduled;
+            unscheduled.slot = NO_NODE;
+            _nodes.resize( key + 1, unscheduled );
+        }
+        
+        auto k = static_cast< std::uint32_t >( key );
+        if( _nodes[ k ].slot != NO_NODE )
+            _remove( k );
+        else
+            ++_count;
+        
+        // The slot for the current tick has already been expired
+        _nodes[ k ].deadline = deadline > _now ? deadline : _now + 1;
+        _insert( k );
+    }
+    
+    inline void timer_wheel::cancel( key_type key )
+    {
+        if( scheduled( key ) )
+        {
+            _remove( static_cast< std::uint32_t >( key ) );
+            --_count;
+        }
+    }
+    
+    inline bool timer_wheel::scheduled( key_type key ) const
+    {
+        return key < _nodes.size() && _nodes[ key ].slot != NO_NODE;
+    }
+    
+    inline timer_wheel::time_type timer_wheel::deadline( key_type key ) const
+    {
+        if( !scheduled( key ) )
+            throw std::out_of_range{ "no timer scheduled for key" };
+        return _nodes[ key ].deadline;
+    }
+    
+    template< typename Function > std::size_t timer_wheel::advance(
+        time_type now,
+        Function  expire
+    )
+    {
+        std::size_t expired{ 0 };
+        
+        while( _now < now )
+        {
+            if( _count == 0 )
+            {
+                _now = now;
+                break;
+            }
+            
+            // Nothing can happen until the finest wheel holding any timers
+            // moves on to its next slot, so skip straight to that
+            unsigned int level{ 0 };
+            while( _level_counts[ level ] == 0 )
+                ++level;
+            if( level > 0 )
+            {
+                auto last_before_wrap = _now | _level_mask( level );
+                if( last_before_wrap >= now )
+                {
+                    _now = now;
+                    break;
+                }
+                _now = last_before_wrap;
+            }
+            
+            ++_now;
+            
+            // Each time a finer wheel wraps around, the next slot of the
+            // coarser one comes within its range
+            for(
+                unsigned int level = 1;
+                level < LEVELS && ( _now & _level_mask( level ) ) == 0;
+                ++level
+            )
+                _cascade( level );
+            
+            // Taken one at a time, as `expire()` may change the wheel
+            auto& slot = _slots[ _now % SLOTS ];
+            while( slot != NO_NODE )
+            {
+                auto key = slot;
+                _remove( key );
+                --_count;
+                ++expired;
+                expire( static_cast< key_type >( key ) );
+            }
+        }
+        
+        return expired;
+    }
+    
+    inline std::int64_t timer_wheel::next_advance() const
+    {
+        if( _count == 0 )
+            return -1;
+        
+        // Anything in the finest wheel is due within one full rotation of it,
+        // which may wrap past where a coarser wheel moves timers down
+        auto tick = _now;
+        do
+        {
+            ++tick;
+            if( _slots[ tick % SLOTS ] != NO_NODE || _cascades( tick ) )
+                return static_cast< std::int64_t >( tick - _now );
+        } while( tick - _now < SLOTS );
+        
+        // After that, a timer can only become due once it's moved down from
+        // a coarser wheel, so look for the first time that happens
+        for(
+            tick = ( tick | _level_mask( 1 ) ) + 1;
+            tick - _now < SLOTS * SLOTS;
+            tick += SLOTS
+        )
+            if( _cascades( tick ) )
+                return static_cast< std::int64_t >( tick - _now );
+        
+        return static_cast< std::int64_t >( tick - _now );
+    }
+    
+    inline timer_wheel::time_type timer_wheel::_level_mask(
+        unsigned int level
+    )
+    {
+        return ( time_type{ 1 } << ( level * SLOT_BITS ) ) - 1;
+    }
+    
+    inline bool timer_wheel::_cascades( time_type t ) const
+    {
+        for(
+            unsigned int level = 1;
+            level < LEVELS && ( t & _level_mask( level ) ) == 0;
+            ++level
+        )
+            if( _slots[ _slot_index( level, t ) ] != NO_NODE )
+                return true;
+        return false;
+    }
+    
+    inline std::uint32_t timer_wheel::_slot_index(
+        unsigned int level,
+        time_type    t
+    )
+    {
+        return static_cast< std::uint32_t >(
+            level * SLOTS + ( ( t >> ( level * SLOT_BITS ) ) % SLOTS )
+        );
+    }
+    
+    inline void timer_wheel::_insert( std::uint32_t key )
+    {
+        auto& node  = _nodes[ key ];
+        auto  delta = node.deadline - _now;
+        
+        // The finest wheel whose range reaches the deadline; anything past
+        // the coarsest wheel's range waits in its furthest slot
+        unsigned int level{ 0 };
+        while(
+            level < LEVELS - 1
+            && delta >= ( time_type{ 1 } << ( ( level + 1 ) * SLOT_BITS ) )
+        )
+            ++level;
+        
+        auto deadline = node.deadline;
+        if(
+            level == LEVELS - 1
+            && delta >= ( time_type{ 1 } << ( LEVELS * SLOT_BITS ) )
+        )
+            deadline = _now + (
+                ( time_type{ 1 } << ( LEVELS * SLOT_BITS ) ) - 1
+            );
+        
+        auto slot = _slot_index( level, deadline );
+        
+        ++_level_counts[ level ];
+        node.slot     = slot;
+        node.previous = NO_NODE;
+        node.next     = _slots[ slot ];
+        if( node.next != NO_NODE )
+            _nodes[ node.next ].previous = key;
+        _slots[ slot ] = key;
+    }
+    
+    inline void timer_wheel::_remove( std::uint32_t key )
+    {
+        auto& node = _nodes[ key ];
+        if( node.previous != NO_NODE )
+            _nodes[ node.previous ].next = node.next;
+        else
+            _slots[ node.slot ] = node.next;
+        if( node.next != NO_NODE )
+            _nodes[ node.next ].previous = node.previous;
+        --_level_counts[ node.slot / SLOTS ];
+        node.slot = NO_NODE;
+    }
+    
+    inline void timer_wheel::_cascade( unsigned int level )
+    {
+        auto& slot = _slots[ _slot_index( level, _now ) ];
+        while( slot != NO_NODE )
+        {
+            auto key = slot;
+            _remove( key );
+            _insert( key );
+        }
+    }
+}
+
+
+#endif
@@ -1,7 +1,14 @@
 #include "UnitTest++_wrap.hpp"
 #include <show/base64.hpp>
 
+#include <algorithm>  // std::min()
+#include <istream>
+#include <iterator>   // std::istreambuf_iterator<>
+#include <ostream>
+#include <sstream>    // std::stringbuf
 #include <string>
+#include <utility>    // std::pair<>
+#include <vector>
 
 #include "constants.hpp"
 
@@ -58,6 +65,116 @@ namespace
         '\xdf',
         '\xbf'
     };
+    
+    // Bit-at-a-time reference encoder for checking the optimized ones
+    std::string reference_base64_encode(
+        const std::string& o,
+        const char* chars
+    )
+    {
+        std::string encoded;
+        unsigned int bits{ 0 };
+        int bit_count{ 0 };
+        for( auto c : o )
+        {
+            bits = ( bits << 8 ) | static_cast< unsigned char >( c );
+            bit_count += 8;
+            while( bit_count >= 6 )
+            {
+                bit_count -= 6;
+                encoded += chars[ ( bits >> bit_count ) & 0x3F ];
+            }
+        }
+        if( bit_count > 0 )
+            encoded += chars[ ( bits << ( 6 - bit_count ) ) & 0x3F ];
+        while( encoded.size() % 4 )
+            encoded += '=';
+        return encoded;
+    }
+    
+    // Deterministic pseudo-random bytes
+    std::string test_bytes( std::size_t size )
+    {
+        std::string bytes;
+        unsigned int state{ static_cast< unsigned int >( size ) + 1 };
+        for( std::size_t i = 0; i < size; ++i )
+        {
+            state = state * 1103515245 + 12345;
+            bytes += static_cast< char >( state >> 16 );
+        }
+        return bytes;
+    }
+    
+    void check_decode_error(
+        const std::string& encoded,
+        const std::string& message
+    )
+    {
+        try
+        {
+            show::base64_decode( encoded );
+            CHECK( false );
+        }
+        catch( const show::base64_decode_error& e )
+        {
+            CHECK_EQUAL( message, e.what() );
+        }
+    }
+    
+    // Writes `o` through a `show::base64_encode_buf` in chunks of varying size
+    // so writes straddle its block boundaries
+    std::string stream_encode( const std::string& o, const char* chars )
+    {
+        std::stringbuf sink;
+        {
+            show::base64_encode_buf encoder{ sink, chars };
+            std::ostream encoder_stream{ &encoder };
+            std::size_t written{ 0 };
+            std::size_t chunk  { 1 };
+            while( written < o.size() )
+            {
+                auto size = std::min( chunk, o.size() - written );
+                encoder_stream.write(
+                    o.data() + written,
+                    static_cast< std::streamsize >( size )
+                );
+                written += size;
+                chunk    = chunk * 7 % 4099;
+            }
+            CHECK( encoder.finish() );
+        }
+        return sink.str();
+    }
+    
+    std::string stream_decode(
+        const std::string& encoded,
+        const char*        chars = show::base64_chars_standard,
+        show::base64_flags flags = 0x00
+    )
+    {
+        std::stringbuf source{ encoded };
+        show::base64_decode_buf decoder{ source, chars, flags };
+        return std::string{
+            std::istreambuf_iterator< char >{ &decoder },
+            std::istreambuf_iterator< char >{}
+        };
+    }
+    
+    void check_stream_decode_error(
+        const std::string& encoded,
+        const std::string& message
+    )
+    {
+        try
+        {
+            stream_decode( encoded );
+            CHECK( false );
+        }
+        catch( const show::base64_decode_error& e )
+        {
+            CHECK_EQUAL( message, e.what() );
+        }
+    }
 }
 
 
@@ -390,4 +507,230 @@ SUITE( ShowBase64Tests )
             show::base64_decode( "AA==" )
         );
     }
+    
+    TEST( EncodeDecodeEveryLength )
+    {
+        for( auto chars : {
+            show::base64_chars_standard,
+            show::base64_chars_urlsafe
+        } )
+            for( std::size_t size = 0; size < 200; ++size )
+            {
+                auto bytes   = test_bytes( size );
+                auto encoded = show::base64_encode( bytes, chars );
+                CHECK_EQUAL( reference_base64_encode( bytes, chars ), encoded );
+                CHECK_EQUAL( bytes, show::base64_decode( encoded, chars ) );
+            }
+    }
+    
+    TEST( EncodeDecodeCustomDictionary )
+    {
+        const char* reversed{
+            "/+9876543210zyxwvutsrqponmlkjihgfedcbaZYXWVUTSRQPONMLKJIHGFEDCBA"
+        };
+        auto bytes   = test_bytes( 100 );
+        auto encoded = show::base64_encode( bytes, reversed );
+        CHECK_EQUAL( reference_base64_encode( bytes, reversed ), encoded );
+        CHECK_EQUAL( bytes, show::base64_decode( encoded, reversed ) );
+    }
+    
+    TEST( ScalarImplementation )
+    {
+        for( auto chars : {
+            show::base64_chars_standard,
+            show::base64_chars_urlsafe
+        } )
+            for( std::size_t size = 0; size < 100; ++size )
+            {
+                auto bytes   = test_bytes( size );
+                auto encoded = show::_base64_encode( bytes, chars, nullptr );
+                CHECK_EQUAL( reference_base64_encode( bytes, chars ), encoded );
+                CHECK_EQUAL(
+                    bytes,
+                    show::_base64_decode( encoded, chars, 0x00, nullptr )
+                );
+            }
+    }
+    
+    TEST( SIMDImplementationsAgree )
+    {
+        using function_type = show::_base64_simd_function;
+        std::vector< std::pair< function_type, function_type > > codecs;
+#if defined( SHOW_X86_SIMD )
+        __builtin_cpu_init();
+        if( __builtin_cpu_supports( "ssse3" ) )
+            codecs.push_back( {
+                &show::_base64_encode_ssse3,
+                &show::_base64_decode_ssse3
+            } );
+        if( __builtin_cpu_supports( "avx2" ) )
+            codecs.push_back( {
+                &show::_base64_encode_avx2,
+                &show::_base64_decode_avx2
+            } );
+#endif
+
+        for( auto& codec : codecs )
+            for( auto chars : {
+                show::base64_chars_standard,
+                show::base64_chars_urlsafe
+            } )
+                for( std::size_t size = 0; size < 200; ++size )
+                {
+                    auto bytes    = test_bytes( size );
+                    auto expected = reference_base64_encode( bytes, chars );
+                    
+                    std::string encoded( expected.size(), '\0' );
+                    auto consumed = codec.first(
+                        bytes.data(),
+                        bytes.size(),
+                        &encoded[ 0 ],
+                        chars[ 62 ],
+                        chars[ 63 ]
+                    );
+                    CHECK_EQUAL( 0, consumed % 3 );
+                    CHECK_EQUAL(
+                        expected.substr( 0, consumed / 3 * 4 ),
+                        encoded.substr( 0, consumed / 3 * 4 )
+                    );
+                    
+                    std::string decoded( size + 8, '\0' );
+                    consumed = codec.second(
+                        expected.data(),
+                        expected.size(),
+                        &decoded[ 0 ],
+                        chars[ 62 ],
+                        chars[ 63 ]
+                    );
+                    CHECK_EQUAL( 0, consumed % 4 );
+                    CHECK_EQUAL(
+                        bytes.substr( 0, consumed / 4 * 3 ),
+                        decoded.substr( 0, consumed / 4 * 3 )
+                    );
+                }
+    }
+    
+    TEST( DecodeFailNotInDictionaryLongString )
+    {
+        auto encoded = show::base64_encode( test_bytes( 120 ) );
+        for( std::size_t i : { 0, 15, 31, 47, 70, 158 } )
+        {
+            auto invalid = encoded;
+            invalid[ i ] = '$';
+            check_decode_error( invalid, "invalid base64 character" );
+            invalid[ i ] = '\x80';
+            check_decode_error( invalid, "invalid base64 character" );
+            invalid[ i ] = '-';
+            check_decode_error( invalid, "invalid base64 character" );
+            invalid[ i ] = '=';
+            check_decode_error( invalid, "premature padding" );
+        }
+    }
+    
+    TEST( DecodeFailFirstErrorReported )
+    {
+        auto encoded = show::base64_encode( test_bytes( 120 ) );
+        encoded[ 40 ] = '=';
+        encoded[ 80 ] = '$';
+        check_decode_error( encoded, "premature padding" );
+        encoded[ 20 ] = '$';
+        check_decode_error( encoded, "invalid base64 character" );
+    }
+    
+    TEST( StreamEncodeDecodeMultipleBlocks )
+    {
+        for( std::size_t size : {
+            0, 1, 2, 3, 4, 3071, 3072, 3073, 4095, 4096, 4097, 20000
+        } )
+        {
+            auto bytes   = test_bytes( size );
+            auto encoded = show::base64_encode( bytes );
+            CHECK_EQUAL(
+                encoded,
+                stream_encode( bytes, show::base64_chars_standard )
+            );
+            CHECK( stream_decode( encoded ) == bytes );
+        }
+    }
+    
+    TEST( StreamEncodeDecodeURLSafe )
+    {
+        auto bytes   = test_bytes( 10000 );
+        auto encoded = show::base64_encode( bytes, show::base64_chars_urlsafe );
+        CHECK_EQUAL(
+            encoded,
+            stream_encode( bytes, show::base64_chars_urlsafe )
+        );
+        CHECK(
+            stream_decode( encoded, show::base64_chars_urlsafe ) == bytes
+        );
+    }
+    
+    TEST( StreamEncodeFinishOnDestruction )
+    {
+        std::stringbuf sink;
+        {
+            show::base64_encode_buf encoder{ sink };
+            std::ostream encoder_stream{ &encoder };
+            encoder_stream << "12345";
+        }
+        CHECK_EQUAL( "MTIzNDU=", sink.str() );
+    }
+    
+    TEST( StreamEncodeNothingAfterFinish )
+    {
+        std::stringbuf sink;
+        show::base64_encode_buf encoder{ sink };
+        std::ostream encoder_stream{ &encoder };
+        encoder_stream << "123";
+        CHECK( encoder.finish() );
+        CHECK( encoder.finish() );
+        encoder_stream << "456";
+        CHECK( !encoder_stream );
+        CHECK_EQUAL( "MTIz", sink.str() );
+    }
+    
+    TEST( StreamDecodeIgnorePadding )
+    {
+        auto bytes   = test_bytes( 5000 );
+        auto encoded = show::base64_encode( bytes );
+        CHECK_EQUAL( '=', encoded.back() );
+        while( encoded.back() == '=' )
+            encoded.pop_back();
+        CHECK(
+            stream_decode(
+                encoded,
+                show::base64_chars_standard,
+                show::base64_ignore_padding
+            ) == bytes
+        );
+    }
+    
+    TEST( StreamDecodeFailMissingPadding )
+    {
+        auto encoded = show::base64_encode( test_bytes( 5000 ) );
+        encoded.pop_back();
+        check_stream_decode_error( encoded, "missing required padding" );
+    }
+    
+    TEST( StreamDecodeFailPrematurePaddingLaterBlock )
+    {
+        auto encoded = show::base64_encode( test_bytes( 9000 ) );
+        // Padding at the very end of the first block is only found to be
+        // premature once the next one is read
+        encoded[ 4095 ] = '=';
+        check_stream_decode_error( encoded, "premature padding" );
+        encoded[ 4095 ] = 'A';
+        encoded[ 9000 ] = '=';
+        check_stream_decode_error( encoded, "premature padding" );
+    }
+    
+    TEST( StreamDecodeFailNotInDictionaryLaterBlock )
+    {
+        auto encoded = show::base64_encode( test_bytes( 9000 ) );
+        encoded[ 9000 ] = '$';
+        check_stream_decode_error( encoded, "invalid base64 character" );
+        encoded[ 100 ] = '=';
+        check_stream_decode_error( encoded, "premature padding" );
+    }
 }
@@ -0,0 +1,262 @@
+#include "UnitTest++_wrap.hpp"
+#include <show.hpp>
+
+#include "async_utils.hpp"
+
+#include <condition_variable>
+#include <memory>       // std::shared_ptr, std::make_shared()
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+SUITE( ShowBufferPoolTests )
+{
+    TEST( MissThenHit )
+    {
+        show::buffer_pool test_pool;
+        
+        {
+            auto b = test_pool.acquire( 1024 );
+            CHECK( b );
+            CHECK_EQUAL( 1024, b.get_deleter().size() );
+            
+            auto stats = test_pool.stats();
+            CHECK_EQUAL( 0, stats.hits   );
+            CHECK_EQUAL( 1, stats.misses );
+            CHECK_EQUAL( 1, stats.in_use );
+        }
+        
+        {
+            auto b = test_pool.acquire( 1024 );
+            auto stats = test_pool.stats();
+            CHECK_EQUAL( 1, stats.hits   );
+            CHECK_EQUAL( 1, stats.misses );
+            CHECK_EQUAL( 1, stats.in_use );
+        }
+        
+        CHECK_EQUAL( 0, test_pool.stats().in_use );
+    }
+    
+    TEST( ReuseSameBuffer )
+    {
+        show::buffer_pool test_pool;
+        
+        const char* address;
+        {
+            auto b = test_pool.acquire( 64 );
+            address = b.get();
+        }
+        auto b = test_pool.acquire( 64 );
+        CHECK_EQUAL(
+            static_cast< const void* >( address ),
+            static_cast< const void* >( b.get() )
+        );
+    }
+    
+    TEST( SeparateSizes )
+    {
+        show::buffer_pool test_pool;
+        
+        {
+            auto b = test_pool.acquire( 512 );
+        }
+        auto b = test_pool.acquire( 4096 );
+        
+        auto stats = test_pool.stats();
+        CHECK_EQUAL( 0, stats.hits   );
+        CHECK_EQUAL( 2, stats.misses );
+    }
+    
+    TEST( PeakInUse )
+    {
+        show::buffer_pool test_pool;
+        
+        {
+            std::vector< show::buffer_pool::buffer > buffers;
+            for( int i = 0; i < 5; ++i )
+                buffers.push_back( test_pool.acquire( 128 ) );
+        }
+        auto b = test_pool.acquire( 128 );
+        
+        auto stats = test_pool.stats();
+        CHECK_EQUAL( 1, stats.in_use      );
+        CHECK_EQUAL( 5, stats.peak_in_use );
+    }
+    
+    TEST( ThreadCacheOverflowsToGlobal )
+    {
+        // No per-thread caching, so everything goes through the shared list
+        show::buffer_pool test_pool{ 0 };
+        
+        std::thread{ [ &test_pool ](){
+            auto b = test_pool.acquire( 256 );
+        } }.join();
+        
+        auto b = test_pool.acquire( 256 );
+        CHECK_EQUAL( 1, test_pool.stats().hits );
+    }
+    
+    TEST( ThreadCacheReturnedOnThreadExit )
+    {
+        show::buffer_pool test_pool;
+        
+        std::thread{ [ &test_pool ](){
+            auto b = test_pool.acquire( 256 );
+        } }.join();
+        
+        // The other thread's cache was handed back to the pool when it exited
+        auto b = test_pool.acquire( 256 );
+        CHECK_EQUAL( 1, test_pool.stats().hits );
+    }
+    
+    TEST( DestroyPoolBeforeThreadExit )
+    {
+        std::unique_ptr< show::buffer_pool > test_pool{
+            new show::buffer_pool{}
+        };
+        
+        bool released{ false };
+        bool destroyed{ false };
+        std::mutex m;
+        std::condition_variable cv;
+        
+        std::thread other_thread{ [ & ](){
+            {
+                auto b = test_pool -> acquire( 256 );
+            }
+            std::unique_lock< std::mutex > lock{ m };
+            released = true;
+            cv.notify_all();
+            cv.wait( lock, [ & ](){ return destroyed; } );
+            // Exiting the thread now frees its cache without touching the
+            // destroyed pool
+        } };
+        
+        {
+            std::unique_lock< std::mutex > lock{ m };
+            cv.wait( lock, [ & ](){ return released; } );
+            test_pool.reset();
+            destroyed = true;
+            cv.notify_all();
+        }
+        
+        other_thread.join();
+    }
+    
+    TEST( FreeStaleCachesOnNewPool )
+    {
+        // Exposes the calling thread's caches
+        struct inspect_pool : show::buffer_pool
+        {
+            static std::size_t cache_count()
+            {
+                return _local_caches().size();
+            }
+        };
+        
+        std::unique_ptr< show::buffer_pool > old_pool{
+            new show::buffer_pool{}
+        };
+        {
+            auto b = old_pool -> acquire( 256 );
+        }
+        auto caches = inspect_pool::cache_count();
+        
+        // Destroying the pool on another thread leaves this thread's cache
+        // for it behind, until this thread starts using another pool
+        std::thread{ [ &old_pool ](){ old_pool.reset(); } }.join();
+        CHECK_EQUAL( caches, inspect_pool::cache_count() );
+        
+        show::buffer_pool new_pool;
+        {
+            auto b = new_pool.acquire( 256 );
+        }
+        CHECK_EQUAL( caches, inspect_pool::cache_count() );
+        CHECK_EQUAL( 1, new_pool.stats().misses );
+    }
+    
+    TEST( ServerDefaultPool )
+    {
+        show::server test_server{ "::", 9090 };
+        CHECK( test_server.buffer_pool() );
+    }
+    
+    TEST( ConnectionsUseServerPool )
+    {
+        auto test_pool = std::make_shared< show::buffer_pool >();
+        
+        show::server test_server{ "::", 9090, 2 };
+        test_server.buffer_pool( test_pool );
+        CHECK( test_pool == test_server.buffer_pool() );
+        
+        for( int i = 0; i < 2; ++i )
+        {
+            auto request_thread = send_request_async(
+                "::",
+                9090,
+                []( show::socket_fd request_socket ){
+                    write_to_socket(
+                        request_socket,
+                        "GET / HTTP/1.0\r\n"
+                        "\r\n"
+                    );
+                }
+            );
+            
+            try
+            {
+                auto test_connection = test_server.serve();
+                show::request test_request{ test_connection };
+                
+                // Only the read buffer, as the write buffer is allocated lazily
+                CHECK_EQUAL( 1, test_pool -> stats().in_use );
+            }
+            catch( ... )
+            {
+                request_thread.join();
+                throw;
+            }
+            
+            request_thread.join();
+        }
+        
+        auto stats = test_pool -> stats();
+        CHECK_EQUAL( 0, stats.in_use );
+        CHECK_EQUAL( 1, stats.hits   );
+        CHECK_EQUAL( 1, stats.misses );
+    }
+    
+    TEST( ConnectionsWithoutPool )
+    {
+        show::server test_server{ "::", 9090, 2 };
+        test_server.buffer_pool( nullptr );
+        
+        auto request_thread = send_request_async(
+            "::",
+            9090,
+            []( show::socket_fd request_socket ){
+                write_to_socket(
+                    request_socket,
+                    "GET / HTTP/1.0\r\n"
+                    "\r\n"
+                );
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            show::request test_request{ test_connection };
+            CHECK_EQUAL( "GET", test_request.method() );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+}
@@ -1,6 +1,8 @@
 #include "UnitTest++_wrap.hpp"
 #include <show.hpp>
 
+#include "async_utils.hpp"
+
 #include <curl/curl.h>
 
 #include <chrono>
@@ -9,6 +11,9 @@
 #include <memory>       // std::unique_ptr
 #include <string>
 #include <thread>
+#include <vector>
+
+#include <unistd.h>     // read()
 
 
 namespace
@@ -265,6 +270,56 @@ SUITE( ShowConnectionTests )
         test_thread.join();
     }
     
+    TEST( SetIndependentBufferSize )
+    {
+        show::server test_server{ "::", 9090, 0 };
+        test_server.buffer_size( 512 );
+        
+        std::thread test_thread{ []{
+            auto curl = curl_easy_init();
+            REQUIRE CHECK( curl );
+            curl_easy_setopt(
+                curl,
+                CURLOPT_URL,
+                "http://0.0.0.0:9090/"
+            );
+            curl_easy_perform( curl );
+            curl_easy_cleanup( curl );
+        } };
+        
+        // Wait for cURL thread to send request
+        std::this_thread::sleep_for( std::chrono::seconds{ 1 } );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            
+            CHECK_EQUAL(
+                512,
+                test_connection.buffer_size()
+            );
+            
+            test_server.buffer_size( 2048 );
+            CHECK_EQUAL(
+                512,
+                test_connection.buffer_size()
+            );
+            
+            test_connection.buffer_size( 64 * 1024 );
+            CHECK_EQUAL(
+                64 * 1024,
+                test_connection.buffer_size()
+            );
+        }
+        catch( ... )
+        {
+            test_thread.join();
+            throw;
+        }
+        
+        test_thread.join();
+    }
+    
     TEST( HandleConnectionSeparateThread )
     {
         show::server test_server{ "::", 9090, -1 };
@@ -417,4 +472,228 @@ SUITE( ShowConnectionTests )
         
         test_thread.join();
     }
+    
+    TEST( TryReadWriteWithoutThrowing )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, -1 };
+        
+        std::string reply;
+        auto request_thread = send_request_async(
+            address,
+            port,
+            [ &reply ]( show::socket_fd request_socket ){
+                // Arrives after the server has already polled once
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds{ 100 }
+                );
+                write_to_socket( request_socket, "hello" );
+                
+                char buffer[ 16 ];
+                while( reply.size() < 5 )
+                {
+                    auto got = read( request_socket, buffer, sizeof( buffer ) );
+                    if( got < 1 )
+                        break;
+                    reply.append( buffer, static_cast< std::size_t >( got ) );
+                }
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            test_connection.timeout( 0 );
+            
+            char buffer[ 16 ];
+            std::streamsize bytes_read;
+            auto status = test_connection.try_read(
+                buffer,
+                sizeof( buffer ),
+                bytes_read
+            );
+            CHECK( status == show::io_status::TIMEOUT );
+            CHECK_EQUAL( 0, bytes_read );
+            
+            std::string request;
+            for( int i = 0; i < 100 && request.size() < 5; ++i )
+            {
+                status = test_connection.try_read(
+                    buffer,
+                    sizeof( buffer ),
+                    bytes_read
+                );
+                if( status == show::io_status::SUCCESS )
+                    request.append(
+                        buffer,
+                        static_cast< std::size_t >( bytes_read )
+                    );
+                else
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 10 }
+                    );
+            }
+            CHECK_EQUAL( "hello", request );
+            
+            std::streamsize bytes_written;
+            status = test_connection.try_write( "world", 5, bytes_written );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( 5, bytes_written );
+            CHECK( test_connection.try_flush() == show::io_status::SUCCESS );
+            
+            // The client closes its end once it has the reply
+            for( int i = 0; i < 100; ++i )
+            {
+                status = test_connection.try_read(
+                    buffer,
+                    sizeof( buffer ),
+                    bytes_read
+                );
+                if( status != show::io_status::TIMEOUT )
+                    break;
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 10 } );
+            }
+            CHECK( status == show::io_status::DISCONNECTED );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+        CHECK_EQUAL( "world", reply );
+    }
+    
+    TEST( TryWriteLargerThanBuffer )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, -1 };
+        
+        std::string message( 10000, 'x' );
+        for( std::size_t i = 0; i < message.size(); ++i )
+            message[ i ] = static_cast< char >( 'a' + i % 26 );
+        
+        std::string reply;
+        auto request_thread = send_request_async(
+            address,
+            port,
+            [ &reply, &message ]( show::socket_fd request_socket ){
+                char buffer[ 4096 ];
+                while( reply.size() < message.size() )
+                {
+                    auto got = read( request_socket, buffer, sizeof( buffer ) );
+                    if( got < 1 )
+                        break;
+                    reply.append( buffer, static_cast< std::size_t >( got ) );
+                }
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            test_connection.buffer_size( 256 );
+            
+            std::streamsize bytes_written;
+            auto status = test_connection.try_write(
+                message.data(),
+                static_cast< std::streamsize >( message.size() ),
+                bytes_written
+            );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( message.size(), bytes_written );
+            CHECK( test_connection.try_flush() == show::io_status::SUCCESS );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+        CHECK( reply == message );
+    }
+    
+    TEST( TryWriteResumeAfterTimeout )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, -1 };
+        
+        // Much more than the socket's send buffer can hold
+        std::string message( 16 * 1024 * 1024, 'x' );
+        for( std::size_t i = 0; i < message.size(); ++i )
+            message[ i ] = static_cast< char >( 'a' + i % 26 );
+        
+        std::string reply;
+        auto request_thread = send_request_async(
+            address,
+            port,
+            [ &reply, &message ]( show::socket_fd request_socket ){
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds{ 200 }
+                );
+                std::vector< char > buffer( 64 * 1024 );
+                while( reply.size() < message.size() )
+                {
+                    auto got = read(
+                        request_socket,
+                        buffer.data(),
+                        buffer.size()
+                    );
+                    if( got < 1 )
+                        break;
+                    reply.append(
+                        buffer.data(),
+                        static_cast< std::size_t >( got )
+                    );
+                }
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            test_connection.timeout( 0 );
+            
+            int timeouts{ 0 };
+            std::streamsize sent{ 0 };
+            auto size = static_cast< std::streamsize >( message.size() );
+            while( sent < size )
+            {
+                std::streamsize bytes_written;
+                auto status = test_connection.try_write(
+                    message.data() + sent,
+                    size - sent,
+                    bytes_written
+                );
+                sent += bytes_written;
+                if( status == show::io_status::TIMEOUT )
+                {
+                    ++timeouts;
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 1 }
+                    );
+                }
+                else
+                    REQUIRE CHECK( status == show::io_status::SUCCESS );
+            }
+            while( test_connection.try_flush() == show::io_status::TIMEOUT )
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 1 } );
+            
+            CHECK( timeouts > 0 );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+        CHECK_EQUAL( message.size(), reply.size() );
+        CHECK( reply == message );
+    }
 }
@@ -0,0 +1,620 @@
+#include "UnitTest++_wrap.hpp"
+#include <show/event_loop.hpp>
+
+#include "async_utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>    // std::invalid_argument
+#include <string>
+#include <thread>
+
+#include <sys/resource.h>   // getrlimit(), setrlimit()
+#include <sys/socket.h>     // send(), shutdown()
+#include <unistd.h>         // close(), dup(), read()
+
+
+namespace
+{
+    bool respond_hello( show::connection& c )
+    {
+        show::request test_request{ c };
+        show::response test_response{
+            c,
+            show::http_protocol::HTTP_1_0,
+            { 200, "OK" },
+            { { "Content-Length", { "5" } } }
+        };
+        test_response.sputn( "hello", 5 );
+        return false;
+    }
+    
+    const std::string hello_request{
+        "GET / HTTP/1.0\r\n"
+        "\r\n"
+    };
+    const std::string hello_response{
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello"
+    };
+}
+
+
+SUITE( ShowEventLoopTests )
+{
+    TEST( ServeSingleConnection )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        int handled{ 0 };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            [ &handled ]( show::connection& c, show::event_loop::event_flags ){
+                ++handled;
+                return respond_hello( c );
+            }
+        };
+        
+        std::thread request_thread{ [ address, port ](){
+            check_response_to_request(
+                address,
+                port,
+                hello_request,
+                hello_response
+            );
+        } };
+        
+        try
+        {
+            for( int i = 0; i < 50 && handled < 1; ++i )
+                test_loop.run_once( 100 );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+        CHECK_EQUAL( 1, handled );
+        CHECK_EQUAL( 0, test_loop.connection_count() );
+    }
+    
+    TEST( ServeMultipleConnectionsSingleThread )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        int handled{ 0 };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            [ &handled ]( show::connection& c, show::event_loop::event_flags ){
+                ++handled;
+                return respond_hello( c );
+            }
+        };
+        
+        std::thread request_threads[ 3 ];
+        for( auto& t : request_threads )
+            t = std::thread{ [ address, port ](){
+                check_response_to_request(
+                    address,
+                    port,
+                    hello_request,
+                    hello_response
+                );
+            } };
+        
+        try
+        {
+            for( int i = 0; i < 50 && handled < 3; ++i )
+                test_loop.run_once( 100 );
+        }
+        catch( ... )
+        {
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+        CHECK_EQUAL( 3, handled );
+    }
+    
+    TEST( KeepIdleConnection )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        bool readable{ false };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            [ &readable ](
+                show::connection& c,
+                show::event_loop::event_flags flags
+            ){
+                if( flags & show::event_loop::READABLE )
+                {
+                    show::request test_request{ c };
+                    readable = true;
+                }
+                return true;
+            }
+        };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket( request_socket, hello_request );
+                std::this_thread::sleep_for( std::chrono::seconds{ 1 } );
+            }
+        );
+        
+        try
+        {
+            for( int i = 0; i < 10 && !readable; ++i )
+                test_loop.run_once( 100 );
+            CHECK( readable );
+            CHECK_EQUAL( 1, test_loop.connection_count() );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( CloseConnectionOnHangup )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        bool hung_up{ false };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            [ &hung_up ](
+                show::connection&,
+                show::event_loop::event_flags flags
+            ){
+                if( flags & show::event_loop::READ_HANGUP )
+                    hung_up = true;
+                return true;
+            }
+        };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd ){}
+        );
+        request_thread.join();
+        
+        for( int i = 0; i < 10 && !hung_up; ++i )
+            test_loop.run_once( 100 );
+        
+        CHECK( hung_up );
+        CHECK_EQUAL( 0, test_loop.connection_count() );
+    }
+    
+    TEST( FinishResponseAfterReadHangup )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        // Far more than fits in the socket's send buffer, so most of it is
+        // still queued when the handler gives up
+        std::string content( 16 * 1024 * 1024, 'x' );
+        std::string expected_response{
+            "HTTP/1.0 200 OK\r\n"
+            "Content-Length: " + std::to_string( content.size() ) + "\r\n"
+            "\r\n"
+            + content
+        };
+        
+        int handled{ 0 };
+        show::event_loop test_loop{
+            show::server{ address, port, 0 },
+            [ &handled, &content ](
+                show::connection& c,
+                show::event_loop::event_flags flags
+            ){
+                if( !( flags & show::event_loop::READABLE ) )
+                    return true;
+                ++handled;
+                return c.handle_pipelined( [ &content ]( show::connection& c ){
+                    show::request test_request{ c };
+                    show::response test_response{
+                        c,
+                        show::http_protocol::HTTP_1_0,
+                        { 200, "OK" },
+                        { {
+                            "Content-Length",
+                            { std::to_string( content.size() ) }
+                        } }
+                    };
+                    test_response.queue( content.data(), content.size() );
+                    return true;
+                } );
+            }
+        };
+        
+        std::atomic_bool shut_down{ false };
+        std::atomic_bool done     { false };
+        std::string      got_response;
+        auto request_thread = send_request_async(
+            address,
+            port,
+            [ & ]( show::socket_fd request_socket ){
+                write_to_socket( request_socket, hello_request );
+                shutdown( request_socket, SHUT_WR );
+                shut_down = true;
+                
+                // Let the server fill its send buffer before reading any
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+                char buffer[ 65536 ];
+                ssize_t read_bytes;
+                while( ( read_bytes = read(
+                    request_socket,
+                    buffer,
+                    sizeof( buffer )
+                ) ) > 0 )
+                    got_response.append( buffer, read_bytes );
+                done = true;
+            }
+        );
+        
+        try
+        {
+            // The request & the hangup arrive together
+            while( !shut_down )
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 10 } );
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 50 } );
+            
+            for( int i = 0; i < 100 && !done; ++i )
+                test_loop.run_once( 100 );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+        CHECK_EQUAL( 1, handled );
+        CHECK_EQUAL( 0, test_loop.connection_count() );
+        CHECK_EQUAL( expected_response.size(), got_response.size() );
+        CHECK( expected_response == got_response );
+    }
+    
+    TEST( CloseConnectionOnDisconnectThrow )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        int handled{ 0 };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            [ &handled ]( show::connection&, show::event_loop::event_flags ){
+                ++handled;
+                throw show::client_disconnected{};
+                return true;
+            }
+        };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket( request_socket, hello_request );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 500 } );
+            }
+        );
+        
+        try
+        {
+            for( int i = 0; i < 10 && handled < 1; ++i )
+                test_loop.run_once( 100 );
+            CHECK_EQUAL( 0, test_loop.connection_count() );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( StopFromOtherThread )
+    {
+        show::event_loop test_loop{
+            show::server{ "::", 9090, -1 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return false;
+            }
+        };
+        
+        std::thread stop_thread{ [ &test_loop ](){
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 100 } );
+            test_loop.stop();
+        } };
+        
+        {
+            UNITTEST_TIME_CONSTRAINT( 500 );
+            test_loop.run();
+        }
+        
+        stop_thread.join();
+    }
+    
+    TEST( CloseIdleConnection )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return true;
+            }
+        };
+        test_loop.idle_timeout( 200 );
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd ){
+                std::this_thread::sleep_for( std::chrono::seconds{ 1 } );
+            }
+        );
+        
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            test_loop.run_once( 500 );
+            CHECK_EQUAL( 1, test_loop.connection_count() );
+            for( int i = 0; i < 10 && test_loop.connection_count() > 0; ++i )
+                test_loop.run_once( 100 );
+            CHECK_EQUAL( 0, test_loop.connection_count() );
+            CHECK( std::chrono::steady_clock::now() - start < (
+                std::chrono::milliseconds{ 500 }
+            ) );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( CloseSlowHeaders )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return true;
+            }
+        };
+        test_loop.idle_timeout  ( 200 );
+        test_loop.header_timeout( 500 );
+        
+        // Never idle long enough to hit the idle timeout, but never finishes
+        // sending the header block either
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                std::string line{ "GET / HTTP/1.1\r\n" };
+                for( int i = 0; i < 20; ++i )
+                {
+                    if( send(
+                        request_socket,
+                        line.data(),
+                        line.size(),
+                        MSG_NOSIGNAL
+                    ) < 0 )
+                        return;
+                    line = "X-Slow: yes\r\n";
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 50 }
+                    );
+                }
+            }
+        );
+        
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            test_loop.run_once( 500 );
+            CHECK_EQUAL( 1, test_loop.connection_count() );
+            for( int i = 0; i < 100 && test_loop.connection_count() > 0; ++i )
+                test_loop.run_once( 100 );
+            CHECK_EQUAL( 0, test_loop.connection_count() );
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            CHECK( elapsed >= std::chrono::milliseconds{ 450 } );
+            CHECK( elapsed <  std::chrono::milliseconds{ 900 } );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( ResetDeadlinesAfterRequest )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        int handled{ 0 };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            [ &handled ](
+                show::connection& c,
+                show::event_loop::event_flags flags
+            ){
+                if( flags & show::event_loop::READABLE )
+                {
+                    show::request test_request{ c };
+                    ++handled;
+                }
+                return true;
+            }
+        };
+        test_loop.header_timeout ( 200 );
+        test_loop.request_timeout( 200 );
+        
+        // Waiting for the next request doesn't count against the last one's
+        // deadlines
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket( request_socket, hello_request );
+                std::this_thread::sleep_for( std::chrono::seconds{ 1 } );
+            }
+        );
+        
+        try
+        {
+            for( int i = 0; i < 6; ++i )
+                test_loop.run_once( 100 );
+            CHECK_EQUAL( 1, handled );
+            CHECK_EQUAL( 1, test_loop.connection_count() );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( InheritConnectionTimeout )
+    {
+        show::event_loop test_loop{
+            show::server{ "::", 9090, 3 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return false;
+            }
+        };
+        CHECK_EQUAL( 3, test_loop.connection_timeout() );
+        CHECK_EQUAL( 0, test_loop.server().timeout()   );
+        
+        test_loop.connection_timeout( 0 );
+        CHECK_EQUAL( 0, test_loop.connection_timeout() );
+    }
+    
+    TEST( NonBlockingConnectionTimeoutByDefault )
+    {
+        show::event_loop test_loop{
+            show::server{ "::", 9090 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return false;
+            }
+        };
+        CHECK_EQUAL( 0, test_loop.connection_timeout() );
+        CHECK_THROW(
+            test_loop.connection_timeout( -1 ),
+            std::invalid_argument
+        );
+        CHECK_EQUAL( 0, test_loop.connection_timeout() );
+    }
+    
+    TEST( KeepAcceptedConnectionsOnError )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::event_loop test_loop{
+            show::server{ address, port, 2 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return true;
+            }
+        };
+        
+        std::thread request_threads[ 3 ];
+        for( auto& t : request_threads )
+            t = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+        
+        // Give all clients time to be queued
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+        
+        rlimit original_limit;
+        getrlimit( RLIMIT_NOFILE, &original_limit );
+        
+        try
+        {
+            // Leave room for only one more descriptor, so accepting the
+            // second connection fails
+            auto next_descriptor = dup( 0 );
+            close( next_descriptor );
+            auto limit = original_limit;
+            limit.rlim_cur = static_cast< rlim_t >( next_descriptor + 1 );
+            setrlimit( RLIMIT_NOFILE, &limit );
+            
+            test_loop.run_once( 100 );
+            CHECK_EQUAL( 1, test_loop.connection_count() );
+            CHECK_THROW( test_loop.run_once( 100 ), show::socket_error );
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            CHECK_EQUAL( 1, test_loop.connection_count() );
+            
+            // The listen socket is reported again even though no new clients
+            // have connected
+            test_loop.run_once( 100 );
+            CHECK_EQUAL( 3, test_loop.connection_count() );
+        }
+        catch( ... )
+        {
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+    }
+    
+    TEST( DeadlinesDisabledByDefault )
+    {
+        show::event_loop test_loop{
+            show::server{ "::", 9090, 3 },
+            []( show::connection&, show::event_loop::event_flags ){
+                return false;
+            }
+        };
+        CHECK_EQUAL( -1, test_loop.idle_timeout   () );
+        CHECK_EQUAL( -1, test_loop.header_timeout () );
+        CHECK_EQUAL( -1, test_loop.request_timeout() );
+        
+        test_loop.idle_timeout   ( 250 );
+        test_loop.header_timeout ( 500 );
+        test_loop.request_timeout( 750 );
+        CHECK_EQUAL( 250, test_loop.idle_timeout   () );
+        CHECK_EQUAL( 500, test_loop.header_timeout () );
+        CHECK_EQUAL( 750, test_loop.request_timeout() );
+    }
+}
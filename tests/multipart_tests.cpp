@@ -3,6 +3,11 @@
 
 #include <sstream>
 #include <string>
+#include <system_error>
+
+#include <fcntl.h>      // open()
+#include <stdlib.h>     // mkstemp()
+#include <unistd.h>
 
 #include "async_utils.hpp"
 #include "constants.hpp"
@@ -14,6 +19,121 @@ namespace
     const std::string boundaryA{ "AaB03x" };
     const std::string boundaryB{ "BbC04y" };
     const std::string boundaryC{ "CcD05z" };
+    
+    // Segment content several times larger than `show::multipart`'s scan
+    // buffer, full of near-misses for the delimiter
+    std::string large_segment_content( std::size_t size )
+    {
+        const std::string near_misses[] = {
+            "\r\n--" + boundaryA.substr( 0, 5 ) + "_",
+            "\n--" + boundaryA.substr( 0, 3 ) + "\r\n",
+            "\r\r\n-" + boundaryA,
+            "x--" + boundaryA,
+            "\r"
+        };
+        
+        std::string content;
+        unsigned int state{ 1 };
+        while( content.size() < size )
+        {
+            state = state * 1103515245 + 12345;
+            if( ( state >> 16 ) % 64 == 0 )
+                content += near_misses[ ( state >> 8 ) % 5 ];
+            else
+                content += static_cast< char >( state >> 16 );
+        }
+        content.resize( size );
+        return content;
+    }
+    
+    // Only makes a few bytes available at a time, like a slow connection
+    class trickle_buffer : public std::streambuf
+    {
+    public:
+        trickle_buffer( const std::string& content, std::size_t chunk_size ) :
+            _content   { content    },
+            _chunk_size{ chunk_size },
+            _position  { 0          }
+        {}
+    
+    protected:
+        std::string _content;
+        std::size_t _chunk_size;
+        std::size_t _position;
+        
+        virtual int_type underflow()
+        {
+            _position += static_cast< std::size_t >( egptr() - eback() );
+            if( _position >= _content.size() )
+                return traits_type::eof();
+            
+            auto end = _position + _chunk_size;
+            if( end > _content.size() )
+                end = _content.size();
+            
+            // Non-cost std::string::data() only available in C++17
+            auto data = const_cast< char* >( _content.data() );
+            setg( data + _position, data + _position, data + end );
+            return traits_type::to_int_type( *gptr() );
+        }
+    };
+    
+    std::string two_large_segments( const std::string& content )
+    {
+        return (
+            "--" + boundaryA + "\r\n"
+            "\r\n"
+            + content + "\r\n"
+            "--" + boundaryA + "\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "\r\n"
+            + content + "\r\n"
+            "--" + boundaryA + "--"
+        );
+    }
+    
+    std::string read_file( int fd )
+    {
+        std::string content;
+        char buffer[ 4096 ];
+        ssize_t bytes_read;
+        lseek( fd, 0, SEEK_SET );
+        while( ( bytes_read = read( fd, buffer, sizeof( buffer ) ) ) > 0 )
+            content.append( buffer, static_cast< std::size_t >( bytes_read ) );
+        return content;
+    }
+    
+    void check_two_large_segments(
+        std::streambuf&    buffer,
+        const std::string& content
+    )
+    {
+        show::multipart test_multipart{ buffer, boundaryA };
+        auto iter = test_multipart.begin();
+        
+        CHECK( content == ( std::string{
+            std::istreambuf_iterator< char >{ &*iter },
+            {}
+        } ) );
+        ++iter;
+        
+        CHECK_EQUAL(
+            ( show::headers_type{
+                { "Content-Type", { "application/octet-stream" } }
+            } ),
+            iter -> headers()
+        );
+        CHECK( content == ( std::string{
+            std::istreambuf_iterator< char >{ &*iter },
+            {}
+        } ) );
+        ++iter;
+        
+        CHECK_EQUAL(
+            test_multipart.end(),
+            iter
+        );
+    }
 }
 
 std::ostream& operator<<(
@@ -1223,6 +1343,42 @@ SUITE( ShowMultipartTests )
         }
     }
     
+    TEST( FailTooManyHeaders )
+    {
+        std::string headers;
+        auto max_fields = show::header_parser::DEFAULT_MAX_FIELDS;
+        for( std::size_t i = 0; i <= max_fields; ++i )
+            headers += "Header-" + std::to_string( i ) + ": value\r\n";
+        
+        std::stringbuf content{
+            (
+                "--" + boundaryA + "\r\n"
+                + headers
+                + "\r\n"
+                "\r\n"
+                "--" + boundaryA + "--"
+            ),
+            std::ios::in
+        };
+        
+        show::multipart test_multipart{
+            content,
+            boundaryA
+        };
+        try
+        {
+            auto iter = test_multipart.begin();
+            CHECK( false );
+        }
+        catch( const show::multipart_parse_error& e )
+        {
+            CHECK_EQUAL(
+                "too many headers in multipart data",
+                e.what()
+            );
+        }
+    }
+    
     TEST( FailDoubleBegin )
     {
         std::stringbuf content{
@@ -1347,4 +1503,134 @@ SUITE( ShowMultipartTests )
             );
         }
     }
+    
+    TEST( SegmentsLargerThanScanBuffer )
+    {
+        auto segment_content = large_segment_content( 300000 );
+        std::stringbuf content{
+            two_large_segments( segment_content ),
+            std::ios::in
+        };
+        check_two_large_segments( content, segment_content );
+    }
+    
+    TEST( SegmentsFromSmallReads )
+    {
+        auto segment_content = large_segment_content( 20000 );
+        for( std::size_t chunk_size : { 1, 2, 3, 7, 13, 4096 } )
+        {
+            trickle_buffer content{
+                two_large_segments( segment_content ),
+                chunk_size
+            };
+            check_two_large_segments( content, segment_content );
+        }
+    }
+    
+    TEST( CarriageReturnBeforeBoundaryIsContent )
+    {
+        std::stringbuf content{
+            (
+                "--" + boundaryA + "\r\n"
+                "\r\n"
+                "foo bar\r\r\n"
+                "--" + boundaryA + "\r\n"
+                "\r\n"
+                "hello world\r\n\n"
+                "--" + boundaryA + "--"
+            ),
+            std::ios::in
+        };
+        
+        show::multipart test_multipart{ content, boundaryA };
+        auto iter = test_multipart.begin();
+        
+        CHECK_EQUAL(
+            "foo bar\r",
+            ( std::string{
+                std::istreambuf_iterator< char >{ &*iter },
+                {}
+            } )
+        );
+        ++iter;
+        
+        CHECK_EQUAL(
+            "hello world\r\n",
+            ( std::string{
+                std::istreambuf_iterator< char >{ &*iter },
+                {}
+            } )
+        );
+        ++iter;
+        
+        CHECK_EQUAL(
+            test_multipart.end(),
+            iter
+        );
+    }
+    
+    TEST( SpoolSegmentsToFiles )
+    {
+        auto segment_content = large_segment_content( 200000 );
+        std::stringbuf content{
+            two_large_segments( segment_content ),
+            std::ios::in
+        };
+        show::multipart test_multipart{ content, boundaryA };
+        auto iter = test_multipart.begin();
+        
+        // Spooling starts wherever reading left off
+        char start[ 10 ];
+        CHECK_EQUAL( 10, iter -> sgetn( start, 10 ) );
+        
+        char name[] = "/tmp/show_multipart_tests_XXXXXX";
+        int fd = mkstemp( name );
+        REQUIRE CHECK( fd != -1 );
+        unlink( name );
+        CHECK_EQUAL( segment_content.size() - 10, iter -> spool_to( fd ) );
+        CHECK( segment_content == std::string( start, 10 ) + read_file( fd ) );
+        close( fd );
+        ++iter;
+        
+        char path[] = "/tmp/show_multipart_tests_XXXXXX";
+        fd = mkstemp( path );
+        REQUIRE CHECK( fd != -1 );
+        close( fd );
+        CHECK_EQUAL( segment_content.size(), iter -> spool_to_path( path ) );
+        fd = open( path, O_RDONLY );
+        unlink( path );
+        CHECK( segment_content == read_file( fd ) );
+        close( fd );
+        ++iter;
+        
+        CHECK_EQUAL(
+            test_multipart.end(),
+            iter
+        );
+    }
+    
+    TEST( FailSpoolSegmentToInvalidDescriptor )
+    {
+        std::stringbuf content{
+            (
+                "--" + boundaryA + "\r\n"
+                "\r\n"
+                "hello world\r\n"
+                "--" + boundaryA + "--"
+            ),
+            std::ios::in
+        };
+        show::multipart test_multipart{ content, boundaryA };
+        auto iter = test_multipart.begin();
+        
+        try
+        {
+            iter -> spool_to( -1 );
+            CHECK( false );
+        }
+        catch( const std::system_error& e )
+        {
+            CHECK( e.code() == std::errc::bad_file_descriptor );
+        }
+    }
 }
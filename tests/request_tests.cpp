@@ -1134,6 +1134,68 @@ SUITE( ShowRequestTests )
         );
     }
     
+    TEST( ReadVeryLongContentBulk )
+    {
+        std::string very_long_content;
+        for( int i = 0; i < 256; ++i )
+            very_long_content += long_message;
+        
+        run_checks_against_request(
+            (
+                "GET / HTTP/1.0\r\n"
+                "Content-Length: " + std::to_string( very_long_content.size() ) + "\r\n"
+                "\r\n"
+                + very_long_content
+            ),
+            [ very_long_content ]( show::request& test_request ){
+                // Reads much larger than the connection's buffer should
+                // bypass it without losing anything
+                std::string content;
+                char buffer[ 64 * 1024 ];
+                while( !test_request.eof() )
+                {
+                    auto read = test_request.sgetn( buffer, sizeof( buffer ) );
+                    REQUIRE CHECK( read > 0 );
+                    content.append( buffer, read );
+                }
+                CHECK_EQUAL(
+                    very_long_content,
+                    content
+                );
+            }
+        );
+    }
+    
+    TEST( ReadWithSmallBuffer )
+    {
+        handle_request(
+            (
+                "POST /some/path HTTP/1.1\r\n"
+                "Content-Type: text/plain\r\n"
+                "Content-Length: " + std::to_string( long_message.size() ) + "\r\n"
+                "\r\n"
+                + long_message
+            ),
+            []( show::connection& test_connection ){
+                // Smaller than most tokens, so everything straddles refills
+                test_connection.buffer_size( 7 );
+                show::request test_request{ test_connection };
+                CHECK_EQUAL( "POST", test_request.method() );
+                CHECK_EQUAL(
+                    "text/plain",
+                    test_request.headers().at( "Content-Type" ).at( 0 )
+                );
+                CHECK_EQUAL(
+                    long_message,
+                    ( std::string{
+                        std::istreambuf_iterator< char >( &test_request ),
+                        {}
+                    } )
+                );
+            }
+        );
+    }
+    
     TEST( ClientDisconnect )
     {
         handle_request(
@@ -1615,4 +1677,924 @@ SUITE( ShowRequestTests )
             }
         );
     }
+    
+    // Tokenizer tests /////////////////////////////////////////////////////////
+    
+    TEST( HeaderDelimiterImplementationsAgree )
+    {
+        using finder_type = const char* (*)( const char*, const char* );
+        std::vector< finder_type > finders{
+            &show::_find_header_delimiter_scalar,
+            &show::_find_header_delimiter
+        };
+#if defined( SHOW_X86_SIMD )
+        if( __builtin_cpu_supports( "sse4.2" ) )
+            finders.push_back( &show::_find_header_delimiter_sse42 );
+        if( __builtin_cpu_supports( "avx2" ) )
+            finders.push_back( &show::_find_header_delimiter_avx2 );
+#endif
+
+        // Every other byte value, to check for false positives
+        std::string filler;
+        for( int c = 0; c < 256; ++c )
+            if( !show::_is_header_delimiter( static_cast< char >( c ) ) )
+                filler += static_cast< char >( c );
+        
+        // Put each delimiter at every offset across a couple of 32-byte blocks
+        // so the SIMD loops and their scalar tails are all exercised
+        for( auto delimiter : std::string{ " ?\t\r\n:" } )
+            for( std::size_t offset = 0; offset < 80; ++offset )
+            {
+                std::string text( filler, offset, 80 );
+                text[ offset ] = delimiter;
+                for( std::size_t begin = 0; begin < 40; ++begin )
+                    for( auto finder : finders )
+                        CHECK_EQUAL(
+                            offset < begin ? text.size() : offset,
+                            static_cast< std::size_t >( finder(
+                                text.data() + begin,
+                                text.data() + text.size()
+                            ) - text.data() )
+                        );
+            }
+    }
+    
+    TEST( LongHeaderValue )
+    {
+        // Longer than the connection's buffer, so the header value is split
+        // across multiple token runs
+        std::string value( 3000, 'a' );
+        handle_request(
+            (
+                "GET / HTTP/1.0\r\n"
+                "Long-Header: " + value + "\r\n"
+                "\r\n"
+            ),
+            [ &value ]( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                CHECK_EQUAL(
+                    value,
+                    test_request.headers().at( "Long-Header" ).at( 0 )
+                );
+            }
+        );
+    }
+    
+    TEST( QueryArgsThenHeaders )
+    {
+        run_checks_against_request(
+            (
+                "GET /?foo=bar HTTP/1.0\r\n"
+                "Test-Header: hello world\r\n"
+                "\r\n"
+            ),
+            []( show::request& test_request ){
+                CHECK_EQUAL(
+                    ( show::headers_type{
+                        { "Test-Header", { "hello world" } }
+                    } ),
+                    test_request.headers()
+                );
+            }
+        );
+    }
+    
+    TEST( IgnoreLeadingEmptyLines )
+    {
+        run_checks_against_request(
+            (
+                "\r\n"
+                "\n"
+                "GET /hello HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::request& test_request ){
+                CHECK_EQUAL( "GET", test_request.method() );
+                CHECK_EQUAL( 1, test_request.path().size() );
+            }
+        );
+    }
+    
+    TEST( FailTooManyHeaders )
+    {
+        std::string headers;
+        auto max_fields = show::header_parser::DEFAULT_MAX_FIELDS;
+        for( std::size_t i = 0; i <= max_fields; ++i )
+            headers += "Header-" + std::to_string( i ) + ": value\r\n";
+        
+        handle_request(
+            (
+                "GET / HTTP/1.0\r\n"
+                + headers
+                + "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                try
+                {
+                    show::request test_request{ test_connection };
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL(
+                        "too many headers",
+                        e.what()
+                    );
+                }
+            }
+        );
+    }
+    
+    TEST( FailHeadersTooLarge )
+    {
+        // Fails as soon as the limit is passed, without waiting for the rest
+        auto max_block_size = show::header_parser::DEFAULT_MAX_BLOCK_SIZE;
+        handle_request(
+            (
+                "GET / HTTP/1.0\r\n"
+                "Long-Header: "
+                + std::string( max_block_size, 'a' )
+            ),
+            []( show::connection& test_connection ){
+                try
+                {
+                    show::request test_request{ test_connection };
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL(
+                        "header block too large",
+                        e.what()
+                    );
+                }
+            }
+        );
+    }
+    
+    TEST( HeaderParserAppendInPieces )
+    {
+        std::string block{
+            "Folded: hello\r\n"
+            "  world\r\n"
+            "Other: value\n"
+            "\r\n"
+            "content"
+        };
+        
+        // Feed the block one character at a time, as it might arrive
+        show::header_parser parser;
+        auto status = show::header_parse_status::INCOMPLETE;
+        std::size_t position{ 0 };
+        while( status == show::header_parse_status::INCOMPLETE )
+        {
+            std::size_t used;
+            status = parser.append(
+                block.data() + position,
+                block.data() + position + 1,
+                used
+            );
+            position += used;
+        }
+        
+        CHECK( status == show::header_parse_status::SUCCESS );
+        CHECK_EQUAL( block.size() - 7, position );
+        CHECK( parser.parse_fields() == show::header_parse_status::SUCCESS );
+        CHECK_EQUAL( 2, parser.field_count() );
+        CHECK_EQUAL( "Folded"     , parser.name ( 0 ).to_string() );
+        CHECK_EQUAL( "hello world", parser.value( 0 ).to_string() );
+        CHECK_EQUAL( "Other"      , parser.name ( 1 ).to_string() );
+        CHECK_EQUAL( "value"      , parser.value( 1 ).to_string() );
+        
+        // Storage is kept but the contents are not
+        parser.reset();
+        CHECK_EQUAL( 0, parser.size() );
+        CHECK_EQUAL( 0, parser.field_count() );
+    }
+    
+    TEST( HeaderParserLimits )
+    {
+        show::header_parser parser{ 1, 32 };
+        std::string block{
+            "One: 1\r\n"
+            "Two: 2\r\n"
+            "\r\n"
+        };
+        std::size_t used;
+        CHECK(
+            parser.append( block.data(), block.data() + block.size(), used )
+            == show::header_parse_status::SUCCESS
+        );
+        CHECK(
+            parser.parse_fields()
+            == show::header_parse_status::TOO_MANY_HEADERS
+        );
+        
+        parser.reset();
+        parser.max_block_size( 8 );
+        CHECK(
+            parser.append( block.data(), block.data() + block.size(), used )
+            == show::header_parse_status::HEADERS_TOO_LARGE
+        );
+    }
+    
+    TEST( ChunkedContent )
+    {
+        handle_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "5\r\n"
+                "hello\r\n"
+                "6;name=value\r\n"
+                " world\r\n"
+                "0\r\n"
+                "Trailer-Field: ignored\r\n"
+                "\r\n"
+                "GET /next HTTP/1.1\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                CHECK( test_request.chunked() );
+                CHECK_EQUAL(
+                    show::request::YES,
+                    test_request.unknown_content_length()
+                );
+                
+                std::string content;
+                char buffer[ 4 ];
+                std::streamsize read;
+                while( ( read = test_request.sgetn( buffer, 4 ) ) > 0 )
+                    content.append(
+                        buffer,
+                        static_cast< std::size_t >( read )
+                    );
+                CHECK_EQUAL( "hello world", content );
+                CHECK( test_request.eof() );
+                CHECK_EQUAL( 0, test_request.sgetn( buffer, 4 ) );
+                
+                // The connection is left at the start of the next request
+                show::request next_request{ test_connection };
+                CHECK( ( next_request.path() == std::vector< std::string >{
+                    "next"
+                } ) );
+                CHECK( !next_request.chunked() );
+            }
+        );
+    }
+    
+    TEST( ChunkedContentByCharacter )
+    {
+        run_checks_against_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: gzip, Chunked\r\n"
+                "Content-Length: 100\r\n"
+                "\r\n"
+                "3\n"
+                "abc\n"
+                "A\n"
+                "0123456789\n"
+                "0\n"
+                "\n"
+            ),
+            []( show::request& test_request ){
+                REQUIRE CHECK( test_request.chunked() );
+                std::string content{
+                    std::istreambuf_iterator< char >{ &test_request },
+                    {}
+                };
+                CHECK_EQUAL( "abc0123456789", content );
+            }
+        );
+    }
+    
+    TEST( FailChunkedNotLastCoding )
+    {
+        handle_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked, gzip\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                try
+                {
+                    show::request test_request{ test_connection };
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL(
+                        "final transfer coding is not chunked",
+                        e.what()
+                    );
+                }
+            }
+        );
+    }
+    
+    TEST( FailChunkedNotLastCodingSplitHeaders )
+    {
+        // Framing this by "Content-Length" is how requests get smuggled past
+        // a proxy that frames it as chunked
+        handle_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "Content-Length: 5\r\n"
+                "Transfer-Encoding: gzip,\r\n"
+                "\r\n"
+                "0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                CHECK_THROW(
+                    show::request{ test_connection },
+                    show::request_parse_error
+                );
+            }
+        );
+        handle_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "Content-Length: 5\r\n"
+                "Transfer-Encoding: gzip\r\n"
+                "\r\n"
+                "0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                CHECK_THROW(
+                    show::request_view{ test_connection },
+                    show::request_parse_error
+                );
+            }
+        );
+    }
+    
+    TEST( ChunkedContentInPieces )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket(
+                    request_socket,
+                    "PUT / HTTP/1.1\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n"
+                    "4\r\nWi"
+                );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 200 } );
+                write_to_socket( request_socket, "ki\r" );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 200 } );
+                write_to_socket( request_socket, "\n5\r\npedia\r\n0\r\n\r\n" );
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            show::request test_request{ test_connection };
+            
+            // Reads return what's arrived so far without waiting for more
+            char buffer[ 64 ];
+            std::vector< std::string > reads;
+            std::streamsize read;
+            while( ( read = test_request.sgetn( buffer, 64 ) ) > 0 )
+                reads.emplace_back(
+                    buffer,
+                    static_cast< std::size_t >( read )
+                );
+            CHECK( ( reads == std::vector< std::string >{
+                "Wi", "ki", "pedia"
+            } ) );
+            CHECK( test_request.eof() );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( ChunkedView )
+    {
+        handle_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: identity\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "2\r\n"
+                "ok\r\n"
+                "0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request_view test_view{ test_connection };
+                REQUIRE CHECK( test_view.chunked() );
+                test_view.flush();
+                CHECK( test_view.eof() );
+            }
+        );
+    }
+    
+    TEST( FailChunkedMalformedSize )
+    {
+        run_checks_against_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "x\r\n"
+                "\r\n"
+            ),
+            []( show::request& test_request ){
+                try
+                {
+                    test_request.sbumpc();
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL( "malformed chunk size", e.what() );
+                }
+            }
+        );
+    }
+    
+    TEST( FailChunkedSizeTooLarge )
+    {
+        run_checks_against_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "10000000000000000\r\n"
+            ),
+            []( show::request& test_request ){
+                CHECK_THROW( test_request.sbumpc(), show::request_parse_error );
+            }
+        );
+    }
+    
+    TEST( FailChunkedDataTooLong )
+    {
+        run_checks_against_request(
+            (
+                "POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "2\r\n"
+                "abc\r\n"
+                "0\r\n"
+                "\r\n"
+            ),
+            []( show::request& test_request ){
+                try
+                {
+                    test_request.flush();
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL( "chunk larger than its size", e.what() );
+                }
+            }
+        );
+    }
+    
+    TEST( RequestParserFeedByCharacter )
+    {
+        std::string head{
+            "\r\n"
+            "get /some/path?a=b HTTP/1.1\r\n"
+            "Folded: hello\r\n"
+            "  world\r\n"
+            "\r\n"
+        };
+        
+        show::request_parser parser;
+        std::size_t position{ 0 };
+        while( position < head.size() )
+        {
+            CHECK( parser.status() == show::request_parse_status::INCOMPLETE );
+            std::size_t used;
+            parser.feed( head.data() + position, 1, used );
+            CHECK_EQUAL( 1, used );
+            position += used;
+        }
+        
+        REQUIRE CHECK(
+            parser.status() == show::request_parse_status::COMPLETE
+        );
+        CHECK_EQUAL( show::HTTP_1_1, parser.protocol() );
+        CHECK_EQUAL( "HTTP/1.1"  , parser.protocol_string() );
+        CHECK_EQUAL( "GET"       , parser.method         () );
+        CHECK_EQUAL( "/some/path", parser.raw_path       () );
+        CHECK_EQUAL( "a=b"       , parser.raw_query      () );
+        REQUIRE CHECK_EQUAL( 1, parser.fields().field_count() );
+        CHECK_EQUAL( "Folded"     , parser.fields().name ( 0 ) );
+        CHECK_EQUAL( "hello world", parser.fields().value( 0 ) );
+    }
+    
+    TEST( RequestParserLeavesRest )
+    {
+        std::string first { "POST / HTTP/1.1\nContent-Length: 3\n\nfoo" };
+        std::string second{ "GET /next HTTP/1.1\r\n\r\n" };
+        std::string input{ first + second };
+        
+        show::request_parser parser;
+        std::size_t used;
+        CHECK(
+            parser.feed( input.data(), input.size(), used )
+            == show::request_parse_status::COMPLETE
+        );
+        CHECK_EQUAL( first.size() - 3, used );
+        CHECK_EQUAL( "POST", parser.method() );
+        
+        // Nothing more is taken until the parser is reset
+        CHECK(
+            parser.feed( input.data() + used, input.size() - used, used )
+            == show::request_parse_status::COMPLETE
+        );
+        CHECK_EQUAL( 0, used );
+        
+        parser.reset();
+        CHECK(
+            parser.feed( second.data(), second.size(), used )
+            == show::request_parse_status::COMPLETE
+        );
+        CHECK_EQUAL( second.size(), used );
+        CHECK_EQUAL( "/next", parser.raw_path() );
+        CHECK_EQUAL( 0, parser.fields().field_count() );
+    }
+    
+    TEST( RequestParserFail )
+    {
+        std::string head{
+            "GET / HTTP/1.0\r\n"
+            "Bad-Header: \r\n"
+            "\r\n"
+        };
+        
+        show::request_parser parser;
+        CHECK_EQUAL( "", parser.error() );
+        std::size_t used;
+        CHECK(
+            parser.feed( head.data(), head.size(), used )
+            == show::request_parse_status::FAILED
+        );
+        CHECK_EQUAL( "missing header value", parser.error() );
+        CHECK(
+            parser.feed( head.data(), head.size(), used )
+            == show::request_parse_status::FAILED
+        );
+        CHECK_EQUAL( 0, used );
+        
+        parser = show::request_parser{ 100, 8 };
+        CHECK(
+            parser.feed( head.data(), head.size(), used )
+            == show::request_parse_status::FAILED
+        );
+        CHECK_EQUAL( "header block too large", parser.error() );
+    }
+    
+    TEST( ResumeAfterTimeout )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket(
+                    request_socket,
+                    "GET /resumed HTTP/1.1\r\n"
+                    "Host: exa"
+                );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 300 } );
+                write_to_socket(
+                    request_socket,
+                    "mple.com\r\n"
+                    "\r\n"
+                );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 500 } );
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 100 } );
+            
+            // The first half of the header block is kept after a timeout
+            test_connection.timeout( 0 );
+            CHECK_THROW(
+                ( show::request{ test_connection } ),
+                show::connection_timeout
+            );
+            
+            test_connection.timeout( 2 );
+            show::request test_request{ test_connection };
+            CHECK( ( test_request.path() == std::vector< std::string >{
+                "resumed"
+            } ) );
+            CHECK( ( test_request.headers() == show::headers_type{
+                { "Host", { "example.com" } }
+            } ) );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    TEST( TryReadRequest )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket( request_socket, "PUT /polled HT" );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 200 } );
+                write_to_socket( request_socket, "TP/1.1\r\n\r\n" );
+                std::this_thread::sleep_for( std::chrono::milliseconds{ 500 } );
+            }
+        );
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+            test_connection.timeout( 0 );
+            
+            std::size_t timeouts{ 0 };
+            auto status = show::io_status::TIMEOUT;
+            while( status == show::io_status::TIMEOUT )
+            {
+                status = test_connection.try_read_request();
+                if( status == show::io_status::TIMEOUT )
+                {
+                    ++timeouts;
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 10 }
+                    );
+                }
+            }
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK( timeouts > 0 );
+            
+            // Already read, so this takes the pending request without waiting
+            CHECK(
+                test_connection.try_read_request() == show::io_status::SUCCESS
+            );
+            show::request_view test_view{ test_connection };
+            CHECK_EQUAL( "PUT"    , test_view.method() );
+            CHECK_EQUAL( "/polled", test_view.raw_path() );
+            CHECK_EQUAL( show::HTTP_1_1, test_view.protocol() );
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
+    // View tests //////////////////////////////////////////////////////////////
+    
+    // Sends the same request twice, parsing it first as a `show::request` then
+    // as a `show::request_view`, and checks the view decodes to the same thing
+    void check_view_matches_request( const std::string& request_text )
+    {
+        handle_request(
+            request_text + request_text,
+            []( show::connection& test_connection ){
+                // Requests without a Content-Length would read into the second
+                // copy, so only read content when its length is known
+                show::request test_request{ test_connection };
+                std::string request_content;
+                if( !test_request.unknown_content_length() )
+                    request_content.assign(
+                        std::istreambuf_iterator< char >( &test_request ),
+                        {}
+                    );
+                
+                show::request_view test_view{ test_connection };
+                std::string view_content;
+                if( !test_view.unknown_content_length() )
+                    view_content.assign(
+                        std::istreambuf_iterator< char >( &test_view ),
+                        {}
+                    );
+                
+                CHECK_EQUAL(
+                    test_request.protocol(),
+                    test_view.protocol()
+                );
+                CHECK_EQUAL(
+                    test_request.protocol_string(),
+                    test_view.protocol_string().to_string()
+                );
+                CHECK_EQUAL(
+                    test_request.method(),
+                    test_view.method().to_string()
+                );
+                CHECK( test_request.path      () == test_view.path      () );
+                CHECK( test_request.query_args() == test_view.query_args() );
+                CHECK( test_request.headers   () == test_view.headers   () );
+                CHECK_EQUAL(
+                    test_request.unknown_content_length(),
+                    test_view.unknown_content_length()
+                );
+                CHECK_EQUAL( request_content, view_content );
+            }
+        );
+    }
+    
+    TEST( ViewSimpleRequest )
+    {
+        check_view_matches_request(
+            "GET / HTTP/1.0\r\n"
+            "\r\n"
+        );
+    }
+    
+    TEST( ViewPathAndQuery )
+    {
+        check_view_matches_request(
+            "post /hello/world%20path/?foo=bar&a=b=c&flag&x=%3D HTTP/1.1\r\n"
+            "\r\n"
+        );
+    }
+    
+    TEST( ViewHeaders )
+    {
+        check_view_matches_request(
+            "GET / HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Multi-Line: first  line\r\n"
+            "\tsecond line\r\n"
+            "X-Repeated: 1\r\n"
+            "x-repeated: 2\r\n"
+            "\r\n"
+        );
+    }
+    
+    TEST( ViewContent )
+    {
+        check_view_matches_request(
+            "PUT /upload HTTP/1.1\r\n"
+            "Content-Length: 11\r\n"
+            "\r\n"
+            "hello world"
+        );
+    }
+    
+    TEST( ViewUnixLineEndings )
+    {
+        check_view_matches_request(
+            "GET /a/b HTTP/1.0\n"
+            "Header: value\n"
+            "\n"
+        );
+    }
+    
+    TEST( ViewRawAccessors )
+    {
+        handle_request(
+            (
+                "get /hello%20world?foo=bar%21 http/1.1\r\n"
+                "Content-Type: text/plain\r\n"
+                "Content-Length: 2\r\n"
+                "\r\n"
+                "hi"
+            ),
+            []( show::connection& test_connection ){
+                show::request_view test_view{ test_connection };
+                CHECK_EQUAL( "GET"          , test_view.method         () );
+                CHECK_EQUAL( "/hello%20world", test_view.raw_path      () );
+                CHECK_EQUAL( "foo=bar%21"   , test_view.raw_query      () );
+                CHECK_EQUAL( "http/1.1"     , test_view.protocol_string() );
+                CHECK_EQUAL(
+                    show::http_protocol::HTTP_1_1,
+                    test_view.protocol()
+                );
+                CHECK_EQUAL( 2, test_view.field_count() );
+                CHECK_EQUAL( "Content-Type", test_view.field( 0 ).name  );
+                CHECK_EQUAL( "text/plain"  , test_view.field( 0 ).value );
+                CHECK_EQUAL( "text/plain"  , test_view.header( "content-type" ) );
+                CHECK( test_view.header( "Missing" ).empty() );
+                CHECK_EQUAL( 2, test_view.content_length() );
+            }
+        );
+    }
+    
+    TEST( ViewMoveAssign )
+    {
+        handle_request(
+            (
+                "GET /first HTTP/1.1\r\n"
+                "Content-Length: 3\r\n"
+                "\r\n"
+                "foo"
+                "GET /second HTTP/1.1\r\n"
+                "Content-Length: 3\r\n"
+                "\r\n"
+                "bar"
+            ),
+            []( show::connection& test_connection ){
+                show::request_view test_view{ test_connection };
+                CHECK_EQUAL( "/first", test_view.raw_path() );
+                CHECK_EQUAL(
+                    "foo",
+                    ( std::string{
+                        std::istreambuf_iterator< char >( &test_view ),
+                        {}
+                    } )
+                );
+                test_view = show::request_view{ test_connection };
+                CHECK_EQUAL( "/second", test_view.raw_path() );
+                CHECK_EQUAL(
+                    "bar",
+                    ( std::string{
+                        std::istreambuf_iterator< char >( &test_view ),
+                        {}
+                    } )
+                );
+            }
+        );
+    }
+    
+    TEST( ViewFailPathElementURLEncodedInvalid )
+    {
+        handle_request(
+            (
+                "GET /%Fg HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                // Decoding is deferred, so constructing the view succeeds
+                show::request_view test_view{ test_connection };
+                try
+                {
+                    test_view.path();
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL(
+                        "invalid URL-encoded sequence",
+                        e.what()
+                    );
+                }
+            }
+        );
+    }
+    
+    TEST( ViewFailMissingHeaderValue )
+    {
+        handle_request(
+            (
+                "GET / HTTP/1.0\r\n"
+                "Bad-Header: \r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                try
+                {
+                    show::request_view test_view{ test_connection };
+                    CHECK( false );
+                }
+                catch( const show::request_parse_error& e )
+                {
+                    CHECK_EQUAL(
+                        "missing header value",
+                        e.what()
+                    );
+                }
+            }
+        );
+    }
 }
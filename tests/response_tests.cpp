@@ -4,7 +4,40 @@
 #include "async_utils.hpp"
 #include "constants.hpp"
 
-#include <iostream> // std::cerr
+#include <algorithm>  // std::min()
+#include <chrono>
+#include <cstdlib>    // mkstemp()
+#include <iostream>   // std::cerr
+#include <stdexcept>  // std::runtime_error
+#include <thread>
+
+#include <unistd.h>   // close(), pipe(), unlink(), write()
+
+
+namespace
+{
+    // Writes `content` to a new file that is already unlinked, so it
+    // disappears once the returned descriptor is closed
+    int temporary_file( const std::string& content )
+    {
+        char name[] = "/tmp/show_response_tests_XXXXXX";
+        int fd = mkstemp( name );
+        if( fd == -1 )
+            throw std::runtime_error{ "failed to create temporary file" };
+        unlink( name );
+        
+        if(
+            write( fd, content.c_str(), content.size() )
+            != static_cast< ssize_t >( content.size() )
+        )
+        {
+            close( fd );
+            throw std::runtime_error{ "failed to write temporary file" };
+        }
+        
+        return fd;
+    }
+}
 
 
 SUITE( ShowResponseTests )
@@ -362,13 +395,74 @@ SUITE( ShowResponseTests )
         );
     }
     
+    TEST( MultiLineHeaderMixedLineBreaks )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::UNKNOWN,
+                    { 200, "OK" },
+                    {
+                        { "Header1", { "foo\r\n\r\nbar\rbaz\n" } },
+                        { "Header2", { "\r\n"                  } }
+                    }
+                };
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Header1: foo\r\n"
+                " bar\r\n"
+                " baz\r\n"
+                "Header2: \r\n"
+                "\r\n"
+            )
+        );
+    }
+    
+    TEST( HeaderMapInInsertionOrder )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::header_map headers;
+                headers.add( "x-second-header"            , "foo\nbar"   );
+                headers.add( show::header_id::CONTENT_TYPE, "text/plain" );
+                headers.add( "content-length"             , "0"          );
+                show::response test_response{
+                    test_connection,
+                    show::UNKNOWN,
+                    { 200, "OK" },
+                    headers
+                };
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "X-Second-Header: foo\r\n"
+                " bar\r\n"
+                "Content-Type: text/plain\r\n"
+                "Content-Length: 0\r\n"
+                "\r\n"
+            )
+        );
+    }
+    
     TEST( FlushOnDestroy )
     {
         std::string content;
         
-        // Sending `show::connection::BUFFER_SIZE` characters should caust a
-        // single flush during write (headers + partial content), then another
-        // on destroy
+        // Sending `show::connection::DEFAULT_BUFFER_SIZE` characters should
+        // caust a single flush during write (headers + partial content), then
+        // another on destroy
         for( size_t i = 0; i < 1024; ++i )
             content += "w";
         
@@ -405,6 +499,649 @@ SUITE( ShowResponseTests )
         );
     }
     
+    TEST( WriteVeryLongContent )
+    {
+        std::string very_long_content;
+        for( int i = 0; i < 256; ++i )
+            very_long_content += long_message;
+        
+        // A short write to leave something in the buffer, then one much
+        // larger than the buffer that should be sent along with it directly
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            [ &very_long_content ]( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( very_long_content.size() + 5 )
+                        } }
+                    }
+                };
+                test_response.sputn( "start", 5 );
+                CHECK_EQUAL(
+                    very_long_content.size(),
+                    test_response.sputn(
+                        very_long_content.c_str(),
+                        very_long_content.size()
+                    )
+                );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( very_long_content.size() + 5 )
+                + "\r\n"
+                "\r\n"
+                "start"
+                + very_long_content
+            )
+        );
+    }
+    
+    TEST( WriteWithResizedBuffer )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                test_connection.buffer_size( 16 );
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( long_message.size() )
+                        } }
+                    }
+                };
+                
+                // Write in pieces on either side of the new buffer size
+                std::size_t written{ 0 };
+                std::size_t piece  { 1 };
+                while( written < long_message.size() )
+                {
+                    auto size = std::min( piece, long_message.size() - written );
+                    test_response.sputn( long_message.c_str() + written, size );
+                    written += size;
+                    piece = piece * 3 % 41 + 1;
+                }
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( long_message.size() )
+                + "\r\n"
+                "\r\n"
+                + long_message
+            )
+        );
+    }
+    
+    TEST( WriteQueuedContent )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( long_message.size() + 10 )
+                        } }
+                    }
+                };
+                test_response.queue( "first", 5 );
+                test_response.queue( long_message );
+                test_response.queue( std::string{ "second" }.substr( 0, 5 ) );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( long_message.size() + 10 )
+                + "\r\n"
+                "\r\n"
+                "first"
+                + long_message
+                + "secon"
+            )
+        );
+    }
+    
+    TEST( WriteQueuedContentInterleaved )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    { { "Content-Length", { "15" } } }
+                };
+                test_response.sputn( "one", 3 );
+                test_response.queue( "two", 3 );
+                test_response.sputn( "three", 5 );
+                test_response.flush();
+                test_response.queue( "four", 4 );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: 15\r\n"
+                "\r\n"
+                "onetwothreefour"
+            )
+        );
+    }
+    
+    TEST( WriteHeadersLargerThanBuffer )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                test_connection.buffer_size( 16 );
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", { "5" } },
+                        { "X-Long-Header", { std::string( 256, 'x' ) } }
+                    }
+                };
+                test_response.sputn( "hello", 5 );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "X-Long-Header: "
+                + std::string( 256, 'x' )
+                + "\r\n"
+                "\r\n"
+                "hello"
+            )
+        );
+    }
+    
+    TEST( SendFile )
+    {
+        std::string content;
+        for( int i = 0; i < 64; ++i )
+            content += long_message;
+        
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            [ &content ]( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( content.size() - 10 + 5 )
+                        } }
+                    }
+                };
+                test_response.sputn( "start", 5 );
+                
+                int fd = temporary_file( content );
+                auto sent = test_response.send_file(
+                    fd,
+                    10,
+                    content.size() - 10
+                );
+                close( fd );
+                CHECK_EQUAL( content.size() - 10, sent );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( content.size() - 10 + 5 )
+                + "\r\n"
+                "\r\n"
+                "start"
+                + content.substr( 10 )
+            )
+        );
+    }
+    
+    TEST( SendFileEndsEarly )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    { { "Content-Length", { "5" } } }
+                };
+                
+                int fd = temporary_file( "hello" );
+                auto sent = test_response.send_file( fd, 0, 100 );
+                close( fd );
+                CHECK_EQUAL( 5, sent );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "\r\n"
+                "hello"
+            )
+        );
+    }
+    
+    TEST( SendFileFromPipe )
+    {
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( long_message.size() )
+                        } }
+                    }
+                };
+                
+                int pipe_descriptors[ 2 ];
+                REQUIRE CHECK_EQUAL( 0, pipe( pipe_descriptors ) );
+                auto written = write(
+                    pipe_descriptors[ 1 ],
+                    long_message.c_str(),
+                    long_message.size()
+                );
+                close( pipe_descriptors[ 1 ] );
+                CHECK_EQUAL( long_message.size(), written );
+                
+                // The offset doesn't apply to pipes
+                auto sent = test_response.send_file(
+                    pipe_descriptors[ 0 ],
+                    10,
+                    long_message.size()
+                );
+                close( pipe_descriptors[ 0 ] );
+                CHECK_EQUAL( long_message.size(), sent );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( long_message.size() )
+                + "\r\n"
+                "\r\n"
+                + long_message
+            )
+        );
+    }
+    
+    // Sends all of `fd` over a connection that never waits, resuming after
+    // each timeout; returns how many there were
+    int send_whole_file(
+        show::response& test_response,
+        int             fd,
+        off_t           offset,
+        std::size_t     length
+    )
+    {
+        int timeouts{ 0 };
+        while( true )
+        {
+            auto status = test_response.try_send_file( fd, offset, length );
+            if( status == show::io_status::SUCCESS )
+                break;
+            REQUIRE CHECK( status == show::io_status::TIMEOUT );
+            ++timeouts;
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 1 } );
+        }
+        CHECK_EQUAL( 0, length );
+        return timeouts;
+    }
+    
+    TEST( TrySendFileResumes )
+    {
+        // Far more than fits in the socket's send buffer
+        std::string content;
+        for( int i = 0; content.size() < 8 * 1024 * 1024; ++i )
+            content += std::to_string( i ) + "\n";
+        
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            [ &content ]( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                test_connection.timeout( 0 );
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( content.size() - 10 )
+                        } }
+                    }
+                };
+                
+                int fd = temporary_file( content );
+                CHECK( send_whole_file(
+                    test_response,
+                    fd,
+                    10,
+                    content.size() - 10
+                ) > 0 );
+                close( fd );
+                
+                test_connection.timeout( 2 );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( content.size() - 10 )
+                + "\r\n"
+                "\r\n"
+                + content.substr( 10 )
+            )
+        );
+    }
+    
+    TEST( TrySendFileFromPipeResumes )
+    {
+        std::string content;
+        for( int i = 0; content.size() < 8 * 1024 * 1024; ++i )
+            content += std::to_string( i ) + "\n";
+        
+        run_checks_against_response(
+            (
+                "GET / HTTP/1.0\r\n"
+                "\r\n"
+            ),
+            [ &content ]( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                test_connection.timeout( 0 );
+                show::response test_response{
+                    test_connection,
+                    show::HTTP_1_0,
+                    { 200, "OK" },
+                    {
+                        { "Content-Length", {
+                            std::to_string( content.size() )
+                        } }
+                    }
+                };
+                
+                // Too much to fit in the pipe at once, so it's written as
+                // it's read
+                int pipe_descriptors[ 2 ];
+                REQUIRE CHECK_EQUAL( 0, pipe( pipe_descriptors ) );
+                std::thread writer{ [ & ](){
+                    std::size_t written{ 0 };
+                    while( written < content.size() )
+                    {
+                        auto result = write(
+                            pipe_descriptors[ 1 ],
+                            content.data() + written,
+                            content.size() - written
+                        );
+                        if( result < 1 )
+                            break;
+                        written += static_cast< std::size_t >( result );
+                    }
+                    close( pipe_descriptors[ 1 ] );
+                } };
+                
+                auto timeouts = send_whole_file(
+                    test_response,
+                    pipe_descriptors[ 0 ],
+                    0,
+                    content.size()
+                );
+                writer.join();
+                close( pipe_descriptors[ 0 ] );
+                CHECK( timeouts > 0 );
+                
+                test_connection.timeout( 2 );
+            },
+            (
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Length: "
+                + std::to_string( content.size() )
+                + "\r\n"
+                "\r\n"
+                + content
+            )
+        );
+    }
+    
+    // Responds to a request with its path as the content
+    bool respond_with_path( show::connection& c )
+    {
+        show::request r{ c };
+        auto path = r.path().at( 0 );
+        show::response{
+            c,
+            show::HTTP_1_1,
+            { 200, "OK" },
+            { { "Content-Length", { std::to_string( path.size() ) } } }
+        }.sputn( path.data(), static_cast< std::streamsize >( path.size() ) );
+        return path != "last";
+    }
+    
+    TEST( HandlePipelinedInOrder )
+    {
+        run_checks_against_response(
+            (
+                "GET /one HTTP/1.1\r\n"
+                "\r\n"
+                "PUT /two HTTP/1.1\r\n"
+                "Content-Length: 3\r\n"
+                "\r\n"
+                "foo"
+                "GET /three HTTP/1.1\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                std::size_t handled{ 0 };
+                CHECK( test_connection.handle_pipelined(
+                    [ & ]( show::connection& c ){
+                        ++handled;
+                        show::request r{ c };
+                        std::string content;
+                        if( !r.unknown_content_length() )
+                            content.assign(
+                                std::istreambuf_iterator< char >( &r ),
+                                {}
+                            );
+                        auto message = r.path().at( 0 ) + content;
+                        show::response{
+                            c,
+                            show::HTTP_1_1,
+                            { 200, "OK" },
+                            { { "Content-Length", {
+                                std::to_string( message.size() )
+                            } } }
+                        }.sputn(
+                            message.data(),
+                            static_cast< std::streamsize >( message.size() )
+                        );
+                        return true;
+                    }
+                ) );
+                CHECK_EQUAL( 3, handled );
+            },
+            (
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 3\r\n"
+                "\r\n"
+                "one"
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 6\r\n"
+                "\r\n"
+                "twofoo"
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "\r\n"
+                "three"
+            )
+        );
+    }
+    
+    TEST( HandlePipelinedStopsWhenHandlerDoes )
+    {
+        run_checks_against_response(
+            (
+                "GET /last HTTP/1.1\r\n"
+                "\r\n"
+                "GET /ignored HTTP/1.1\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                CHECK( !test_connection.handle_pipelined( respond_with_path ) );
+            },
+            (
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 4\r\n"
+                "\r\n"
+                "last"
+            )
+        );
+    }
+    
+    TEST( HandlePipelinedStopsWhenRequestNotTaken )
+    {
+        run_checks_against_response(
+            (
+                "GET /first HTTP/1.1\r\n"
+                "\r\n"
+                "GET /second HTTP/1.1\r\n"
+                "\r\n"
+                "GET /third HTTP/1.1\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                // The second call never constructs a request, so the third
+                // request is left for later
+                std::size_t handled{ 0 };
+                CHECK( test_connection.handle_pipelined(
+                    [ & ]( show::connection& c ){
+                        if( ++handled > 1 )
+                            return true;
+                        return respond_with_path( c );
+                    }
+                ) );
+                CHECK_EQUAL( 2, handled );
+                
+                CHECK( test_connection.handle_pipelined( respond_with_path ) );
+            },
+            (
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "\r\n"
+                "first"
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 6\r\n"
+                "\r\n"
+                "second"
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "\r\n"
+                "third"
+            )
+        );
+    }
+    
+    TEST( HandlePipelinedPartialRequest )
+    {
+        run_checks_against_response(
+            (
+                "GET /first HTTP/1.1\r\n"
+                "\r\n"
+                "GET /sec"
+            ),
+            []( show::connection& test_connection ){
+                // Doesn't wait for the rest of the second request
+                std::size_t handled{ 0 };
+                CHECK( test_connection.handle_pipelined(
+                    [ & ]( show::connection& c ){
+                        ++handled;
+                        return respond_with_path( c );
+                    }
+                ) );
+                CHECK_EQUAL( 1, handled );
+            },
+            (
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "\r\n"
+                "first"
+            )
+        );
+    }
+    
+    TEST( HandlePipelinedSendsBeforeError )
+    {
+        run_checks_against_response(
+            (
+                "GET /first HTTP/1.1\r\n"
+                "\r\n"
+                "GET /second HTTP/1.1\r\n"
+                "Bad-Header: \r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                CHECK_THROW(
+                    test_connection.handle_pipelined( respond_with_path ),
+                    show::request_parse_error
+                );
+            },
+            (
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: 5\r\n"
+                "\r\n"
+                "first"
+            )
+        );
+    }
+    
     /*
     TODO: For some reason, this pattern isn't working for the next few tests:
         - GracefulClientDisconnectWhileCreating
@@ -625,6 +1362,40 @@ SUITE( ShowResponseTests )
         );
     }
     
+    TEST( FailReturnInvalidHeaderMapName )
+    {
+        handle_request(
+            (
+                "GET / HTTP/1.0\r\n"
+                "Content-Length: 0\r\n"
+                "\r\n"
+            ),
+            []( show::connection& test_connection ){
+                show::request test_request{ test_connection };
+                test_request.flush();
+                show::header_map headers;
+                headers.add( "Invalid header n*me", "asdf" );
+                try
+                {
+                    show::response test_response{
+                        test_connection,
+                        show::HTTP_1_0,
+                        { 200, "OK" },
+                        headers
+                    };
+                    CHECK( false );
+                }
+                catch( const show::response_marshall_error& e )
+                {
+                    CHECK_EQUAL(
+                        "invalid header name",
+                        e.what()
+                    );
+                }
+            }
+        );
+    }
+    
     TEST( FailReturnEmptyHeaderValue )
     {
         handle_request(
@@ -1,11 +1,18 @@
 #include "UnitTest++_wrap.hpp"
 #include <show.hpp>
 
+#include "async_utils.hpp"
+
 #include <curl/curl.h>
 
 #include <chrono>
+#include <stdexcept>  // std::invalid_argument
 #include <string>
 #include <thread>
+#include <vector>
+
+#include <sys/resource.h>   // getrlimit(), setrlimit()
+#include <unistd.h>         // close(), dup()
 
 
 SUITE( ShowServerTests )
@@ -99,6 +106,36 @@ SUITE( ShowServerTests )
         }
     }
     
+    TEST( ConstructWithHugeTimeout )
+    {
+        // In milliseconds this overflows a 32-bit `int`, wrapping around to a
+        // wait of under a second
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 4294968 };
+        
+        std::thread request_thread{ [ address, port ](){
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 1500 } );
+            send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){}
+            ).join();
+        } };
+        
+        try
+        {
+            auto test_connection = test_server.serve();
+        }
+        catch( ... )
+        {
+            request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+    }
+    
     TEST( ChangeToIndefiniteTimout )
     {
         int timeout{ -1 };
@@ -145,6 +182,345 @@ SUITE( ShowServerTests )
         }
     }
     
+    TEST( DefaultBacklog )
+    {
+        show::server test_server{ "::", 9090 };
+        CHECK_EQUAL(
+            SOMAXCONN,
+            test_server.backlog()
+        );
+    }
+    
+    TEST( ConstructWithBacklog )
+    {
+        int backlog{ 16 };
+        show::server test_server{ "::", 9090, -1, backlog };
+        CHECK_EQUAL(
+            backlog,
+            test_server.backlog()
+        );
+    }
+    
+    TEST( DefaultBufferSize )
+    {
+        show::server test_server{ "::", 9090 };
+        CHECK_EQUAL(
+            1024,
+            test_server.buffer_size()
+        );
+    }
+    
+    TEST( ChangeBufferSize )
+    {
+        show::server test_server{ "::", 9090 };
+        CHECK_EQUAL(
+            64 * 1024,
+            test_server.buffer_size( 64 * 1024 )
+        );
+        CHECK_EQUAL(
+            64 * 1024,
+            test_server.buffer_size()
+        );
+    }
+    
+    TEST( FailInvalidBufferSize )
+    {
+        show::server test_server{ "::", 9090 };
+        CHECK_THROW(
+            test_server.buffer_size( 0 ),
+            std::invalid_argument
+        );
+    }
+    
+    TEST( ServeManyDrainsQueue )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        std::thread request_threads[ 3 ];
+        for( auto& t : request_threads )
+            t = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+        
+        // Give all clients time to be queued
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+        
+        try
+        {
+            auto connections = test_server.serve_many();
+            CHECK_EQUAL( 3, connections.size() );
+            for( auto& c : connections )
+                CHECK_EQUAL(
+                    test_server.port(),
+                    c.server_port()
+                );
+        }
+        catch( ... )
+        {
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+    }
+    
+    TEST( ServeManyImmediateTimeout )
+    {
+        show::server test_server{ "::", 9090, 0 };
+        {
+            UNITTEST_TIME_CONSTRAINT( 250 );
+            CHECK_THROW(
+                test_server.serve_many(),
+                show::connection_timeout
+            );
+        }
+    }
+    
+    TEST( TryServeAppends )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        std::thread request_threads[ 2 ];
+        for( auto& t : request_threads )
+            t = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+        
+        // Give all clients time to be queued
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+        
+        try
+        {
+            std::vector< show::connection > connections;
+            auto status = test_server.try_serve( connections );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( 1, connections.size() );
+            
+            status = test_server.try_serve( connections );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( 2, connections.size() );
+        }
+        catch( ... )
+        {
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+    }
+    
+    TEST( TryServeManyDrainsQueue )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        std::thread request_threads[ 3 ];
+        for( auto& t : request_threads )
+            t = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+        
+        // Give all clients time to be queued
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+        
+        try
+        {
+            std::vector< show::connection > connections;
+            auto status = test_server.try_serve_many( connections );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( 3, connections.size() );
+        }
+        catch( ... )
+        {
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+    }
+    
+    TEST( TryServeManyKeepsAcceptedOnError )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        std::thread request_threads[ 3 ];
+        for( auto& t : request_threads )
+            t = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+        
+        // Give all clients time to be queued
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+        
+        rlimit original_limit;
+        getrlimit( RLIMIT_NOFILE, &original_limit );
+        
+        try
+        {
+            // Leave room for only one more descriptor, so accepting the
+            // second connection fails
+            auto next_descriptor = dup( 0 );
+            close( next_descriptor );
+            auto limit = original_limit;
+            limit.rlim_cur = static_cast< rlim_t >( next_descriptor + 1 );
+            setrlimit( RLIMIT_NOFILE, &limit );
+            
+            std::vector< show::connection > connections;
+            auto status = test_server.try_serve_many( connections );
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( 1, connections.size() );
+            
+            // The failure is reported by the next call, and the connections
+            // it left waiting are accepted by the one after that
+            CHECK_THROW(
+                test_server.try_serve_many( connections ),
+                show::socket_error
+            );
+            status = test_server.try_serve_many( connections );
+            CHECK( status == show::io_status::SUCCESS );
+            CHECK_EQUAL( 3, connections.size() );
+        }
+        catch( ... )
+        {
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+    }
+    
+    TEST( MoveAssignKeepsAcceptError )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::server test_server{ address, port, 2 };
+        
+        std::thread request_threads[ 2 ];
+        for( auto& t : request_threads )
+            t = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+        
+        // Give all clients time to be queued
+        std::this_thread::sleep_for( std::chrono::milliseconds{ 250 } );
+        
+        rlimit original_limit;
+        getrlimit( RLIMIT_NOFILE, &original_limit );
+        
+        try
+        {
+            // Leave room for only one more descriptor, so the accept error is
+            // left pending in `test_server`
+            auto next_descriptor = dup( 0 );
+            close( next_descriptor );
+            auto limit = original_limit;
+            limit.rlim_cur = static_cast< rlim_t >( next_descriptor + 1 );
+            setrlimit( RLIMIT_NOFILE, &limit );
+            
+            std::vector< show::connection > connections;
+            test_server.try_serve_many( connections );
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            
+            // The pending error goes with the listen socket, & isn't also
+            // reported by the server it was moved out of
+            show::server other_server{ address, 9595, 0 };
+            other_server = std::move( test_server );
+            CHECK_THROW(
+                other_server.try_serve_many( connections ),
+                show::socket_error
+            );
+            CHECK(
+                test_server.try_serve( connections )
+                == show::io_status::TIMEOUT
+            );
+        }
+        catch( ... )
+        {
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            for( auto& t : request_threads )
+                t.join();
+            throw;
+        }
+        
+        for( auto& t : request_threads )
+            t.join();
+    }
+    
+    TEST( TryServeImmediateTimeout )
+    {
+        show::server test_server{ "::", 9090, 0 };
+        std::vector< show::connection > connections;
+        {
+            UNITTEST_TIME_CONSTRAINT( 250 );
+            CHECK(
+                test_server.try_serve( connections )
+                == show::io_status::TIMEOUT
+            );
+            CHECK(
+                test_server.try_serve_many( connections )
+                == show::io_status::TIMEOUT
+            );
+        }
+        CHECK( connections.empty() );
+    }
+    
+    TEST( TryServePositiveTimeout )
+    {
+        show::server test_server{ "::", 9090, 1 };
+        std::vector< show::connection > connections;
+        CHECK(
+            test_server.try_serve( connections ) == show::io_status::TIMEOUT
+        );
+        CHECK( connections.empty() );
+    }
+    
     TEST( FailInUsePort )
     {
         auto test_socket = socket(
@@ -0,0 +1,324 @@
+#include "UnitTest++_wrap.hpp"
+#include <show/thread_pool_server.hpp>
+
+#include "async_utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>    // std::invalid_argument, std::runtime_error
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>          // sched_getaffinity()
+#include <sys/resource.h>   // getrlimit(), setrlimit()
+#include <unistd.h>         // close(), dup()
+
+
+SUITE( ShowThreadPoolServerTests )
+{
+    TEST( AddressPortThreads )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        show::thread_pool_server test_server{
+            address,
+            port,
+            []( show::connection& ){},
+            3,
+            2
+        };
+        CHECK_EQUAL( address, test_server.address()      );
+        CHECK_EQUAL( port   , test_server.port()         );
+        CHECK_EQUAL( 3      , test_server.thread_count() );
+        CHECK_EQUAL( 2      , test_server.timeout()      );
+    }
+    
+    TEST( DefaultThreadCount )
+    {
+        show::thread_pool_server test_server{
+            "::",
+            9090,
+            []( show::connection& ){}
+        };
+        // One per CPU the process is allowed to run on
+        cpu_set_t allowed;
+        CPU_ZERO( &allowed );
+        sched_getaffinity( 0, sizeof( allowed ), &allowed );
+        CHECK_EQUAL( CPU_COUNT( &allowed ), test_server.thread_count() );
+    }
+    
+    TEST( FiniteTimeoutByDefault )
+    {
+        show::thread_pool_server test_server{
+            "::",
+            9090,
+            []( show::connection& ){},
+            1
+        };
+        CHECK_EQUAL( 30, test_server.timeout() );
+    }
+    
+    TEST( FailNegativeTimeout )
+    {
+        CHECK_THROW(
+            show::thread_pool_server(
+                "::",
+                9090,
+                []( show::connection& ){},
+                1,
+                -1
+            ),
+            std::invalid_argument
+        );
+    }
+    
+    TEST( AnyFreePort )
+    {
+        std::string  address{ "::" };
+        std::atomic_int handled{ 0 };
+        
+        show::thread_pool_server test_server{
+            address,
+            0,
+            [ &handled ]( show::connection& ){ ++handled; },
+            3,
+            2
+        };
+        auto port = test_server.port();
+        CHECK( port != 0 );
+        
+        // Every worker is listening on the same port, so the kernel may hand
+        // these to any of them
+        for( int i = 0; i < 6; ++i )
+            send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){}
+            ).join();
+        
+        for( int i = 0; i < 20 && handled < 6; ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 50 } );
+        CHECK_EQUAL( 6, handled );
+    }
+    
+    TEST( ServeManyClients )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        std::atomic_int handled{ 0 };
+        
+        show::thread_pool_server test_server{
+            address,
+            port,
+            [ &handled ]( show::connection& c ){
+                show::request test_request{ c };
+                show::response test_response{
+                    c,
+                    show::http_protocol::HTTP_1_0,
+                    { 200, "OK" },
+                    { { "Content-Length", { "5" } } }
+                };
+                test_response.sputn( "hello", 5 );
+                ++handled;
+            },
+            4,
+            2
+        };
+        
+        std::vector< std::thread > request_threads;
+        for( int i = 0; i < 8; ++i )
+            request_threads.emplace_back( [ address, port ](){
+                check_response_to_request(
+                    address,
+                    port,
+                    (
+                        "GET / HTTP/1.0\r\n"
+                        "\r\n"
+                    ),
+                    (
+                        "HTTP/1.0 200 OK\r\n"
+                        "Content-Length: 5\r\n"
+                        "\r\n"
+                        "hello"
+                    )
+                );
+            } );
+        for( auto& t : request_threads )
+            t.join();
+        
+        CHECK_EQUAL( 8, handled );
+    }
+    
+    TEST( StopAndJoin )
+    {
+        show::thread_pool_server test_server{
+            "::",
+            9090,
+            []( show::connection& ){},
+            2
+        };
+        {
+            // Workers only check if they've been stopped once a second
+            UNITTEST_TIME_CONSTRAINT( 1100 );
+            test_server.stop();
+            test_server.join();
+        }
+    }
+    
+    TEST( RethrowHandlerException )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        
+        show::thread_pool_server test_server{
+            address,
+            port,
+            []( show::connection& ){
+                throw std::runtime_error{ "handler failed" };
+            },
+            2,
+            2
+        };
+        
+        auto request_thread = send_request_async(
+            address,
+            port,
+            []( show::socket_fd request_socket ){
+                write_to_socket(
+                    request_socket,
+                    "GET / HTTP/1.0\r\n\r\n"
+                );
+            }
+        );
+        request_thread.join();
+        
+        CHECK_THROW( test_server.join(), std::runtime_error );
+    }
+    
+    TEST( IgnoreConnectionInterruptions )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        std::atomic_int handled{ 0 };
+        
+        show::thread_pool_server test_server{
+            address,
+            port,
+            [ &handled ]( show::connection& ){
+                ++handled;
+                throw show::client_disconnected{};
+            },
+            1,
+            2
+        };
+        
+        for( int i = 0; i < 2; ++i )
+            send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){}
+            ).join();
+        
+        for( int i = 0; i < 20 && handled < 2; ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 50 } );
+        CHECK_EQUAL( 2, handled );
+        
+        test_server.stop();
+        test_server.join();
+    }
+    
+    TEST( IgnoreClientSocketErrors )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        std::atomic_int handled{ 0 };
+        
+        show::thread_pool_server test_server{
+            address,
+            port,
+            [ &handled ]( show::connection& ){
+                ++handled;
+                throw show::socket_error{ "broken pipe" };
+            },
+            1,
+            2
+        };
+        
+        for( int i = 0; i < 2; ++i )
+            send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){}
+            ).join();
+        
+        for( int i = 0; i < 20 && handled < 2; ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds{ 50 } );
+        CHECK_EQUAL( 2, handled );
+        
+        test_server.stop();
+        test_server.join();
+    }
+    
+    TEST( ContinueAfterAcceptErrors )
+    {
+        std::string  address{ "::" };
+        unsigned int port   { 9090 };
+        std::atomic_int handled{ 0 };
+        
+        rlimit original_limit;
+        getrlimit( RLIMIT_NOFILE, &original_limit );
+        
+        show::thread_pool_server test_server{
+            address,
+            port,
+            [ &handled ]( show::connection& ){ ++handled; },
+            1,
+            2
+        };
+        
+        std::thread request_thread;
+        try
+        {
+            // Leave room for only the client's socket, so accepting it fails
+            auto next_descriptor = dup( 0 );
+            close( next_descriptor );
+            auto limit = original_limit;
+            limit.rlim_cur = static_cast< rlim_t >( next_descriptor + 1 );
+            setrlimit( RLIMIT_NOFILE, &limit );
+            
+            request_thread = send_request_async(
+                address,
+                port,
+                []( show::socket_fd ){
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds{ 500 }
+                    );
+                }
+            );
+            for( int i = 0; i < 20 && test_server.accept_errors() < 1; ++i )
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds{ 10 }
+                );
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            CHECK( test_server.accept_errors() > 0 );
+            
+            for( int i = 0; i < 20 && handled < 1; ++i )
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds{ 50 }
+                );
+            CHECK_EQUAL( 1, handled );
+        }
+        catch( ... )
+        {
+            setrlimit( RLIMIT_NOFILE, &original_limit );
+            if( request_thread.joinable() )
+                request_thread.join();
+            throw;
+        }
+        
+        request_thread.join();
+        test_server.stop();
+        test_server.join();
+    }
+}
@@ -0,0 +1,210 @@
+#include "UnitTest++_wrap.hpp"
+#include <show/timer_wheel.hpp>
+
+#include <vector>
+
+
+namespace
+{
+    using expired_list = std::vector< std::pair<
+        show::timer_wheel::time_type,
+        show::timer_wheel::key_type
+    > >;
+    
+    // Advances one tick at a time so the time each timer expires at is known
+    void advance_by_tick(
+        show::timer_wheel& wheel,
+        show::timer_wheel::time_type until,
+        expired_list& expired
+    )
+    {
+        while( wheel.now() < until )
+            wheel.advance(
+                wheel.now() + 1,
+                [ & ]( show::timer_wheel::key_type key ){
+                    expired.emplace_back( wheel.now(), key );
+                }
+            );
+    }
+}
+
+
+SUITE( ShowTimerWheelTests )
+{
+    TEST( ExpireInDeadlineOrder )
+    {
+        show::timer_wheel wheel;
+        wheel.schedule( 3, 30 );
+        wheel.schedule( 1, 10 );
+        wheel.schedule( 2, 20 );
+        CHECK_EQUAL( 3, wheel.size() );
+        
+        std::vector< show::timer_wheel::key_type > expired;
+        auto count = wheel.advance( 25, [ & ]( std::size_t key ){
+            expired.push_back( key );
+        } );
+        
+        CHECK_EQUAL( 2, count );
+        CHECK( (
+            expired == std::vector< show::timer_wheel::key_type >{ 1, 2 }
+        ) );
+        CHECK_EQUAL( 25, wheel.now() );
+        CHECK_EQUAL( 1, wheel.size() );
+        CHECK( wheel.scheduled( 3 ) );
+        CHECK( !wheel.scheduled( 1 ) );
+        CHECK_EQUAL( 30, wheel.deadline( 3 ) );
+    }
+    
+    TEST( ExpireOnDeadline )
+    {
+        show::timer_wheel wheel{ 1000 };
+        wheel.schedule( 0, 1001 );
+        wheel.schedule( 1, 1063 );
+        wheel.schedule( 2, 1064 );
+        wheel.schedule( 3, 5000 );
+        wheel.schedule( 4, 300000 );
+        
+        expired_list expired;
+        advance_by_tick( wheel, 300000, expired );
+        
+        CHECK( ( expired == expired_list{
+            {   1001, 0 },
+            {   1063, 1 },
+            {   1064, 2 },
+            {   5000, 3 },
+            { 300000, 4 }
+        } ) );
+        CHECK( wheel.empty() );
+    }
+    
+    TEST( CancelAndReschedule )
+    {
+        show::timer_wheel wheel;
+        wheel.schedule( 0, 100 );
+        wheel.schedule( 1, 100 );
+        wheel.schedule( 2, 100 );
+        wheel.cancel( 1 );
+        wheel.cancel( 1 );
+        wheel.cancel( 1000 );
+        wheel.schedule( 2, 50 );
+        CHECK_EQUAL( 2, wheel.size() );
+        
+        expired_list expired;
+        advance_by_tick( wheel, 200, expired );
+        
+        CHECK( ( expired == expired_list{ { 50, 2 }, { 100, 0 } } ) );
+    }
+    
+    TEST( PastDeadlineExpiresNextTick )
+    {
+        show::timer_wheel wheel{ 500 };
+        wheel.schedule( 7, 10 );
+        CHECK_EQUAL( 501, wheel.deadline( 7 ) );
+        CHECK_EQUAL( 1, wheel.next_advance() );
+        
+        expired_list expired;
+        advance_by_tick( wheel, 501, expired );
+        CHECK( ( expired == expired_list{ { 501, 7 } } ) );
+    }
+    
+    TEST( ScheduleFromExpire )
+    {
+        show::timer_wheel wheel;
+        wheel.schedule( 0, 10 );
+        wheel.schedule( 1, 10 );
+        
+        // Whichever of the first two expires first cancels the other
+        expired_list expired;
+        auto count = wheel.advance( 100, [ & ]( std::size_t key ){
+            expired.emplace_back( wheel.now(), key );
+            if( key < 2 )
+            {
+                wheel.cancel( 1 - key );
+                wheel.schedule( 2, wheel.now() + 20 );
+                wheel.schedule( 3, 0 );
+            }
+        } );
+        
+        CHECK_EQUAL( 3, count );
+        REQUIRE CHECK_EQUAL( 3, expired.size() );
+        CHECK_EQUAL( 10, expired[ 0 ].first );
+        CHECK( ( expired[ 1 ] == expired_list::value_type{ 11, 3 } ) );
+        CHECK( ( expired[ 2 ] == expired_list::value_type{ 30, 2 } ) );
+        CHECK( wheel.empty() );
+    }
+    
+    TEST( ExpireThousandsInOneTick )
+    {
+        show::timer_wheel wheel;
+        for( std::size_t key = 0; key < 10000; ++key )
+            wheel.schedule( key, 30000 );
+        
+        CHECK_EQUAL( 0, wheel.advance( 29999, []( std::size_t ){} ) );
+        CHECK_EQUAL( 10000, wheel.size() );
+        
+        std::vector< bool > seen( 10000, false );
+        auto count = wheel.advance( 30000, [ & ]( std::size_t key ){
+            seen[ key ] = true;
+        } );
+        CHECK_EQUAL( 10000, count );
+        CHECK( wheel.empty() );
+        CHECK( ( seen == std::vector< bool >( 10000, true ) ) );
+    }
+    
+    TEST( BeyondLongestRange )
+    {
+        show::timer_wheel::time_type far{ 1ull << 40 };
+        show::timer_wheel wheel;
+        wheel.schedule( 0, far );
+        
+        CHECK_EQUAL( 0, wheel.advance( far - 1, []( std::size_t ){} ) );
+        CHECK_EQUAL( 1, wheel.advance( far    , []( std::size_t ){} ) );
+        CHECK( wheel.empty() );
+    }
+    
+    TEST( NextAdvance )
+    {
+        show::timer_wheel wheel;
+        CHECK_EQUAL( -1, wheel.next_advance() );
+        
+        wheel.schedule( 0, 10 );
+        CHECK_EQUAL( 10, wheel.next_advance() );
+        
+        // Coarser timers must be moved down no later than their slot comes up
+        wheel.cancel( 0 );
+        wheel.schedule( 0, 1000 );
+        auto wait = wheel.next_advance();
+        CHECK( wait > 0 );
+        CHECK( wait <= 960 );
+        
+        // Never waits past any deadline
+        for( show::timer_wheel::time_type deadline : { 70, 4095, 4096, 9999 } )
+        {
+            show::timer_wheel w{ 3 };
+            w.schedule( 0, deadline );
+            std::size_t expired{ 0 };
+            while( !w.empty() )
+            {
+                auto next = w.now() + w.next_advance();
+                CHECK( next <= deadline );
+                expired += w.advance( next, []( std::size_t ){} );
+            }
+            CHECK_EQUAL( 1, expired );
+            CHECK_EQUAL( deadline, w.now() );
+        }
+        
+        // Finest-wheel timers past where that wheel wraps are still found
+        show::timer_wheel wrapping{ 60 };
+        wrapping.schedule( 1, 70 );
+        CHECK_EQUAL( 10, wrapping.next_advance() );
+        CHECK_EQUAL( 1, wrapping.advance( 70, []( std::size_t ){} ) );
+    }
+    
+    TEST( FailDeadlineNotScheduled )
+    {
+        show::timer_wheel wheel;
+        wheel.schedule( 1, 10 );
+        CHECK_THROW( wheel.deadline( 0 ), std::out_of_range );
+        CHECK_THROW( wheel.deadline( 2 ), std::out_of_range );
+    }
+}
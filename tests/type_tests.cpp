@@ -1,6 +1,8 @@
 #include "UnitTest++_wrap.hpp"
 #include <show.hpp>
 
+#include <limits>     // std::numeric_limits<>
+#include <stdexcept>  // std::invalid_argument
 #include <string>
 
 
@@ -28,6 +30,76 @@ SUITE( ShowTypeTests )
         );
     }
     
+    TEST( ASCIIUpperCaseAllCharacters )
+    {
+        // Every character, at every position within a word
+        std::string all;
+        for( int c = 0; c < 256; ++c )
+            all += static_cast< char >( c );
+        
+        for( std::size_t offset = 0; offset < 8; ++offset )
+        {
+            auto input = all.substr( offset ) + all.substr( 0, offset );
+            std::string expected;
+            for( auto c : input )
+                expected += show::_ASCII_upper( c );
+            CHECK_EQUAL( expected, show::_ASCII_upper( input ) );
+        }
+    }
+    
+    TEST( ASCIIUpperCaseInPlace )
+    {
+        // Characters past `size` are left alone
+        std::string test_string{ "content-length: 0" };
+        show::_ASCII_upper_in_place( &test_string[ 0 ], 14 );
+        CHECK_EQUAL( "CONTENT-LENGTH: 0", test_string );
+    }
+    
+    TEST( CompareIgnoreCase )
+    {
+        auto compare = []( const std::string& lhs, const std::string& rhs ){
+            return show::_compare_ignore_case_ASCII(
+                lhs.data(),
+                lhs.size(),
+                rhs.data(),
+                rhs.size()
+            );
+        };
+        
+        CHECK_EQUAL(  0, compare( "Content-Length", "CONTENT-length" ) );
+        CHECK_EQUAL( -1, compare( "Content-Length", "Content-Type"   ) );
+        CHECK_EQUAL(  1, compare( "Content-Type"  , "content-length" ) );
+        CHECK_EQUAL( -1, compare( "Host"          , "host-name"      ) );
+        CHECK_EQUAL(  1, compare( "Accept-Charset", "Accept"         ) );
+        CHECK_EQUAL(  0, compare( ""              , ""               ) );
+        CHECK_EQUAL(  1, compare( "X_Header"      , "x-header"       ) );
+        // Letters compare as uppercase, so '_' comes after all of them
+        CHECK_EQUAL(  1, compare( "long-header-_" , "long-header-z"  ) );
+        
+        // Characters compare as `char`s, which are usually signed
+        CHECK_EQUAL(
+            std::numeric_limits< char >::is_signed ? -1 : 1,
+            compare( "abcdefg\xE9", "ABCDEFGZ" )
+        );
+        
+        // Mismatches at every position, with & without a case difference
+        std::string base{ "abcdefghijklmnopqrstu" };
+        for( std::size_t i = 0; i < base.size(); ++i )
+        {
+            auto greater = base;
+            greater[ i ] = '~';
+            auto upper = show::_ASCII_upper( base );
+            CHECK_EQUAL( -1, compare( base   , greater ) );
+            CHECK_EQUAL(  1, compare( greater, upper   ) );
+            CHECK_EQUAL(  0, compare( upper  , base    ) );
+        }
+        
+        CHECK(  show::_equal_ignore_case_ASCII( "Keep-Alive", "keep-alive" ) );
+        CHECK( !show::_equal_ignore_case_ASCII( "Keep-Alive", "keep_alive" ) );
+        CHECK( !show::_equal_ignore_case_ASCII( "Keep-Alive", "keep-aliv"  ) );
+        CHECK( !show::_equal_ignore_case_ASCII( "@", "`" ) );
+    }
+    
     TEST( CaseInsensitiveHeadersCreate )
     {
         show::headers_type test_headers{
@@ -62,4 +134,113 @@ SUITE( ShowTypeTests )
             test_headers.find( "test" ) != test_headers.end()
         );
     }
+    
+    TEST( HeaderNameIDs )
+    {
+        CHECK(
+            show::header_name_id( "content-LENGTH" )
+            == show::header_id::CONTENT_LENGTH
+        );
+        CHECK(
+            show::header_name_id( "X-Custom-Header" )
+            == show::header_id::UNKNOWN
+        );
+        // Hashes the same as "Content-Length", but isn't the same name
+        CHECK(
+            show::header_name_id( "Content\rLength" )
+            == show::header_id::UNKNOWN
+        );
+        CHECK_EQUAL(
+            "Transfer-Encoding",
+            show::header_name( show::header_id::TRANSFER_ENCODING ).to_string()
+        );
+    }
+    
+    TEST( HeaderMapAccess )
+    {
+        show::header_map test_headers;
+        test_headers.add( "Content-Type", "text/plain" );
+        test_headers.add( "x-custom"    , "foo"        );
+        test_headers.add( "X-Custom"    , "bar"        );
+        
+        CHECK_EQUAL( 3, test_headers.size() );
+        CHECK_EQUAL( 1, test_headers.count( show::header_id::CONTENT_TYPE ) );
+        CHECK_EQUAL( 2, test_headers.count( "X-CUSTOM" ) );
+        CHECK_EQUAL( 0, test_headers.count( "Host" ) );
+        CHECK_EQUAL(
+            "text/plain",
+            test_headers.get( "content-type" ).to_string()
+        );
+        CHECK_EQUAL( "foo", test_headers.get( "x-custom" ).to_string() );
+        CHECK( test_headers.get( "Missing" ).empty() );
+        
+        auto values = test_headers.get_all( "x-custom" );
+        CHECK_EQUAL( 2, values.size() );
+        CHECK_EQUAL( "bar", values.at( 1 ).to_string() );
+    }
+    
+    TEST( HeaderMapKeepsInsertionOrder )
+    {
+        show::header_map test_headers;
+        test_headers.add( "Zeta" , "1" );
+        test_headers.add( "Alpha", "2" );
+        test_headers.add( "Zeta" , "3" );
+        
+        std::string order;
+        for( const auto& field : test_headers )
+            order += field.name + "=" + field.value + ";";
+        CHECK_EQUAL( "Zeta=1;Alpha=2;Zeta=3;", order );
+    }
+    
+    TEST( HeaderMapSetAndErase )
+    {
+        show::header_map test_headers;
+        test_headers.add( "Set-Cookie", "a=1" );
+        test_headers.add( "Set-Cookie", "b=2" );
+        test_headers.add( "Other"     , "x"   );
+        
+        test_headers.set( show::header_id::SET_COOKIE, "c=3" );
+        CHECK_EQUAL( 1    , test_headers.count( "set-cookie" ) );
+        CHECK_EQUAL( "c=3", test_headers.get( "set-cookie" ).to_string() );
+        
+        CHECK_EQUAL( 1, test_headers.erase( "OTHER" ) );
+        CHECK_EQUAL( 0, test_headers.erase( "Other" ) );
+        CHECK_EQUAL( 1, test_headers.size() );
+        CHECK_THROW(
+            test_headers.add( show::header_id::UNKNOWN, "x" ),
+            std::invalid_argument
+        );
+    }
+    
+    TEST( HeaderMapManyNames )
+    {
+        // Enough names to force the unknown-name table to grow a few times
+        show::header_map test_headers;
+        for( int i = 0; i < 1000; ++i )
+            test_headers.add(
+                "X-Header-" + std::to_string( i ),
+                std::to_string( i )
+            );
+        
+        for( int i = 0; i < 1000; ++i )
+        {
+            auto name = "x-header-" + std::to_string( i );
+            CHECK_EQUAL(
+                std::to_string( i ),
+                test_headers.get( name ).to_string()
+            );
+        }
+    }
+    
+    TEST( HeaderMapFromHeadersType )
+    {
+        show::headers_type headers{
+            { "Content-Length", { "0"        } },
+            { "Test"          , { "a", "b"   } }
+        };
+        show::header_map test_headers{ headers };
+        CHECK_EQUAL( 3, test_headers.size() );
+        CHECK_EQUAL( "0", test_headers.get( "content-length" ).to_string() );
+        CHECK( test_headers.to_headers_type() == headers );
+    }
 }
@@ -1,11 +1,54 @@
 #include "UnitTest++_wrap.hpp"
 #include <show.hpp>
 
+#include <iomanip>    // std::setw(), std::setfill()
+#include <sstream>    // std::stringstream
 #include <string>
 
 #include "constants.hpp"
 
 
+namespace
+{
+    // The original stream-based encoder, which the table-driven one must
+    // match exactly
+    std::string reference_url_encode(
+        const std::string& o,
+        bool use_plus_space
+    )
+    {
+        std::stringstream encoded;
+        encoded << std::hex << std::uppercase << std::setfill( '0' );
+        for( auto c : o )
+            if( c == ' ' && use_plus_space )
+                encoded << '+';
+            else if(
+                   ( c >= 'A' && c <= 'Z' )
+                || ( c >= 'a' && c <= 'z' )
+                || ( c >= '0' && c <= '9' )
+                || c == '-'
+                || c == '_'
+                || c == '.'
+                || c == '~'
+            )
+                encoded << c;
+            else
+                encoded << '%' << std::setw( 2 ) << static_cast< unsigned int >(
+                    static_cast< unsigned char >( c )
+                );
+        return encoded.str();
+    }
+    
+    std::string every_byte()
+    {
+        std::string bytes;
+        for( int i = 0; i < 256; ++i )
+            bytes += static_cast< char >( i );
+        return bytes;
+    }
+}
+
+
 SUITE( ShowURLEncodeTests )
 {
     TEST( EncodeNoConversion )
@@ -233,4 +276,99 @@ SUITE( ShowURLEncodeTests )
             );
         }
     }
+    
+    TEST( EncodeEveryByteMatchesReference )
+    {
+        auto bytes = every_byte();
+        CHECK_EQUAL(
+            reference_url_encode( bytes, true ),
+            show::url_encode( bytes )
+        );
+        CHECK_EQUAL(
+            reference_url_encode( bytes, false ),
+            show::url_encode( bytes, false )
+        );
+    }
+    
+    TEST( EncodeIntoBuffer )
+    {
+        std::string in{ "a b/c" };
+        char out[ 15 ];
+        auto size = show::url_encode( in.c_str(), in.size(), out );
+        CHECK_EQUAL( "a+b%2Fc", std::string( out, size ) );
+        size = show::url_encode( in.c_str(), in.size(), out, false );
+        CHECK_EQUAL( "a%20b%2Fc", std::string( out, size ) );
+    }
+    
+    TEST( DecodeEveryEscapeSequence )
+    {
+        auto bytes = every_byte();
+        CHECK_EQUAL( bytes, show::url_decode( show::url_encode( bytes ) ) );
+        
+        static const char hex_digits[]{ "0123456789abcdef" };
+        std::string lowercase;
+        for( auto c : bytes )
+        {
+            auto u = static_cast< unsigned char >( c );
+            lowercase += '%';
+            lowercase += hex_digits[ u >> 4   ];
+            lowercase += hex_digits[ u & 0x0F ];
+        }
+        CHECK_EQUAL( bytes, show::url_decode( lowercase ) );
+    }
+    
+    TEST( DecodeInPlace )
+    {
+        char buffer[]{ "hello%2C+world%21" };
+        std::size_t size;
+        CHECK(
+            show::url_decode_status::SUCCESS == show::url_decode(
+                buffer,
+                sizeof( buffer ) - 1,
+                buffer,
+                size
+            )
+        );
+        CHECK_EQUAL( "hello, world!", std::string( buffer, size ) );
+    }
+    
+    TEST( DecodeIntoBufferFailIncompleteEscapeSequence )
+    {
+        std::string in{ "hello%2" };
+        char out[ 7 ];
+        std::size_t size;
+        CHECK(
+            show::url_decode_status::INCOMPLETE_SEQUENCE == show::url_decode(
+                in.c_str(),
+                in.size(),
+                out,
+                size
+            )
+        );
+        CHECK_EQUAL( "hello", std::string( out, size ) );
+    }
+    
+    TEST( DecodeIntoBufferFailInvalidEscapeSequence )
+    {
+        std::string in{ "hello+%g0world" };
+        char out[ 14 ];
+        std::size_t size;
+        CHECK(
+            show::url_decode_status::INVALID_SEQUENCE == show::url_decode(
+                in.c_str(),
+                in.size(),
+                out,
+                size
+            )
+        );
+        CHECK_EQUAL( "hello ", std::string( out, size ) );
+    }
+    
+    TEST( DecodeFailSignedEscapeSequence )
+    {
+        // These used to slip through the `std::stoi()`-based decoder
+        CHECK_THROW( show::url_decode( "%-1" ), show::url_decode_error );
+        CHECK_THROW( show::url_decode( "%+f" ), show::url_decode_error );
+        CHECK_THROW( show::url_decode( "% 1" ), show::url_decode_error );
+    }
 }